@@ -0,0 +1,74 @@
+#ifndef _ALLOCATION_HOOKS_HPP_
+#define _ALLOCATION_HOOKS_HPP_
+
+#include "AllocationTracker.hpp"
+
+// Замена глобальных operator new и delete, передающая выделения в AllocationTracker.
+// Подключается ровно в одну единицу трансляции программы (main.cpp, бенчмарк);
+// без ENGINE_TRACK_ALLOCATIONS ничего не определяет.
+#ifdef ENGINE_TRACK_ALLOCATIONS
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+inline void* trackedAllocate(std::size_t size) {
+    AllocationTracker::instance().recordAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+inline void* trackedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+    AllocationTracker::instance().recordAllocation(size);
+    std::size_t align = std::max<std::size_t>((std::size_t)alignment, sizeof(void*));
+    // aligned_alloc требует размер, кратный выравниванию
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+inline void trackedFree(void* pointer) {
+    if (!pointer) return;
+    AllocationTracker::instance().recordFree();
+    std::free(pointer);
+}
+
+void* operator new(std::size_t size) {
+    if (void* pointer = trackedAllocate(size)) return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* pointer = trackedAllocate(size)) return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* pointer = trackedAllocateAligned(size, alignment)) return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* pointer = trackedAllocateAligned(size, alignment)) return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { trackedFree(pointer); }
+
+#endif // ENGINE_TRACK_ALLOCATIONS
+
+#endif // _ALLOCATION_HOOKS_HPP_
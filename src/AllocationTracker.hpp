@@ -0,0 +1,192 @@
+#ifndef _ALLOCATION_TRACKER_HPP_
+#define _ALLOCATION_TRACKER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+// Учёт выделений памяти в куче: сколько раз и сколько байт выделено, всего и по этапам кадра.
+//
+// Подсчёт включается сборкой с ENGINE_TRACK_ALLOCATIONS (make ALLOCS=1): тогда AllocationHooks.hpp,
+// подключённый в одной единице трансляции, заменяет глобальные operator new и delete.
+// Этап задаёт ALLOCATION_SCOPE("raster") до конца блока; JobSystem передаёт этап
+// вызывающего потока частям parallelFor. Выделения вне этапов учитываются без метки.
+// Сам учёт память не выделяет: счётчики атомарны и лежат в массиве фиксированного размера.
+
+// Число выделений и освобождений и выделенные байты
+struct AllocationCounts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+};
+
+// Снимок счётчиков; разность двух снимков — работа между ними (см. AllocationSnapshot::since)
+struct AllocationSnapshot {
+    static const int MAX_TAGS = 32;
+
+    AllocationCounts total;
+    const char* tags[MAX_TAGS];         // Этапы в порядке первого выделения
+    AllocationCounts tagCounts[MAX_TAGS];
+    int tagCount = 0;
+
+    AllocationSnapshot since(const AllocationSnapshot& earlier) const {
+        AllocationSnapshot result = *this;
+        result.total.allocations -= earlier.total.allocations;
+        result.total.bytes -= earlier.total.bytes;
+        result.total.frees -= earlier.total.frees;
+        for (int i = 0; i < earlier.tagCount; ++i) {
+            result.tagCounts[i].allocations -= earlier.tagCounts[i].allocations;
+            result.tagCounts[i].bytes -= earlier.tagCounts[i].bytes;
+            result.tagCounts[i].frees -= earlier.tagCounts[i].frees;
+        }
+        return result;
+    }
+
+    // Одна строка: итог и этапы с выделениями, "(untagged)" — вне этапов
+    void print(FILE* file) const {
+        fprintf(file, "%llu allocations, %llu bytes, %llu frees", (unsigned long long)total.allocations,
+                (unsigned long long)total.bytes, (unsigned long long)total.frees);
+        uint64_t tagged = 0;
+        for (int i = 0; i < tagCount; ++i) {
+            if (!tagCounts[i].allocations) continue;
+            tagged += tagCounts[i].allocations;
+            fprintf(file, "; %s %llu (%llu bytes)", tags[i], (unsigned long long)tagCounts[i].allocations,
+                    (unsigned long long)tagCounts[i].bytes);
+        }
+        if (total.allocations > tagged) {
+            fprintf(file, "; (untagged) %llu", (unsigned long long)(total.allocations - tagged));
+        }
+        fprintf(file, "\n");
+    }
+};
+
+class AllocationTracker {
+private:
+    struct Tag {
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<uint64_t> allocations{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+        std::atomic<uint64_t> frees{ 0 };
+    };
+
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> frees{ 0 };
+    Tag tags[AllocationSnapshot::MAX_TAGS];
+    std::atomic<int> tagCount{ 0 };
+    std::mutex tagMutex;   // Только для добавления нового этапа
+
+    static const char*& threadTag() {
+        static thread_local const char* tag = nullptr;
+        return tag;
+    }
+
+    // Ячейка этапа name; nullptr, если этапов больше MAX_TAGS
+    Tag* findTag(const char* name) {
+        int count = tagCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; ++i) {
+            const char* known = tags[i].name.load(std::memory_order_relaxed);
+            if (known == name || strcmp(known, name) == 0) return &tags[i];
+        }
+        std::lock_guard<std::mutex> lock(tagMutex);
+        count = tagCount.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; ++i) {
+            if (strcmp(tags[i].name.load(std::memory_order_relaxed), name) == 0) return &tags[i];
+        }
+        if (count == AllocationSnapshot::MAX_TAGS) return nullptr;
+        tags[count].name.store(name, std::memory_order_relaxed);
+        tagCount.store(count + 1, std::memory_order_release);
+        return &tags[count];
+    }
+
+    AllocationTracker() {}
+
+public:
+    // Единственный учёт на процесс; доступен и из operator new до начала main
+    static AllocationTracker& instance() {
+        static AllocationTracker tracker;
+        return tracker;
+    }
+
+    // Собран ли движок с учётом выделений (ENGINE_TRACK_ALLOCATIONS)
+    static constexpr bool compiledIn() {
+#ifdef ENGINE_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Этап вызывающего потока (nullptr — вне этапов) и его смена; возвращает прежний
+    static const char* currentTag() {
+        return threadTag();
+    }
+
+    static const char* exchangeTag(const char* tag) {
+        const char* previous = threadTag();
+        threadTag() = tag;
+        return previous;
+    }
+
+    void recordAllocation(size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        if (const char* name = threadTag()) {
+            if (Tag* tag = findTag(name)) {
+                tag->allocations.fetch_add(1, std::memory_order_relaxed);
+                tag->bytes.fetch_add(size, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void recordFree() {
+        frees.fetch_add(1, std::memory_order_relaxed);
+        if (const char* name = threadTag()) {
+            if (Tag* tag = findTag(name)) tag->frees.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    AllocationSnapshot snapshot() const {
+        AllocationSnapshot result;
+        result.total.allocations = allocations.load(std::memory_order_relaxed);
+        result.total.bytes = bytes.load(std::memory_order_relaxed);
+        result.total.frees = frees.load(std::memory_order_relaxed);
+        result.tagCount = tagCount.load(std::memory_order_acquire);
+        for (int i = 0; i < result.tagCount; ++i) {
+            result.tags[i] = tags[i].name.load(std::memory_order_relaxed);
+            result.tagCounts[i].allocations = tags[i].allocations.load(std::memory_order_relaxed);
+            result.tagCounts[i].bytes = tags[i].bytes.load(std::memory_order_relaxed);
+            result.tagCounts[i].frees = tags[i].frees.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+};
+
+// Этап для выделений вызывающего потока до конца области видимости
+class AllocationScope {
+private:
+    const char* previous;
+
+public:
+    explicit AllocationScope(const char* tag) : previous(AllocationTracker::exchangeTag(tag)) {}
+
+    ~AllocationScope() {
+        AllocationTracker::exchangeTag(previous);
+    }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+};
+
+#define ALLOCATION_CONCAT_INNER(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_INNER(a, b)
+
+#ifdef ENGINE_TRACK_ALLOCATIONS
+#define ALLOCATION_SCOPE(tag) AllocationScope ALLOCATION_CONCAT(allocationScope, __LINE__)(tag)
+#else
+#define ALLOCATION_SCOPE(tag) ((void)0)
+#endif
+
+#endif // _ALLOCATION_TRACKER_HPP_
@@ -0,0 +1,127 @@
+#ifndef _BITMAP_FONT_HPP_
+#define _BITMAP_FONT_HPP_
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdint>
+
+// Встроенный растровый шрифт 5x7 для символов ASCII 32..126 и вывод текста в 32-битную поверхность.
+// Строка глифа хранится битовой маской, и подряд идущие установленные биты заливаются одним отрезком:
+// вывод текста — это короткие заполнения строк пикселей, без выделения памяти и без SDL_ttf.
+class BitmapFont {
+public:
+    static const int GLYPH_WIDTH = 5;
+    static const int GLYPH_HEIGHT = 7;
+    static const int ADVANCE = GLYPH_WIDTH + 1;      // Шаг символа в пикселях при масштабе 1
+    static const int LINE_HEIGHT = GLYPH_HEIGHT + 2; // Шаг строки
+
+private:
+    static const int FIRST = 32;
+    static const int LAST = 126;
+
+    // Глифы по столбцам слева направо, младший бит — верхняя строка
+    static const uint8_t* columns(int code) {
+        static const uint8_t table[LAST - FIRST + 1][GLYPH_WIDTH] = {
+            { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 },
+            { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 },
+            { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 }, { 0x00, 0x1C, 0x22, 0x41, 0x00 },
+            { 0x00, 0x41, 0x22, 0x1C, 0x00 }, { 0x14, 0x08, 0x3E, 0x08, 0x14 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 },
+            { 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x60, 0x60, 0x00, 0x00 },
+            { 0x20, 0x10, 0x08, 0x04, 0x02 }, { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 },
+            { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 }, { 0x18, 0x14, 0x12, 0x7F, 0x10 },
+            { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },
+            { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E }, { 0x00, 0x36, 0x36, 0x00, 0x00 },
+            { 0x00, 0x56, 0x36, 0x00, 0x00 }, { 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 },
+            { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 }, { 0x32, 0x49, 0x79, 0x41, 0x3E },
+            { 0x7E, 0x11, 0x11, 0x11, 0x7E }, { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 },
+            { 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, { 0x7F, 0x09, 0x09, 0x01, 0x01 },
+            { 0x3E, 0x41, 0x41, 0x51, 0x32 }, { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 },
+            { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 }, { 0x7F, 0x40, 0x40, 0x40, 0x40 },
+            { 0x7F, 0x02, 0x04, 0x02, 0x7F }, { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E },
+            { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, { 0x7F, 0x09, 0x19, 0x29, 0x46 },
+            { 0x46, 0x49, 0x49, 0x49, 0x31 }, { 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F },
+            { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x7F, 0x20, 0x18, 0x20, 0x7F }, { 0x63, 0x14, 0x08, 0x14, 0x63 },
+            { 0x03, 0x04, 0x78, 0x04, 0x03 }, { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 },
+            { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 }, { 0x04, 0x02, 0x01, 0x02, 0x04 },
+            { 0x40, 0x40, 0x40, 0x40, 0x40 }, { 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 },
+            { 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 }, { 0x38, 0x44, 0x44, 0x48, 0x7F },
+            { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x08, 0x54, 0x54, 0x54, 0x3C },
+            { 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, { 0x20, 0x40, 0x44, 0x3D, 0x00 },
+            { 0x7F, 0x10, 0x28, 0x44, 0x00 }, { 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 },
+            { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 }, { 0x7C, 0x14, 0x14, 0x14, 0x08 },
+            { 0x08, 0x14, 0x14, 0x18, 0x7C }, { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },
+            { 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, { 0x1C, 0x20, 0x40, 0x20, 0x1C },
+            { 0x3C, 0x40, 0x30, 0x40, 0x3C }, { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C },
+            { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 }, { 0x00, 0x00, 0x7F, 0x00, 0x00 },
+            { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x08, 0x04, 0x08, 0x10, 0x08 }
+        };
+        if (code < FIRST || code > LAST) code = '?';
+        return table[code - FIRST];
+    }
+
+    // Те же глифы по строкам: бит 0 — левый столбец. Перекладываются один раз при первом обращении.
+    static const uint8_t* rows(int code) {
+        struct RowTable {
+            uint8_t masks[LAST - FIRST + 1][GLYPH_HEIGHT];
+            RowTable() {
+                for (int code = FIRST; code <= LAST; ++code) {
+                    const uint8_t* glyph = columns(code);
+                    for (int y = 0; y < GLYPH_HEIGHT; ++y) {
+                        uint8_t mask = 0;
+                        for (int x = 0; x < GLYPH_WIDTH; ++x) {
+                            if (glyph[x] >> y & 1) mask |= (uint8_t)(1 << x);
+                        }
+                        masks[code - FIRST][y] = mask;
+                    }
+                }
+            }
+        };
+        static const RowTable table;
+        if (code < FIRST || code > LAST) code = '?';
+        return table.masks[code - FIRST];
+    }
+
+public:
+    // Ширина текста в пикселях
+    static int textWidth(const char* text, int scale = 1) {
+        int length = 0;
+        while (text[length]) length++;
+        return length ? (length * ADVANCE - 1) * scale : 0;
+    }
+
+    // Текст с левым верхним углом в (x, y); color — пиксель в формате поверхности.
+    // Всё, что выходит за clip (nullptr — за поверхность), отбрасывается. Поверхность — 32 бита на пиксель.
+    static void drawText(SDL_Surface* surface, int x, int y, const char* text, uint32_t color, int scale = 1,
+                         const SDL_Rect* clip = nullptr) {
+        SDL_Rect bounds = { 0, 0, surface->w, surface->h };
+        if (clip && !SDL_IntersectRect(clip, &bounds, &bounds)) return;
+        int right = bounds.x + bounds.w;
+        int bottom = bounds.y + bounds.h;
+
+        for (; *text; ++text, x += ADVANCE * scale) {
+            if (*text == ' ') continue;
+            if (x >= right) break;
+            const uint8_t* glyph = rows((unsigned char)*text);
+            for (int row = 0; row < GLYPH_HEIGHT; ++row) {
+                uint8_t mask = glyph[row];
+                int top = y + row * scale;
+                for (int column = 0; mask; ) {
+                    // Следующий отрезок установленных битов
+                    while (!(mask & 1)) mask >>= 1, column++;
+                    int run = 0;
+                    while (mask & 1) mask >>= 1, run++;
+                    int from = std::max(bounds.x, x + column * scale);
+                    int to = std::min(right, x + (column + run) * scale);
+                    column += run;
+                    if (from >= to) continue;
+                    for (int line = std::max(bounds.y, top); line < std::min(bottom, top + scale); ++line) {
+                        uint32_t* pixels = (uint32_t*)((uint8_t*)surface->pixels + line * surface->pitch);
+                        std::fill(pixels + from, pixels + to, color);
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif // _BITMAP_FONT_HPP_
@@ -0,0 +1,64 @@
+#ifndef _BOUNDING_BOX_HPP_
+#define _BOUNDING_BOX_HPP_
+
+#include <limits>
+#include <algorithm>
+
+#include "Position3D.hpp"
+
+// Ограничивающий параллелепипед, выровненный по осям (AABB)
+struct BoundingBox {
+    Position3D min;
+    Position3D max;
+
+    // Пустой параллелепипед: min > max, любое расширение его заменяет
+    BoundingBox()
+        : min( std::numeric_limits<float>::max(),  std::numeric_limits<float>::max(),  std::numeric_limits<float>::max()),
+          max(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()) {}
+
+    BoundingBox(const Position3D& minPoint, const Position3D& maxPoint) : min(minPoint), max(maxPoint) {}
+
+    bool isEmpty() const {
+        return min.getX() > max.getX();
+    }
+
+    // Расширение до точки
+    void expand(const Position3D& point) {
+        min.setPosition(std::min(min.getX(), point.getX()), std::min(min.getY(), point.getY()), std::min(min.getZ(), point.getZ()));
+        max.setPosition(std::max(max.getX(), point.getX()), std::max(max.getY(), point.getY()), std::max(max.getZ(), point.getZ()));
+    }
+
+    // Расширение до другого параллелепипеда
+    void expand(const BoundingBox& other) {
+        if (other.isEmpty()) return;
+        expand(other.min);
+        expand(other.max);
+    }
+
+    Position3D getCenter() const {
+        return Position3D((min.getX() + max.getX()) * 0.5f,
+                          (min.getY() + max.getY()) * 0.5f,
+                          (min.getZ() + max.getZ()) * 0.5f);
+    }
+
+    Position3D getSize() const {
+        return max - min;
+    }
+
+    // Площадь поверхности, используется в эвристике SAH
+    float surfaceArea() const {
+        if (isEmpty()) return 0.0f;
+        Position3D size = getSize();
+        return 2.0f * (size.getX() * size.getY() + size.getY() * size.getZ() + size.getZ() * size.getX());
+    }
+
+    bool operator==(const BoundingBox& other) const {
+        return min == other.min && max == other.max;
+    }
+
+    bool operator!=(const BoundingBox& other) const {
+        return !(*this == other);
+    }
+};
+
+#endif // _BOUNDING_BOX_HPP_
@@ -0,0 +1,386 @@
+#ifndef _BOUNDING_VOLUME_HIERARCHY_HPP_
+#define _BOUNDING_VOLUME_HIERARCHY_HPP_
+
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+#include "Ray.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+
+// Иерархия ограничивающих объёмов над границами объектов сцены.
+//
+// Строится по эвристике площади поверхности (SAH) с разбиением центров
+// на корзины. Узлы лежат в плоском массиве, потомки всегда правее родителя,
+// а элементы каждого поддерева занимают непрерывный диапазон itemIndices.
+// При перемещении объектов дерево не перестраивается, а уточняются
+// (refit) границы изменившихся листьев и их предков.
+//
+// Элементы могут быть объединены в группы (например, поддеревья графа сцены). Пока в узле
+// больше одной группы, разбиение идёт по центрам групп, и группа не делится; поэтому у каждой
+// группы есть своё поддерево с её общими границами, и группа вне пирамиды отсекается одной проверкой.
+class BoundingVolumeHierarchy {
+private:
+    struct Node {
+        BoundingBox bounds;
+        int left;        // Индекс левого потомка (правый — left + 1), -1 у листа
+        int parent;      // Индекс родителя, -1 у корня
+        int firstItem;   // Начало диапазона элементов поддерева в itemIndices
+        int itemCount;   // Число элементов поддерева
+    };
+
+    static const int BIN_COUNT = 12;
+    static const int MAX_LEAF_SIZE = 4;
+    static const int MAX_DEPTH = 60;            // Ограничивает размер стека обхода
+    static const int QUALITY_CHECK_INTERVAL = 32;  // Через сколько уточнений проверять качество дерева
+
+    std::vector<Node> nodes;
+    std::vector<int> itemIndices;          // Элементы в порядке листьев
+    std::vector<BoundingBox> itemBounds;   // Текущие границы элементов
+    std::vector<int> itemLeaves;           // Лист, содержащий элемент
+    std::vector<int> itemGroups;           // Группа элемента (0..groupCentroids.size()-1) или -1
+    std::vector<Position3D> groupCentroids; // Центры общих границ групп
+    std::vector<int> dirtyLeaves;
+    std::vector<uint8_t> leafDirtyFlags;
+
+    float builtCost;      // Стоимость SAH сразу после построения
+    int refitCounter;
+
+    // Стоимость SAH всего дерева: сумма площадей узлов, взвешенная числом элементов листьев
+    float computeCost() const {
+        float cost = 0.0f;
+        for (const auto& node : nodes) {
+            cost += node.left < 0 ? node.bounds.surfaceArea() * node.itemCount : node.bounds.surfaceArea();
+        }
+        return cost;
+    }
+
+    float axisValue(const Position3D& point, int axis) const {
+        return axis == 0 ? point.getX() : (axis == 1 ? point.getY() : point.getZ());
+    }
+
+    // Элементы first и first - 1 в itemIndices относятся к разным группам (или не входят ни в одну)
+    bool isGroupBoundary(int first) const {
+        int group = itemGroups[itemIndices[first]];
+        return group < 0 || group != itemGroups[itemIndices[first - 1]];
+    }
+
+    void subdivide(int nodeIndex, const std::vector<Position3D>& centroids, int depth) {
+        Node& node = nodes[nodeIndex];
+        int first = node.firstItem;
+        int count = node.itemCount;
+
+        for (int i = first; i < first + count; ++i) {
+            node.bounds.expand(itemBounds[itemIndices[i]]);
+        }
+        if (count <= 1 || depth >= MAX_DEPTH) {
+            makeLeaf(nodeIndex);
+            return;
+        }
+
+        // В узле несколько групп: группа разбивается по своему общему центру и не делится
+        bool grouped = false;
+        for (int i = first + 1; i < first + count && !grouped; ++i) {
+            grouped = isGroupBoundary(i);
+        }
+        auto centroid = [&](int item) -> const Position3D& {
+            int group = itemGroups[item];
+            return grouped && group >= 0 ? groupCentroids[group] : centroids[item];
+        };
+
+        BoundingBox centroidBounds;
+        for (int i = first; i < first + count; ++i) {
+            centroidBounds.expand(centroid(itemIndices[i]));
+        }
+
+        // Поиск лучшего разбиения по всем трём осям
+        int bestAxis = -1;
+        int bestSplit = 0;
+        float bestCost = std::numeric_limits<float>::max();
+
+        for (int axis = 0; axis < 3; ++axis) {
+            float axisMin = axisValue(centroidBounds.min, axis);
+            float axisExtent = axisValue(centroidBounds.max, axis) - axisMin;
+            if (axisExtent <= 0.0f) continue;
+
+            BoundingBox binBounds[BIN_COUNT];
+            int binCounts[BIN_COUNT] = {0};
+            float scale = BIN_COUNT / axisExtent;
+
+            for (int i = first; i < first + count; ++i) {
+                int item = itemIndices[i];
+                int bin = std::min(BIN_COUNT - 1, (int)((axisValue(centroid(item), axis) - axisMin) * scale));
+                binCounts[bin]++;
+                binBounds[bin].expand(itemBounds[item]);
+            }
+
+            // Проход справа налево накапливает площади правых частей
+            float rightAreas[BIN_COUNT];
+            int rightCounts[BIN_COUNT];
+            BoundingBox accumulated;
+            int accumulatedCount = 0;
+            for (int bin = BIN_COUNT - 1; bin > 0; --bin) {
+                accumulated.expand(binBounds[bin]);
+                accumulatedCount += binCounts[bin];
+                rightAreas[bin] = accumulated.surfaceArea();
+                rightCounts[bin] = accumulatedCount;
+            }
+
+            accumulated = BoundingBox();
+            accumulatedCount = 0;
+            for (int split = 1; split < BIN_COUNT; ++split) {
+                accumulated.expand(binBounds[split - 1]);
+                accumulatedCount += binCounts[split - 1];
+                if (accumulatedCount == 0 || rightCounts[split] == 0) continue;
+
+                float cost = accumulated.surfaceArea() * accumulatedCount + rightAreas[split] * rightCounts[split];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        float leafCost = node.bounds.surfaceArea() * count;
+        int middle;
+
+        if (bestAxis >= 0 && (bestCost < leafCost || count > MAX_LEAF_SIZE)) {
+            float axisMin = axisValue(centroidBounds.min, bestAxis);
+            float scale = BIN_COUNT / (axisValue(centroidBounds.max, bestAxis) - axisMin);
+            // Устойчивое разбиение сохраняет элементы каждой группы подряд
+            auto middleIt = std::stable_partition(itemIndices.begin() + first, itemIndices.begin() + first + count,
+                [&](int item) {
+                    int bin = std::min(BIN_COUNT - 1, (int)((axisValue(centroid(item), bestAxis) - axisMin) * scale));
+                    return bin < bestSplit;
+                });
+            middle = (int)(middleIt - itemIndices.begin());
+        } else if (count > MAX_LEAF_SIZE) {
+            // Все центры совпадают — делим пополам по порядку, а группы — по ближайшей к середине границе
+            middle = first + count / 2;
+            if (grouped) {
+                int best = -1;
+                for (int i = first + 1; i < first + count; ++i) {
+                    if (isGroupBoundary(i) && (best < 0 || std::abs(i - middle) < std::abs(best - middle))) best = i;
+                }
+                middle = best;
+            }
+        } else {
+            makeLeaf(nodeIndex);
+            return;
+        }
+
+        int left = (int)nodes.size();
+        nodes.push_back({BoundingBox(), -1, nodeIndex, first, middle - first});
+        nodes.push_back({BoundingBox(), -1, nodeIndex, middle, first + count - middle});
+        nodes[nodeIndex].left = left;
+
+        subdivide(left, centroids, depth + 1);
+        subdivide(left + 1, centroids, depth + 1);
+    }
+
+    void makeLeaf(int nodeIndex) {
+        const Node& node = nodes[nodeIndex];
+        for (int i = node.firstItem; i < node.firstItem + node.itemCount; ++i) {
+            itemLeaves[itemIndices[i]] = nodeIndex;
+        }
+    }
+
+public:
+    BoundingVolumeHierarchy() : builtCost(0.0f), refitCounter(0) {}
+
+    // Полное построение по границам элементов. groups[i] — номер группы элемента i (любое
+    // неотрицательное число) или -1; пустой groups — элементы без групп.
+    void build(const std::vector<BoundingBox>& bounds, const std::vector<int>& groups = std::vector<int>()) {
+        itemBounds = bounds;
+        itemIndices.resize(bounds.size());
+        itemLeaves.assign(bounds.size(), -1);
+        for (size_t i = 0; i < bounds.size(); ++i) {
+            itemIndices[i] = (int)i;
+        }
+
+        // Номера групп подряд с нуля и общие границы каждой группы
+        itemGroups.assign(bounds.size(), -1);
+        std::vector<BoundingBox> groupBounds;
+        if (!groups.empty()) {
+            std::vector<int> compact(*std::max_element(groups.begin(), groups.end()) + 1, -1);
+            for (size_t i = 0; i < bounds.size(); ++i) {
+                if (groups[i] < 0) continue;
+                int& group = compact[groups[i]];
+                if (group < 0) {
+                    group = (int)groupBounds.size();
+                    groupBounds.push_back(BoundingBox());
+                }
+                itemGroups[i] = group;
+                groupBounds[group].expand(bounds[i]);
+            }
+            // Элементы каждой группы подряд: разбиение узлов их уже не перемешает
+            std::stable_sort(itemIndices.begin(), itemIndices.end(),
+                [&](int a, int b) { return itemGroups[a] < itemGroups[b]; });
+        }
+        groupCentroids.clear();
+        for (const auto& box : groupBounds) {
+            groupCentroids.push_back(box.getCenter());
+        }
+
+        std::vector<Position3D> centroids;
+        centroids.reserve(bounds.size());
+        for (const auto& box : bounds) {
+            centroids.push_back(box.getCenter());
+        }
+
+        nodes.clear();
+        nodes.reserve(bounds.size() * 2);
+        dirtyLeaves.clear();
+        leafDirtyFlags.clear();
+        refitCounter = 0;
+
+        if (bounds.empty()) {
+            builtCost = 0.0f;
+            return;
+        }
+
+        nodes.push_back({BoundingBox(), -1, -1, 0, (int)bounds.size()});
+        subdivide(0, centroids, 0);
+
+        leafDirtyFlags.assign(nodes.size(), 0);
+        builtCost = computeCost();
+    }
+
+    size_t getItemCount() const {
+        return itemBounds.size();
+    }
+
+    size_t getNodeCount() const {
+        return nodes.size();
+    }
+
+    const BoundingBox& getItemBounds(int item) const {
+        return itemBounds[item];
+    }
+
+    // Новые границы элемента. Дерево уточняется при следующем refit().
+    void updateItem(int item, const BoundingBox& bounds) {
+        itemBounds[item] = bounds;
+        int leaf = itemLeaves[item];
+        if (!leafDirtyFlags[leaf]) {
+            leafDirtyFlags[leaf] = 1;
+            dirtyLeaves.push_back(leaf);
+        }
+    }
+
+    // Уточнение границ изменившихся листьев и путей от них до корня.
+    // Если качество дерева деградировало вдвое, оно перестраивается заново.
+    void refit() {
+        if (dirtyLeaves.empty()) return;
+
+        for (int leaf : dirtyLeaves) {
+            leafDirtyFlags[leaf] = 0;
+
+            Node& node = nodes[leaf];
+            node.bounds = BoundingBox();
+            for (int i = node.firstItem; i < node.firstItem + node.itemCount; ++i) {
+                node.bounds.expand(itemBounds[itemIndices[i]]);
+            }
+
+            for (int parent = node.parent; parent >= 0; parent = nodes[parent].parent) {
+                Node& parentNode = nodes[parent];
+                parentNode.bounds = nodes[parentNode.left].bounds;
+                parentNode.bounds.expand(nodes[parentNode.left + 1].bounds);
+            }
+        }
+        dirtyLeaves.clear();
+
+        if (++refitCounter >= QUALITY_CHECK_INTERVAL) {
+            refitCounter = 0;
+            if (computeCost() > builtCost * 2.0f) {
+                std::vector<BoundingBox> bounds = itemBounds;
+                std::vector<int> groups = itemGroups;
+                build(bounds, groups);
+            }
+        }
+    }
+
+    // Обход элементов, пересекающих пирамиду видимости.
+    // Поддерево целиком внутри пирамиды выдаётся без дальнейших проверок.
+    template <typename Visitor>
+    void forEachVisible(const Frustum& frustum, Visitor visit) const {
+        if (nodes.empty()) return;
+
+        int stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const Node& node = nodes[stack[--stackSize]];
+            Frustum::Classification result = frustum.classify(node.bounds);
+            if (result == Frustum::OUTSIDE) continue;
+
+            if (result == Frustum::INSIDE || node.left < 0) {
+                for (int i = node.firstItem; i < node.firstItem + node.itemCount; ++i) {
+                    visit(itemIndices[i]);
+                }
+                continue;
+            }
+
+            stack[stackSize++] = node.left + 1;
+            stack[stackSize++] = node.left;
+        }
+    }
+
+    // Поиск ближайшего пересечения луча. testItem(item, tMax) проверяет элемент
+    // и при попадании ближе tMax уменьшает tMax и возвращает true.
+    template <typename ItemTest>
+    bool intersectRay(const Ray& ray, float& tMax, ItemTest testItem) const {
+        if (nodes.empty()) return false;
+
+        bool hit = false;
+        int stack[64];
+        float stackDistances[64];
+        int stackSize = 0;
+
+        float tNear;
+        if (!ray.intersectBox(nodes[0].bounds, tMax, tNear)) return false;
+        stack[stackSize] = 0;
+        stackDistances[stackSize++] = tNear;
+
+        while (stackSize > 0) {
+            --stackSize;
+            // Узел мог оказаться дальше уже найденного пересечения
+            if (stackDistances[stackSize] > tMax) continue;
+            const Node& node = nodes[stack[stackSize]];
+
+            if (node.left < 0) {
+                for (int i = node.firstItem; i < node.firstItem + node.itemCount; ++i) {
+                    if (testItem(itemIndices[i], tMax)) hit = true;
+                }
+                continue;
+            }
+
+            // Ближний потомок кладётся в стек последним, чтобы быстрее сократить tMax
+            float tLeft, tRight;
+            bool hitLeft  = ray.intersectBox(nodes[node.left].bounds, tMax, tLeft);
+            bool hitRight = ray.intersectBox(nodes[node.left + 1].bounds, tMax, tRight);
+
+            if (hitLeft && hitRight && tLeft <= tRight) {
+                stack[stackSize] = node.left + 1;
+                stackDistances[stackSize++] = tRight;
+                hitRight = false;
+            }
+            if (hitLeft) {
+                stack[stackSize] = node.left;
+                stackDistances[stackSize++] = tLeft;
+            }
+            if (hitRight) {
+                stack[stackSize] = node.left + 1;
+                stackDistances[stackSize++] = tRight;
+            }
+        }
+        return hit;
+    }
+};
+
+#endif // _BOUNDING_VOLUME_HIERARCHY_HPP_
@@ -5,9 +5,15 @@
 #include "Position3D.hpp"
 #include "Position2D.hpp"
 #include "Zbuffer.hpp"
+#include "Frustum.hpp"
+#include "Ray.hpp"
+#include "RasterState.hpp"
+#include "SimdKernels.hpp"
+#include "Interpolation.hpp"
 
 #include <SDL2/SDL.h>
 #include <limits>
+#include <cstdint>
 
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
@@ -20,6 +26,7 @@ class Camera3D {
 private:
     int W, H;          // Размеры экрана
     float N, F;        // Ближняя и дальняя плоскости отсечения
+    DepthEncoding depthEncoding;  // При DEPTH_REVERSE_Z дальняя плоскость уходит в бесконечность
     // Матрица вида - преобразует координаты из мирового пространства в пространство камеры
     Matrix viewMatrix;
     // Матрица проекции - преобразует координаты из пространства камеры в нормализованные координаты устройства
@@ -29,6 +36,9 @@ private:
     Position3D position;  // Позиция камеры
     float yaw = 0.0f;    // Поворот вокруг оси Y
     float pitch = 0.0f;  // Поворот вокруг оси X
+    Frustum frustum;     // Пирамида видимости в мировых координатах
+    float clipMatrix[16]; // Проекция * вид построчно, для быстрого проецирования вершин
+    uint64_t version;     // Растёт при каждом изменении вида или проекции
 
 
     std::vector<std::vector<int>> zBuffer;
@@ -38,6 +48,8 @@ private:
     }
 
     void updateMatrices() {
+        version++;
+
         // Матрица вида (View Matrix)
         // Преобразует координаты из мирового пространства в пространство камеры
         // Это достигается путем перемещения камеры в начало координат и поворота сцены в противоположном направлении
@@ -68,6 +80,11 @@ private:
         projectionMatrix.at(2, 2) = -(F + N) / (F - N);            // Масштаб по Z                                 |                0                 1.0f/tanHalfFov             0                            0         |
         projectionMatrix.at(2, 3) = -(2.0f * F * N) / (F - N);     // Перенос по Z                                 |                0                        0           -(F + N) / (F - N)    -(2.0f * F * N) / (F - N) |
         projectionMatrix.at(3, 2) = -1.0f;                         // W-координата для перспективного деления      |                0                        0                    1                            0         |     
+        if (depthEncoding == DEPTH_REVERSE_Z) {
+            // Обратная глубина с бесконечной дальней плоскостью: z / w = N / w, от 1 на ближней плоскости до 0 на бесконечности
+            projectionMatrix.at(2, 2) = 0.0f;
+            projectionMatrix.at(2, 3) = N;
+        }
         
         // Матрица экрана (Screen Matrix)
         // Преобразует нормализованные координаты устройства в экранные координаты
@@ -78,16 +95,33 @@ private:
         screenMatrix.at(1, 3) = H / 2.0f;    // Смещение по Y в центр экрана                                |    0         0      1      0     | 
         screenMatrix.at(2, 2) = 1.0f;        // Сохраняем Z-координату                                      |    0         0      0      1     |   
         screenMatrix.at(3, 3) = 1.0f;        // W-компонента                                                |                                  |  
+
+        Matrix clip = projectionMatrix * viewMatrix;
+        for (size_t row = 0; row < 4; ++row) {
+            for (size_t col = 0; col < 4; ++col) {
+                clipMatrix[row * 4 + col] = clip.at(row, col);
+            }
+        }
+        frustum.update(clip, depthEncoding == DEPTH_REVERSE_Z);
     }
 
 public:
+    // Точка в экранных координатах; w хранит 1 / w отсечения для интерполяции глубины
+    typedef struct {
+        float x;
+        float y;
+        float w;
+    } Point2D;
+
     Camera3D(int width, int height) 
         : W(width), H(height), 
           N(0.1f), F(100.0f),
+          depthEncoding(DEPTH_VIEW_W),
           viewMatrix(4, 4), 
           projectionMatrix(4, 4),
           screenMatrix(4, 4),
-          position(0.0f, 0.0f, 5.0f)  // Начальная позиция камеры
+          position(0.0f, 0.0f, 5.0f),  // Начальная позиция камеры
+          version(0)
     {
         updateMatrices();
     }
@@ -115,19 +149,75 @@ public:
         // screenPoint.printMatrix();
     }
 
+    // То же, что worldToScreen, но без временных матриц.
+    // Возвращает w отсечения (глубину вдоль взгляда), в point.w записывает 1 / w.
+    float projectPoint(float x, float y, float z, Point2D& point) const {
+        const float* m = clipMatrix;
+        float cx = m[0]  * x + m[1]  * y + m[2]  * z + m[3];
+        float cy = m[4]  * x + m[5]  * y + m[6]  * z + m[7];
+        float w  = m[12] * x + m[13] * y + m[14] * z + m[15];
+
+        // Перспективное деление
+        if (w != 0) {
+            cx /= w;
+            cy /= w;
+        }
+        point.x = W / 2.0f * cx + W / 2.0f;
+        point.y = -H / 2.0f * cy + H / 2.0f;
+        point.w = 1.0f / w;
+        return w;
+    }
+
+    // projectPoint для count вершин сразу (координаты и результаты — отдельными массивами)
+    void projectPoints(const float* x, const float* y, const float* z, size_t count,
+                       float* screenX, float* screenY, float* inverseW, float* clipW) const {
+        simdKernels().projectPoints(clipMatrix, W / 2.0f, H / 2.0f, x, y, z, count, screenX, screenY, inverseW, clipW);
+    }
+
+    // Ближняя плоскость отсечения
+    float getNear() const {
+        return N;
+    }
+
+    DepthEncoding getDepthEncoding() const {
+        return depthEncoding;
+    }
+
+    // Кодировка глубины меняет проекцию (см. DepthEncoding); буфер глубины должен использовать ту же
+    void setDepthEncoding(DepthEncoding encoding) {
+        if (encoding == depthEncoding) return;
+        depthEncoding = encoding;
+        updateMatrices();
+    }
+
     // Отрисовка линии в мировых координатах
     void drawLine(SDL_Surface* surface, const Matrix& start, const Matrix& end, uint32_t color, Zbuffer& zbuffer) {
-        float x1, y1, x2, y2, w1, w2;
-        worldToScreen(start, x1, y1, w1);
-        worldToScreen(end, x2, y2, w2);
+        Point2D a, b;
+        worldToScreen(start, a.x, a.y, a.w);
+        worldToScreen(end, b.x, b.y, b.w);
 
-        w1 = 1.0f / w1;
-        w2 = 1.0f / w2;
+        a.w = 1.0f / a.w;
+        b.w = 1.0f / b.w;
+        drawLine(surface, a, b, color, zbuffer);
+    }
+
+    // Отрисовка линии между спроецированными точками.
+    // Рисуются только пиксели внутри clip (nullptr — весь экран): так полосы и
+    // изменившиеся прямоугольники экрана растеризуются независимо.
+    // state — RasterPermutation для специализированного цикла или RasterState для общего.
+    template <typename State = OpaqueRaster>
+    void drawLine(SDL_Surface* surface, const Point2D& start, const Point2D& end, uint32_t color, Zbuffer& zbuffer,
+                  const SDL_Rect* clip = nullptr, const State& state = State()) {
+        int xMin = clip ? std::max(0, clip->x) : 0;
+        int xMax = clip ? std::min(W, clip->x + clip->w) : W;
+        int yMin = clip ? std::max(0, clip->y) : 0;
+        int yMax = clip ? std::min(H, clip->y + clip->h) : H;
+        float x1 = start.x, y1 = start.y, w1 = start.w;
+        float x2 = end.x,   y2 = end.y,   w2 = end.w;
         
         // Используем алгоритм Брезенхэма для отрисовки линии
         int   dx = abs((int)x2 - (int)x1);
         int   dy = abs((int)y2 - (int)y1);
-        float dw = abs((float)w2 - (float)w1);
 
         int   sx = x1 < x2 ? 1 : -1;
         int   sy = y1 < y2 ? 1 : -1;
@@ -141,12 +231,9 @@ public:
 
         int stepsX = 0;
         while (true) {
-            float z = 1.0f / currentW;
-            if (currentX >= 0 && currentX < W && currentY >= 0 && currentY < H) {
-                if(z < zbuffer.getValue(currentX, currentY)) {
-                    zbuffer.setValue(currentX, currentY, z);
-                    ((uint32_t*)surface->pixels)[currentY * surface->pitch/4 + currentX] = color;   
-                }
+            if (currentX >= xMin && currentX < xMax && currentY >= yMin && currentY < yMax) {
+                float z = state.interpolatesDepth() ? depthValue(state, currentW) : 0.0f;
+                plotPixel(state, surface, zbuffer, currentX, currentY, z, color);
             }
 
             if (currentX == (int)x2 && currentY == (int)y2) break;
@@ -157,7 +244,7 @@ public:
                 currentX += sx;
 
                 stepsX++;
-                currentW = w1 + sw * (float)stepsX;
+                if (state.interpolatesDepth()) currentW = w1 + sw * (float)stepsX;
                 
             }
             if (e2 < dx) {
@@ -196,7 +283,6 @@ public:
 
             // Вычисляем x_start и x_end для первой половины треугольника
             if (y < y2) {
-                std::cout << "N";
                 if(y1 != y2) {
                     x_start = (int)(x1 + (((x2 - x1) * (y - y1)) * 1.0f / (y2 - y1)));
                 } else {
@@ -212,9 +298,7 @@ public:
                 x_end = (int)(x1 + (x3 - x1) * (y - y1) / (y3 - y1));
             }
 
-            if(x_start > x_end) { std::swap(x_start, x_end); std::cout << "S"; }
-
-            std::cout << x_start << " ::: " << x_end << std::endl;
+            if(x_start > x_end) { std::swap(x_start, x_end); }
 
             // Рисуем линию от x_start до x_end
             for (int x = x_start; x <= x_end; ++x) {
@@ -225,12 +309,6 @@ public:
         }
     }
 
-    typedef struct {
-        float x;
-        float y;
-        float w;
-    } Point2D;
-
     void fillTriangleAlt(SDL_Surface* surface, const Matrix& v1, const Matrix& v2, const Matrix& v3, uint32_t color, Zbuffer& zbuffer) {
         float x1, y1, x2, y2, x3, y3, w1, w2, w3;
         worldToScreen(v1, x1, y1, w1);
@@ -255,6 +333,44 @@ public:
         bot.y = y3;
         bot.w = w3;
 
+        fillTriangle(surface, top, mid, bot, color, zbuffer);
+    }
+
+    // Строка треугольника: пиксели x = xFirst, xFirst + 1, ... пока x < xLimit.
+    // Непрозрачная заливка 32-битной поверхности с записью глубины идёт векторным ядром.
+    template <typename State>
+    void fillSpan(const State& state, const SimdKernels& kernels, SDL_Surface* surface, Zbuffer& zbuffer,
+                  int y, int xFirst, float xLimit, const Point2D& left, float wStep, uint32_t color) {
+        countSpan(state);
+        if (state.depth == DEPTH_TEST_WRITE && state.blend == BLEND_REPLACE && state.pixels == PIXELS_32 && !countsRaster(state)) {
+            if (!(xFirst < xLimit)) return;
+            int count = (int)std::ceil(xLimit) - xFirst;
+            uint32_t* row = (uint32_t*)((uint8_t*)surface->pixels + y * surface->pitch);
+            auto kernel = state.encoding == DEPTH_REVERSE_Z ? kernels.fillSpanReverse : kernels.fillSpan;
+            kernel(row + xFirst, zbuffer.getRow(y) + xFirst, xFirst, count, left.x, left.w, wStep, color);
+            return;
+        }
+        for (int x = xFirst; x < xLimit; x++) {
+            float z = 0.0f;
+            if (state.interpolatesDepth()) {
+                float xSteps = x - left.x;
+                float w = left.w + xSteps * wStep;
+                z = depthValue(state, w);
+            }
+            plotPixel(state, surface, zbuffer, x, y, z, color);
+        }
+    }
+
+    // Обход треугольника по строкам: span(y, xFirst, xLimit, left, wStep) для каждой строки,
+    // где left — левый край строки (x и 1 / w), wStep — шаг 1 / w вдоль x.
+    // Затрагиваются только строки и столбцы внутри clip (nullptr — весь экран).
+    template <typename Span>
+    void scanTriangle(SDL_Surface* surface, Point2D top, Point2D mid, Point2D bot, const SDL_Rect* clip, Span&& span) {
+        int clipLeft   = clip ? clip->x : 0;
+        int clipRight  = clip ? clip->x + clip->w : std::numeric_limits<int>::max();
+        int clipTop    = clip ? clip->y : 0;
+        int clipBottom = clip ? clip->y + clip->h : std::numeric_limits<int>::max();
+
         // Отсортируем вершины вертикально
         if(mid.y < top.y) {
             std::swap(mid, top);
@@ -305,7 +421,7 @@ public:
             float yStart = std::max(0.0f, top.y);
             float yEnd   = std::min(float(surface->h - 1.0f), mid.y);
             
-            for(int y = yStart + 1; y < yEnd; y++) {
+            for(int y = std::max((int)(yStart + 1), clipTop); y < std::min(yEnd, (float)clipBottom); y++) {
                 float ySteps = y - top.y;
 
                 Point2D left;
@@ -323,21 +439,7 @@ public:
                     float xStart = std::max(0.0f, left.x);
                     float xEnd   = std::min(right.x, float(surface->w));
 
-                    for(int x = xStart + 1; x < xEnd; x++) { 
-                        float xSteps = x - left.x;
-                        float w = left.w + xSteps * wStep;
-                        float z = 1.0f / w;
-                        
-                        
-                        if(z < zbuffer.getValue(x, y)) {
-                            // std::cout << "(x, y): " << x << " " << y << " -- " << z << " vs " << zbuffer.getValue(x, y) << std::endl;
-                            zbuffer.setValue(x, y, z);
-                            // std::cout << " after " << zbuffer.getValue(x, y) << std::endl;
-                        } else {
-                            continue;
-                        }
-                        ((uint32_t*)surface->pixels)[y * surface->pitch / 4 + x] = color;
-                    }
+                    span(y, std::max((int)(xStart + 1), clipLeft), std::min(xEnd, (float)clipRight), left, wStep);
                 }
             }
         }
@@ -354,7 +456,7 @@ public:
             float yStart = std::max(0.0f, mid.y);
             float yEnd   = std::min(surface->h - 1.0f, bot.y);
             
-            for(int y = yStart + 1; y < yEnd; y++) {
+            for(int y = std::max((int)(yStart + 1), clipTop); y < std::min(yEnd, (float)clipBottom); y++) {
                 float ySteps = y - mid.y;
 
                 Point2D left;
@@ -371,23 +473,49 @@ public:
                     float xStart = std::max(0.0f, left.x);
                     float xEnd   = std::min(right.x, float(surface->w));
 
-                    for(int x = xStart + 1; x < xEnd; x++) { 
-                        float xSteps = x - left.x;
-                        float w = left.w + xSteps * wStep;
-                        float z = 1.0f / w;
-
-                        if(z < zbuffer.getValue(x, y)) {
-                            zbuffer.setValue(x, y, z);
-                        } else {
-                            continue;
-                        }
-                        ((uint32_t*)surface->pixels)[y * surface->pitch / 4 + x] = color;
-                    }
+                    span(y, std::max((int)(xStart + 1), clipLeft), std::min(xEnd, (float)clipRight), left, wStep);
                 }
             }
         }
     }
 
+    // Заливка треугольника по спроецированным вершинам одним цветом.
+    // Заполняются только пиксели внутри clip (nullptr — весь экран); глубина и цвет — по state, как в drawLine.
+    template <typename State = OpaqueRaster>
+    void fillTriangle(SDL_Surface* surface, Point2D top, Point2D mid, Point2D bot, uint32_t color, Zbuffer& zbuffer,
+                      const SDL_Rect* clip = nullptr, const State& state = State()) {
+        const SimdKernels& kernels = simdKernels();
+        scanTriangle(surface, top, mid, bot, clip, [&](int y, int xFirst, float xLimit, const Point2D& left, float wStep) {
+            fillSpan(state, kernels, surface, zbuffer, y, xFirst, xLimit, left, wStep, color);
+        });
+    }
+
+    // Треугольник с Count атрибутами вершин (values0..values2), интерполированными с учётом перспективы.
+    // Цвет видимого пикселя — shader(values, w): values — интерполированные a / w, w — глубина пикселя,
+    // так что сам атрибут равен values[i] * w. Глубина берётся из той же плоскости 1 / w, что и атрибуты;
+    // при DEPTH_REVERSE_Z w обращается только для пикселей, прошедших проверку глубины.
+    // Отсечение по clip и state — как у fillTriangle.
+    template <int Count, typename Shader, typename State = OpaqueRaster>
+    void shadeTriangle(SDL_Surface* surface, const Point2D& p0, const Point2D& p1, const Point2D& p2,
+                       const float* values0, const float* values1, const float* values2, const Shader& shader,
+                       Zbuffer& zbuffer, const SDL_Rect* clip = nullptr, const State& state = State()) {
+        AttributePlanes<Count> planes;
+        if (!planes.setup(p0.x, p0.y, p0.w, values0, p1.x, p1.y, p1.w, values1, p2.x, p2.y, p2.w, values2)) return;
+
+        scanTriangle(surface, p0, p1, p2, clip, [&](int y, int xFirst, float xLimit, const Point2D&, float) {
+            countSpan(state);
+            float values[Count];
+            float inverseW;
+            planes.start((float)xFirst, (float)y, values, inverseW);
+            for (int x = xFirst; x < xLimit; x++) {
+                if (passDepth(state, zbuffer, x, y, depthValue(state, inverseW))) {
+                    writeColor(state, surface, x, y, shader(values, 1.0f / inverseW));
+                }
+                planes.step(values, inverseW);
+            }
+        });
+    }
+
 
     // Отрисовка координатных осей
     void drawAxes(SDL_Surface* surface, Zbuffer zbuffer) {
@@ -429,6 +557,23 @@ public:
         drawLine(surface, origin, negZAxis, 0x000080, zbuffer);  // Темно-синяя ось -Z
     }
 
+    // Отрисовка координатных осей внутри clip с общим буфером глубины
+    template <typename State = OpaqueRaster>
+    void drawAxes(SDL_Surface* surface, Zbuffer& zbuffer, const SDL_Rect* clip, const State& state = State()) {
+        static const struct { float x, y, z; uint32_t color; } axes[] = {
+            { 2.0f, 0.0f, 0.0f, 0xFF0000}, {0.0f,  2.0f, 0.0f, 0x00FF00}, {0.0f, 0.0f,  2.0f, 0x0000FF},
+            {-2.0f, 0.0f, 0.0f, 0x800000}, {0.0f, -2.0f, 0.0f, 0x008000}, {0.0f, 0.0f, -2.0f, 0x000080}
+        };
+
+        Point2D origin;
+        projectPoint(0.0f, 0.0f, 0.0f, origin);
+        for (const auto& axis : axes) {
+            Point2D end;
+            projectPoint(axis.x, axis.y, axis.z, end);
+            drawLine(surface, origin, end, axis.color, zbuffer, clip, state);
+        }
+    }
+
     void setScreenSize(int width, int height) {
         W = width;
         H = height;
@@ -464,11 +609,37 @@ public:
         updateMatrices();
     }
 
+    // Версия вида и проекции: совпадение означает, что камера не менялась
+    uint64_t getVersion() const {
+        return version;
+    }
+
     // Получение позиции камеры
     Position3D getPosition() const {
         return position;
     }
 
+    const Frustum& getFrustum() const {
+        return frustum;
+    }
+
+    // Луч из позиции камеры через точку экрана (обратная проекция)
+    Ray screenRay(float screenX, float screenY) const {
+        // Нормализованные координаты устройства
+        float ndcX = (screenX - W / 2.0f) / (W / 2.0f);
+        float ndcY = (H / 2.0f - screenY) / (H / 2.0f);
+
+        // Направление в пространстве камеры: камера смотрит вдоль -Z
+        Matrix direction(4, 1);
+        direction.at(0, 0) = ndcX / projectionMatrix.at(0, 0);
+        direction.at(1, 0) = ndcY / projectionMatrix.at(1, 1);
+        direction.at(2, 0) = -1.0f;
+
+        // Обратный поворот вида: (Rx(pitch) * Ry(yaw))^-1 = Ry(-yaw) * Rx(-pitch)
+        Matrix world = Matrix::rotationY(-yaw) * (Matrix::rotationX(-pitch) * direction);
+        return Ray(position, Position3D(world.at(0, 0), world.at(1, 0), world.at(2, 0)));
+    }
+
 };
 
 #endif // _CAMERA_3D_HPP_
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef _COMMAND_QUEUE_HPP_
+#define _COMMAND_QUEUE_HPP_
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+// Очередь без блокировок для одного писателя и одного читателя (SPSC).
+//
+// Кольцевой буфер фиксированной ёмкости (степень двойки). Писатель двигает только tail,
+// читатель — только head, поэтому достаточно пары атомарных индексов
+// с семантикой release/acquire. Индексы разнесены по строкам кэша.
+template <typename T>
+class CommandQueue {
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    alignas(64) std::atomic<size_t> head;  // Следующий элемент для чтения
+    alignas(64) std::atomic<size_t> tail;  // Следующая свободная ячейка
+
+public:
+    explicit CommandQueue(size_t capacity = 1024) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    // Вызывается только писателем. false — очередь заполнена.
+    bool push(const T& value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+        slots[currentTail & mask] = value;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Вызывается только читателем. false — очередь пуста.
+    bool pop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[currentHead & mask];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+};
+
+#endif // _COMMAND_QUEUE_HPP_
@@ -0,0 +1,108 @@
+#ifndef _DIRTY_REGION_HPP_
+#define _DIRTY_REGION_HPP_
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+#include <cstdint>
+
+// Изменившаяся часть кадра: небольшой набор непересекающихся прямоугольников.
+//
+// Пересекающиеся прямоугольники сливаются в охватывающий. Если прямоугольников
+// становится больше MAX_RECTS, сливается пара с наименьшим приростом площади:
+// лишние пиксели дешевле, чем длинный список мелких областей.
+class DirtyRegion {
+private:
+    static const size_t MAX_RECTS = 16;
+
+    std::vector<SDL_Rect> rects;
+
+    static int64_t area(const SDL_Rect& rect) {
+        return (int64_t)rect.w * rect.h;
+    }
+
+    // Слияние прямоугольника index со всеми, которые он пересекает, пока такие есть
+    void absorb(size_t index) {
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (size_t i = 0; i < rects.size(); ++i) {
+                if (i == index || !SDL_HasIntersection(&rects[i], &rects[index])) continue;
+                SDL_UnionRect(&rects[i], &rects[index], &rects[index]);
+                rects[i] = rects.back();
+                rects.pop_back();
+                if (index == rects.size()) index = i;
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    void limit() {
+        while (rects.size() > MAX_RECTS) {
+            size_t bestA = 0, bestB = 1;
+            int64_t bestGrowth = INT64_MAX;
+            for (size_t a = 0; a < rects.size(); ++a) {
+                for (size_t b = a + 1; b < rects.size(); ++b) {
+                    SDL_Rect joined;
+                    SDL_UnionRect(&rects[a], &rects[b], &joined);
+                    int64_t growth = area(joined) - area(rects[a]) - area(rects[b]);
+                    if (growth < bestGrowth) {
+                        bestGrowth = growth;
+                        bestA = a;
+                        bestB = b;
+                    }
+                }
+            }
+            SDL_UnionRect(&rects[bestA], &rects[bestB], &rects[bestA]);
+            rects[bestB] = rects.back();
+            rects.pop_back();
+            absorb(bestA);
+        }
+    }
+
+public:
+    void clear() {
+        rects.clear();
+    }
+
+    bool empty() const {
+        return rects.empty();
+    }
+
+    const std::vector<SDL_Rect>& getRects() const {
+        return rects;
+    }
+
+    // Суммарная площадь в пикселях
+    int64_t getArea() const {
+        int64_t total = 0;
+        for (const SDL_Rect& rect : rects) total += area(rect);
+        return total;
+    }
+
+    void add(const SDL_Rect& rect) {
+        if (rect.w <= 0 || rect.h <= 0) return;
+        rects.push_back(rect);
+        absorb(rects.size() - 1);
+        limit();
+    }
+
+    void add(const DirtyRegion& other) {
+        for (const SDL_Rect& rect : other.rects) add(rect);
+    }
+
+    bool intersects(const SDL_Rect& rect) const {
+        for (const SDL_Rect& own : rects) {
+            if (SDL_HasIntersection(&own, &rect)) return true;
+        }
+        return false;
+    }
+
+    // Весь кадр одним прямоугольником
+    void setFull(int width, int height) {
+        rects.assign(1, SDL_Rect{ 0, 0, width, height });
+    }
+};
+
+#endif // _DIRTY_REGION_HPP_
@@ -0,0 +1,87 @@
+#ifndef _FRAME_SCHEDULER_HPP_
+#define _FRAME_SCHEDULER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// Статистика кадров за интервал наблюдения
+struct FrameStats {
+    uint32_t frames = 0;
+    uint64_t totalFrameNs = 0;  // Суммарное время подготовки кадров
+    uint64_t maxFrameNs = 0;
+    uint64_t wallNs = 0;        // Длительность интервала наблюдения
+
+    double fps() const {
+        return wallNs ? frames * 1e9 / wallNs : 0.0;
+    }
+
+    double averageFrameMs() const {
+        return frames ? totalFrameNs / 1e6 / frames : 0.0;
+    }
+
+    double maxFrameMs() const {
+        return maxFrameNs / 1e6;
+    }
+
+    // Доля интервала, когда поток не готовил кадры
+    double idlePercent() const {
+        return wallNs ? 100.0 * (1.0 - std::min(1.0, (double)totalFrameNs / wallNs)) : 100.0;
+    }
+};
+
+// Темп кадров: не чаще одного кадра за период обновления дисплея
+// и не чаще заданного ограничения FPS. Кадр рисуется только когда есть изменения,
+// поэтому в простое поток отрисовки спит, а за время ожидания очередного периода
+// изменения успевают накопиться и попадают в один кадр.
+class FrameScheduler {
+private:
+    std::atomic<uint64_t> intervalNs;
+    uint64_t nextFrameNs;
+
+    std::mutex statsMutex;  // Статистику пишет поток отрисовки, забирает основной
+    FrameStats stats;
+    uint64_t statsStartNs;
+
+public:
+    FrameScheduler() : intervalNs(0), nextFrameNs(0), statsStartNs(0) {}
+
+    // displayRate — частота обновления дисплея (0 — неизвестна), maxFps — ограничение (0 — нет)
+    void setRate(double displayRate, double maxFps) {
+        double rate = displayRate > 0.0 ? displayRate : 60.0;
+        if (maxFps > 0.0) rate = std::min(rate, maxFps);
+        intervalNs.store((uint64_t)(1e9 / rate));
+    }
+
+    uint64_t getIntervalNs() const {
+        return intervalNs.load();
+    }
+
+    // Самый ранний момент начала следующего кадра
+    uint64_t getNextFrameTime() const {
+        return nextFrameNs;
+    }
+
+    void frameFinished(uint64_t startNs, uint64_t endNs) {
+        nextFrameNs = startNs + intervalNs.load();
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if (!statsStartNs) statsStartNs = startNs;
+        stats.frames++;
+        stats.totalFrameNs += endNs - startNs;
+        stats.maxFrameNs = std::max(stats.maxFrameNs, endNs - startNs);
+    }
+
+    // Статистика с прошлого вызова; начинает новый интервал наблюдения
+    FrameStats takeStats(uint64_t nowNs) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        FrameStats result = stats;
+        result.wallNs = statsStartNs && nowNs > statsStartNs ? nowNs - statsStartNs : 0;
+        stats = FrameStats();
+        statsStartNs = nowNs;
+        return result;
+    }
+};
+
+#endif // _FRAME_SCHEDULER_HPP_
@@ -0,0 +1,87 @@
+#ifndef _FRUSTUM_HPP_
+#define _FRUSTUM_HPP_
+
+#include <cmath>
+
+#include "Matrix.hpp"
+#include "BoundingBox.hpp"
+
+// Пирамида видимости камеры: шесть плоскостей в мировых координатах.
+// Точка внутри, если a*x + b*y + c*z + d >= 0 для всех плоскостей.
+class Frustum {
+public:
+    enum Classification {
+        OUTSIDE,     // Полностью вне пирамиды
+        INTERSECTS,  // Пересекает границу
+        INSIDE       // Полностью внутри
+    };
+
+private:
+    struct Plane {
+        float a, b, c, d;
+    };
+    Plane planes[6];
+
+public:
+    Frustum() {
+        for (auto& plane : planes) {
+            plane = {0.0f, 0.0f, 0.0f, 1.0f};
+        }
+    }
+
+    // Извлечение плоскостей из матрицы проекция * вид (метод Gribb/Hartmann).
+    // Обычно видимая глубина -w <= z <= w; при reversedDepth 0 <= z <= w (обратная глубина),
+    // и плоскость z >= 0 вырождается в «всегда внутри», если дальняя плоскость бесконечна.
+    void update(const Matrix& viewProjection, bool reversedDepth = false) {
+        for (int i = 0; i < 3; ++i) {
+            for (int sign = 0; sign < 2; ++sign) {
+                float s = sign ? -1.0f : 1.0f;
+                float wScale = (i == 2 && reversedDepth && sign == 0) ? 0.0f : 1.0f;
+                Plane& plane = planes[i * 2 + sign];
+                plane.a = wScale * viewProjection.at(3, 0) + s * viewProjection.at(i, 0);
+                plane.b = wScale * viewProjection.at(3, 1) + s * viewProjection.at(i, 1);
+                plane.c = wScale * viewProjection.at(3, 2) + s * viewProjection.at(i, 2);
+                plane.d = wScale * viewProjection.at(3, 3) + s * viewProjection.at(i, 3);
+
+                float length = std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+                if (length != 0) {
+                    plane.a /= length;
+                    plane.b /= length;
+                    plane.c /= length;
+                    plane.d /= length;
+                }
+            }
+        }
+    }
+
+    // Классификация параллелепипеда относительно пирамиды (тест p/n-вершин)
+    Classification classify(const BoundingBox& box) const {
+        if (box.isEmpty()) return OUTSIDE;
+
+        Classification result = INSIDE;
+        for (const auto& plane : planes) {
+            // Вершина, дальше всех лежащая по направлению нормали
+            float px = plane.a >= 0 ? box.max.getX() : box.min.getX();
+            float py = plane.b >= 0 ? box.max.getY() : box.min.getY();
+            float pz = plane.c >= 0 ? box.max.getZ() : box.min.getZ();
+            if (plane.a * px + plane.b * py + plane.c * pz + plane.d < 0) {
+                return OUTSIDE;
+            }
+
+            // Противоположная вершина
+            float nx = plane.a >= 0 ? box.min.getX() : box.max.getX();
+            float ny = plane.b >= 0 ? box.min.getY() : box.max.getY();
+            float nz = plane.c >= 0 ? box.min.getZ() : box.max.getZ();
+            if (plane.a * nx + plane.b * ny + plane.c * nz + plane.d < 0) {
+                result = INTERSECTS;
+            }
+        }
+        return result;
+    }
+
+    bool intersects(const BoundingBox& box) const {
+        return classify(box) != OUTSIDE;
+    }
+};
+
+#endif // _FRUSTUM_HPP_
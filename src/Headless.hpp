@@ -0,0 +1,266 @@
+#ifndef _HEADLESS_HPP_
+#define _HEADLESS_HPP_
+
+#include "Scene3D.hpp"
+#include "ImageFile.hpp"
+#include "JobSystem.hpp"
+#include "PerformanceHud.hpp"
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Пакетная отрисовка без окна и видеоподсистемы SDL: кадры рисуются во внеэкранную поверхность
+// и, если задан вывод, записываются в файлы или в stdout. Время кадров печатается в stderr,
+// чтобы не смешиваться с изображениями в stdout.
+struct HeadlessOptions {
+    int width = 1920;
+    int height = 1024;
+    int frames = 1;
+    std::string output;          // Шаблон имени с %d (номер кадра), "-" — stdout, пусто — не записывать
+    ImageFormat format = IMAGE_PPM;
+    bool verbose = true;         // Время каждого кадра, а не только итог
+    bool stats = false;          // Счётчики отбора и растеризации каждого кадра (см. RenderStats)
+    bool overdraw = false;       // Рисовать тепловую карту перерисовки вместо изображения
+    bool hud = false;            // Панель производительности поверх кадров
+    bool allocations = false;    // Выделения памяти каждого кадра по этапам (сборка с ALLOCS=1)
+    std::string replay;          // Запись ввода окна (--record), которая ведёт сцену; размер и число кадров — из неё
+    bool realtime = false;       // Воспроизводить запись в темпе записи, а не как можно быстрее
+    std::string report;          // CSV со временем и счётчиками каждого кадра, пусто — не писать
+    std::string scene;           // Нагрузочная сцена вместо демонстрационной (см. StressScene.hpp), пусто — нет
+};
+
+// Разбор командной строки: --headless [--size WxH] [--frames N] [--output PATH] [--format ppm|bmp|raw] [--quiet]
+// [--stats] [--overdraw] [--hud] [--allocs] [--replay PATH] [--realtime] [--report PATH] [--scene SPEC].
+// false — пакетный режим не запрошен. При ошибке в аргументах error получает описание.
+inline bool parseHeadlessOptions(int argc, char** args, HeadlessOptions& options, std::string& error) {
+    bool headless = false;
+    bool formatGiven = false;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = args[i];
+        if (strcmp(arg, "--headless") == 0) {
+            headless = true;
+            continue;
+        }
+        if (strcmp(arg, "--quiet") == 0) {
+            options.verbose = false;
+            continue;
+        }
+        if (strcmp(arg, "--stats") == 0) {
+            options.stats = true;
+            continue;
+        }
+        if (strcmp(arg, "--overdraw") == 0) {
+            options.overdraw = true;
+            continue;
+        }
+        if (strcmp(arg, "--hud") == 0) {
+            options.hud = true;
+            continue;
+        }
+        if (strcmp(arg, "--allocs") == 0) {
+            options.allocations = true;
+            continue;
+        }
+        if (strcmp(arg, "--realtime") == 0) {
+            options.realtime = true;
+            continue;
+        }
+        bool known = strcmp(arg, "--size") == 0 || strcmp(arg, "--frames") == 0
+                  || strcmp(arg, "--output") == 0 || strcmp(arg, "--format") == 0
+                  || strcmp(arg, "--replay") == 0 || strcmp(arg, "--report") == 0
+                  || strcmp(arg, "--scene") == 0;
+        if (!known) {
+            error = std::string("unknown option ") + arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            error = std::string("missing value for ") + arg;
+            break;
+        }
+        const char* value = args[++i];
+        if (strcmp(arg, "--size") == 0) {
+            if (sscanf(value, "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0) {
+                error = std::string("bad size ") + value;
+            }
+        } else if (strcmp(arg, "--frames") == 0) {
+            options.frames = atoi(value);
+            if (options.frames <= 0) error = std::string("bad frame count ") + value;
+        } else if (strcmp(arg, "--output") == 0) {
+            options.output = value;
+        } else if (strcmp(arg, "--replay") == 0) {
+            options.replay = value;
+        } else if (strcmp(arg, "--report") == 0) {
+            options.report = value;
+        } else if (strcmp(arg, "--scene") == 0) {
+            options.scene = value;
+        } else {
+            if (!imageFormatFromName(value, options.format)) error = std::string("unknown format ") + value;
+            formatGiven = true;
+        }
+    }
+    // Без --format формат берётся из расширения вывода, если оно известно
+    if (!formatGiven && !options.output.empty() && options.output != "-") {
+        imageFormatFromName(options.output.c_str(), options.format);
+    }
+    return headless;
+}
+
+// Имя файла кадра по шаблону: первое "%d" или "%Nd"/"%0Nd" заменяется номером кадра, дополненным
+// до ширины N пробелами или нулями. Остальные "%" остаются как есть.
+// Без номера в шаблоне к имени перед расширением добавляется "_N", чтобы кадры не затирали друг друга.
+inline std::string headlessFramePath(const std::string& pattern, int frame, int frames) {
+    for (size_t percent = pattern.find('%'); percent != std::string::npos; percent = pattern.find('%', percent + 1)) {
+        size_t end = percent + 1;
+        bool zeros = end < pattern.size() && pattern[end] == '0';
+        if (zeros) end++;
+        size_t width = 0;
+        while (end < pattern.size() && pattern[end] >= '0' && pattern[end] <= '9') {
+            width = std::min<size_t>(width * 10 + (pattern[end] - '0'), 64);
+            end++;
+        }
+        if (end >= pattern.size() || pattern[end] != 'd') continue;
+        std::string number = std::to_string(frame);
+        if (number.size() < width) number.insert(0, width - number.size(), zeros ? '0' : ' ');
+        return pattern.substr(0, percent) + number + pattern.substr(end + 1);
+    }
+    if (frames == 1) return pattern;
+    size_t dot = pattern.rfind('.');
+    size_t slash = pattern.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = pattern.size();
+    return pattern.substr(0, dot) + "_" + std::to_string(frame) + pattern.substr(dot);
+}
+
+// Строка отчёта --report: время этапов и счётчики кадра, столбцы — см. заголовок в runHeadless
+inline void writeHeadlessReport(FILE* file, int frame, double renderMs, double redrawn, const RenderStats& stats) {
+    fprintf(file, "%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.2f,%llu,%llu\n", frame, renderMs, stats.updateNs / 1e6,
+            stats.cullNs / 1e6, stats.sortNs / 1e6, stats.rasterNs / 1e6, stats.presentNs / 1e6, redrawn,
+            (unsigned long long)stats.trianglesSubmitted, (unsigned long long)stats.trianglesRasterized);
+}
+
+// Отрисовка options.frames кадров scene. advance(frame) вызывается перед каждым кадром
+// и меняет сцену так же, как это делали бы команды интерактивного режима; если при этом
+// меняется размер сцены, поверхность кадров пересоздаётся под него. Возвращает код выхода.
+inline int runHeadless(Scene3D& scene, const HeadlessOptions& options, const std::function<void(int)>& advance) {
+    if (scene.getWidth() != options.width || scene.getHeight() != options.height) {
+        scene.resize(options.width, options.height);
+    }
+    // Тот же формат, что у буфера кадра сцены, поэтому сцена рисует прямо в поверхность
+    SDL_Surface* target = SDL_CreateRGBSurface(0, options.width, options.height, 32, 0, 0, 0, 0);
+    if (!target) {
+        fprintf(stderr, "headless: cannot create %dx%d surface: %s\n", options.width, options.height, SDL_GetError());
+        return 1;
+    }
+
+    if (options.allocations && !AllocationTracker::compiledIn()) {
+        fprintf(stderr, "headless: --allocs needs a build with allocation tracking (make ALLOCS=1)\n");
+        return 2;
+    }
+    if (options.stats) scene.setRasterStatsEnabled(true);
+    if (options.overdraw) scene.setRenderMode(RENDER_OVERDRAW);
+
+    FILE* report = nullptr;
+    if (!options.report.empty()) {
+        report = fopen(options.report.c_str(), "w");
+        if (!report) {
+            fprintf(stderr, "headless: cannot write %s\n", options.report.c_str());
+            SDL_FreeSurface(target);
+            return 1;
+        }
+        fprintf(report, "frame,render_ms,update_ms,cull_ms,sort_ms,raster_ms,present_ms,redrawn_percent,"
+                        "triangles_submitted,triangles_rasterized\n");
+    }
+
+    PerformanceHud hud;
+    std::vector<double> frameMs;
+    double writeMs = 0.0;
+    int status = 0;
+    for (int frame = 0; frame < options.frames; ++frame) {
+        advance(frame);
+        if (scene.getWidth() != target->w || scene.getHeight() != target->h) {
+            SDL_FreeSurface(target);
+            target = SDL_CreateRGBSurface(0, scene.getWidth(), scene.getHeight(), 32, 0, 0, 0, 0);
+            if (!target) {
+                fprintf(stderr, "headless: cannot create %dx%d surface: %s\n", scene.getWidth(), scene.getHeight(),
+                        SDL_GetError());
+                status = 1;
+                break;
+            }
+        }
+
+        AllocationSnapshot beforeFrame;
+        if (options.allocations) beforeFrame = AllocationTracker::instance().snapshot();
+        uint64_t start = JobSystem::nowNs();
+        scene.render(target);
+        uint64_t rendered = JobSystem::nowNs();
+        if (options.allocations) {
+            fprintf(stderr, "frame %d: ", frame);
+            AllocationTracker::instance().snapshot().since(beforeFrame).print(stderr);
+        }
+        frameMs.push_back((rendered - start) / 1e6);
+        if (options.hud) {
+            hud.addFrame(frameMs.back(), scene.getStats());
+            scene.invalidateTarget(target, hud.draw(target));
+        }
+
+        if (!options.output.empty()) {
+            bool ok;
+            if (options.output == "-") {
+                ok = writeImage(stdout, target, options.format) && fflush(stdout) == 0;
+            } else {
+                ok = saveImage(headlessFramePath(options.output, frame, options.frames).c_str(), target, options.format);
+            }
+            if (!ok) {
+                fprintf(stderr, "headless: cannot write frame %d\n", frame);
+                status = 1;
+                break;
+            }
+            writeMs += (JobSystem::nowNs() - rendered) / 1e6;
+        }
+
+        double redrawn = 100.0 * scene.getDamage().getArea() / ((double)target->w * target->h);
+        if (options.verbose) {
+            fprintf(stderr, "frame %d: %.3f ms, redrawn %.1f%%\n", frame, frameMs.back(), redrawn);
+        }
+        if (report) writeHeadlessReport(report, frame, frameMs.back(), redrawn, scene.getStats());
+        if (options.stats) {
+            const RenderStats& stats = scene.getStats();
+            fprintf(stderr, "frame %d: triangles %llu submitted, %llu culled, %llu near-rejected, %llu rasterized; "
+                            "%llu spans, pixels %llu tested, %llu passed, %llu written, %.3f MB touched\n",
+                    frame, (unsigned long long)stats.trianglesSubmitted, (unsigned long long)stats.trianglesCulled,
+                    (unsigned long long)stats.trianglesNearRejected, (unsigned long long)stats.trianglesRasterized,
+                    (unsigned long long)stats.raster.spans, (unsigned long long)stats.raster.pixelsTested,
+                    (unsigned long long)stats.raster.pixelsPassed, (unsigned long long)stats.raster.pixelsWritten,
+                    stats.raster.bytesTouched / 1e6);
+        }
+    }
+
+    if (!frameMs.empty()) {
+        std::vector<double> sorted = frameMs;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (double ms : frameMs) total += ms;
+        auto percentile = [&](double p) { return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))]; };
+        fprintf(stderr, "%zu frames %dx%d (%s): average %.3f ms, median %.3f ms, p90 %.3f ms, p99 %.3f ms, "
+                        "min %.3f ms, max %.3f ms, %.1f fps",
+                frameMs.size(), options.width, options.height, simdKernels().name, total / frameMs.size(),
+                sorted[sorted.size() / 2], percentile(0.9), percentile(0.99), sorted.front(), sorted.back(),
+                total > 0.0 ? frameMs.size() * 1e3 / total : 0.0);
+        if (!options.output.empty()) fprintf(stderr, ", writing %.3f ms per frame", writeMs / frameMs.size());
+        fprintf(stderr, "\n");
+    }
+
+    if (report && fclose(report) != 0) {
+        fprintf(stderr, "headless: cannot write %s\n", options.report.c_str());
+        status = 1;
+    }
+    if (target) SDL_FreeSurface(target);
+    return status;
+}
+
+#endif // _HEADLESS_HPP_
@@ -5,16 +5,43 @@
 #include <algorithm>
 #include "Polygon3D.hpp"
 #include "Position3D.hpp"
+#include "SimdKernels.hpp"
 
 class HiddenSurfaceRemoval {
 private:
     std::vector<Polygon3D> polygons;
     std::vector<Position3D> vertices;
 
+    // Нормали и первые вершины полигонов покомпонентно — для отбора всех граней одним ядром
+    std::vector<float> normalX, normalY, normalZ;
+    std::vector<float> pointX, pointY, pointZ;
+
+    void storeCullData(size_t index) {
+        const Polygon3D& polygon = polygons[index];
+        Position3D point;
+        if (!polygon.vertexIndices.empty() && (size_t)polygon.vertexIndices[0] < vertices.size()) {
+            point = vertices[polygon.vertexIndices[0]];
+        }
+        normalX[index] = polygon.normal.getX();
+        normalY[index] = polygon.normal.getY();
+        normalZ[index] = polygon.normal.getZ();
+        pointX[index] = point.getX();
+        pointY[index] = point.getY();
+        pointZ[index] = point.getZ();
+    }
+
+    void resizeCullData() {
+        for (std::vector<float>* component : { &normalX, &normalY, &normalZ, &pointX, &pointY, &pointZ }) {
+            component->resize(polygons.size());
+        }
+    }
+
 public:
     // Добавление полигона
     void addPolygon(const std::vector<int>& vertexIndices) {
         polygons.emplace_back(vertexIndices);
+        resizeCullData();
+        storeCullData(polygons.size() - 1);
     }
 
     // Установка вершин
@@ -22,12 +49,21 @@ public:
         vertices = newVertices;
     }
 
+    // Обмен вершин с буфером вызывающего: без копирования, buffer получает прежние вершины
+    void swapVertices(std::vector<Position3D>& buffer) {
+        vertices.swap(buffer);
+    }
+
     // Обновление данных полигонов
     void updatePolygons() {
         for (auto& polygon : polygons) {
             polygon.calculateNormal(vertices);
             polygon.calculateAverageZ(vertices);
         }
+        resizeCullData();
+        for (size_t i = 0; i < polygons.size(); ++i) {
+            storeCullData(i);
+        }
     }
 
     // Сортировка полигонов по Z (алгоритм художника)
@@ -93,6 +129,27 @@ public:
         return ((dotProduct > 0) && (polygon.size() % 2 == 0)) || ((dotProduct > 0) && (polygon.size() % 2 != 0));
     }
 
+    // Проверка видимости полигона по индексу, без копирования полигона
+    bool isPolygonVisible(size_t index, const Position3D& cameraPos) const {
+        const Polygon3D& polygon = polygons[index];
+        Position3D toCamera = cameraPos - vertices[polygon.vertexIndices[0]];
+        return polygon.normal.dot(toCamera) > 0;
+    }
+
+    // isPolygonVisible(i, cameraPos) для всех полигонов: visible[i] = 1, если полигон лицевой
+    void cullBackFaces(const Position3D& cameraPos, std::vector<uint8_t>& visible) const {
+        visible.resize(polygons.size());
+        if (polygons.empty()) return;
+        simdKernels().cullBackFaces(normalX.data(), normalY.data(), normalZ.data(),
+                                    pointX.data(), pointY.data(), pointZ.data(), polygons.size(),
+                                    cameraPos.getX(), cameraPos.getY(), cameraPos.getZ(), visible.data());
+    }
+
+    // Нормаль полигона в мировых координатах (после updatePolygons)
+    const Position3D& getNormal(size_t index) const {
+        return polygons[index].normal;
+    }
+
     std::vector<Polygon3D> getPolygons()
     {
         return polygons;
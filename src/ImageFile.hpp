@@ -0,0 +1,77 @@
+#ifndef _IMAGE_FILE_HPP_
+#define _IMAGE_FILE_HPP_
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Формат кадра на диске или в потоке
+enum ImageFormat {
+    IMAGE_PPM,  // Двоичный PPM (P6): заголовок и RGB по байту на канал
+    IMAGE_BMP,  // BMP средствами SDL
+    IMAGE_RAW   // Пиксели поверхности без заголовка и выравнивания строк (для 32 бит — BGRX в памяти)
+};
+
+// Формат по имени ("ppm", "bmp", "raw") или по расширению пути. false — неизвестный.
+inline bool imageFormatFromName(const char* name, ImageFormat& format) {
+    const char* dot = strrchr(name, '.');
+    if (dot) name = dot + 1;
+    if (strcmp(name, "ppm") == 0) format = IMAGE_PPM;
+    else if (strcmp(name, "bmp") == 0) format = IMAGE_BMP;
+    else if (strcmp(name, "raw") == 0) format = IMAGE_RAW;
+    else return false;
+    return true;
+}
+
+// Запись поверхности в file. Кадры в одном потоке можно писать подряд:
+// так их принимают, например, ffmpeg -f image2pipe (PPM) и -f rawvideo.
+inline bool writeImage(FILE* file, SDL_Surface* surface, ImageFormat format) {
+    if (format == IMAGE_BMP) {
+        SDL_RWops* stream = SDL_RWFromFP(file, SDL_FALSE);
+        return stream && SDL_SaveBMP_RW(surface, stream, 1) == 0;
+    }
+
+    if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+    bool ok = true;
+    const uint8_t* pixels = (const uint8_t*)surface->pixels;
+    if (format == IMAGE_RAW) {
+        size_t rowBytes = (size_t)surface->w * surface->format->BytesPerPixel;
+        for (int y = 0; y < surface->h && ok; ++y) {
+            ok = fwrite(pixels + (size_t)y * surface->pitch, 1, rowBytes, file) == rowBytes;
+        }
+    } else {
+        ok = fprintf(file, "P6\n%d %d\n255\n", surface->w, surface->h) > 0;
+        // Наш порядок каналов (0x00RRGGBB) разбирается сдвигами, прочие 32-битные — через SDL
+        bool native = surface->format->format == SDL_PIXELFORMAT_RGB888
+                   || surface->format->format == SDL_PIXELFORMAT_ARGB8888;
+        std::vector<uint8_t> row((size_t)surface->w * 3);
+        for (int y = 0; y < surface->h && ok; ++y) {
+            const uint32_t* source = (const uint32_t*)(pixels + (size_t)y * surface->pitch);
+            uint8_t* out = row.data();
+            for (int x = 0; x < surface->w; ++x, out += 3) {
+                if (native) {
+                    out[0] = (uint8_t)(source[x] >> 16);
+                    out[1] = (uint8_t)(source[x] >> 8);
+                    out[2] = (uint8_t)source[x];
+                } else {
+                    SDL_GetRGB(source[x], surface->format, &out[0], &out[1], &out[2]);
+                }
+            }
+            ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+        }
+    }
+    if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+    return ok;
+}
+
+// Запись поверхности в файл path
+inline bool saveImage(const char* path, SDL_Surface* surface, ImageFormat format) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = writeImage(file, surface, format);
+    return fclose(file) == 0 && ok;
+}
+
+#endif // _IMAGE_FILE_HPP_
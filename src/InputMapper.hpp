@@ -0,0 +1,154 @@
+#ifndef _INPUT_MAPPER_HPP_
+#define _INPUT_MAPPER_HPP_
+
+#include <SDL2/SDL.h>
+#include "SceneController.hpp"
+
+// Перевод событий ввода SDL в команды сцены: перетаскивание мышью, колесо, клавиши, размер окна.
+// Состояние перетаскивания и Shift хранится здесь, поэтому одинаковая последовательность
+// событий всегда даёт одинаковые команды — и в окне, и при воспроизведении записи.
+class InputMapper {
+private:
+    bool isLeftDragging;   // Для вращения модели
+    bool isRightDragging;  // Для управления камерой
+    bool isShiftPressed;
+    int lastMouseX, lastMouseY;
+
+public:
+    InputMapper() : isLeftDragging(false), isRightDragging(false), isShiftPressed(false), lastMouseX(0), lastMouseY(0) {}
+
+    // Команды события передаются в sink.push(type, x, y, z); прочие события пропускаются
+    template <typename Sink>
+    void handle(const SDL_Event& e, Sink& sink) {
+        if (e.type == SDL_WINDOWEVENT) {
+            if (e.window.event == SDL_WINDOWEVENT_RESIZED) {
+                sink.push(SceneCommand::RESIZE, (float)e.window.data1, (float)e.window.data2);
+            }
+        }
+        else if (e.type == SDL_MOUSEBUTTONDOWN) {
+            if (e.button.button == SDL_BUTTON_LEFT) {
+                isLeftDragging = true;
+                lastMouseX = e.button.x;
+                lastMouseY = e.button.y;
+
+                // Выбор модели под курсором
+                sink.push(SceneCommand::SELECT_AT, (float)e.button.x, (float)e.button.y);
+            }
+            else if (e.button.button == SDL_BUTTON_RIGHT) {
+                isRightDragging = true;
+                lastMouseX = e.button.x;
+                lastMouseY = e.button.y;
+            }
+        }
+        else if (e.type == SDL_MOUSEBUTTONUP) {
+            if (e.button.button == SDL_BUTTON_LEFT) {
+                isLeftDragging = false;
+            }
+            else if (e.button.button == SDL_BUTTON_RIGHT) {
+                isRightDragging = false;
+            }
+        }
+        else if (e.type == SDL_MOUSEMOTION) {
+            int deltaX = e.motion.x - lastMouseX;
+            int deltaY = e.motion.y - lastMouseY;
+
+            if (isLeftDragging) {
+                if (isShiftPressed) {
+                    sink.push(SceneCommand::ROTATE_OVER_EDGE, (float)deltaX);
+                } else {
+                    // Вращаем модель вокруг её центра
+                    sink.push(SceneCommand::ROTATE_MODEL, deltaX * 0.0025f, deltaY * 0.0025f);
+                }
+                lastMouseX = e.motion.x;
+                lastMouseY = e.motion.y;
+            }
+            else if (isRightDragging) {
+                // Вращение камеры
+                sink.push(SceneCommand::ROTATE_CAMERA, deltaX * 0.01f, deltaY * 0.01f);
+
+                lastMouseX = e.motion.x;
+                lastMouseY = e.motion.y;
+            }
+        }
+        else if (e.type == SDL_MOUSEWHEEL) {
+            float scale_factor = (e.wheel.y > 0) ? 1.1f : 0.9f;
+            sink.push(SceneCommand::SCALE_MODEL, scale_factor);
+        }
+        else if (e.type == SDL_KEYDOWN) {
+            if (e.key.keysym.sym == SDLK_LSHIFT) {
+                isShiftPressed = true;
+            }
+            float moveSpeed = 0.25f;
+            bool moved = false;
+            float forward = 0.0f, right = 0.0f, up = 0.0f;
+
+            switch (e.key.keysym.sym) {
+                case SDLK_UP:
+                    forward = moveSpeed;
+                    moved = true;
+                    break;
+                case SDLK_DOWN:
+                    forward = -moveSpeed;
+                    moved = true;
+                    break;
+                case SDLK_LEFT:
+                    right = -moveSpeed;
+                    moved = true;
+                    break;
+                case SDLK_RIGHT:
+                    right = moveSpeed;
+                    moved = true;
+                    break;
+                case SDLK_PAGEUP:
+                    up = moveSpeed;
+                    moved = true;
+                    break;
+                case SDLK_PAGEDOWN:
+                    up = -moveSpeed;
+                    moved = true;
+                    break;
+                case SDLK_w:
+                    sink.push(SceneCommand::TRANSLATE_MODEL, 0.0f, -0.1f, 0.0f);
+                    break;
+                case SDLK_s:
+                    sink.push(SceneCommand::TRANSLATE_MODEL, 0.0f, 0.1f, 0.0f);
+                    break;
+                case SDLK_a:
+                    sink.push(SceneCommand::TRANSLATE_MODEL, -0.1f, 0.0f, 0.0f);
+                    break;
+                case SDLK_d:
+                    sink.push(SceneCommand::TRANSLATE_MODEL, 0.1f, 0.0f, 0.0f);
+                    break;
+                case SDLK_q:
+                    sink.push(SceneCommand::TRANSLATE_MODEL, 0.0f, 0.0f, 0.1f);
+                    break;
+                case SDLK_e:
+                    sink.push(SceneCommand::TRANSLATE_MODEL, 0.0f, 0.0f, -0.1f);
+                    break;
+                case SDLK_l:
+                    sink.push(SceneCommand::CYCLE_SHADING);
+                    break;
+                case SDLK_f:
+                    sink.push(SceneCommand::TOGGLE_FILTER);
+                    break;
+                case SDLK_o:
+                    sink.push(SceneCommand::TOGGLE_OVERDRAW);
+                    break;
+                case SDLK_h:
+                    sink.push(SceneCommand::TOGGLE_HUD);
+                    break;
+            }
+
+            if (moved) {
+                sink.push(SceneCommand::MOVE_CAMERA, forward, right, up);
+            }
+        }
+        else if (e.type == SDL_KEYUP) {
+            if (e.key.keysym.sym == SDLK_LSHIFT) {
+                isShiftPressed = false;
+            }
+        }
+    }
+};
+
+#endif // _INPUT_MAPPER_HPP_
@@ -0,0 +1,339 @@
+#ifndef _INPUT_RECORDING_HPP_
+#define _INPUT_RECORDING_HPP_
+
+#include <SDL2/SDL.h>
+#include "Scene3D.hpp"
+#include "SceneController.hpp"
+#include "InputMapper.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Запись событий ввода окна в файл и их воспроизведение в пакетном режиме.
+//
+// Файл: заголовок "ENGINPUT", версия (1 байт), ширина и высота окна (по 2 байта), затем события.
+// Событие — время с предыдущего в микросекундах (varint), вид (1 байт) и данные вида;
+// все числа little-endian. Пишутся только события, из которых InputMapper делает команды, и выход.
+// Воспроизведение раскладывает события по кадрам фиксированной длины по их времени, поэтому
+// одна и та же запись даёт одинаковую последовательность кадров в любой сборке.
+
+// Событие записи и его время от начала записи
+struct RecordedEvent {
+    uint64_t timeNs;
+    SDL_Event event;
+};
+
+class InputRecorder {
+private:
+    static const uint8_t VERSION = 1;
+
+    FILE* file;
+    uint64_t startNs;
+    uint64_t lastUs;   // Время предыдущего события от начала записи
+    uint64_t events;
+
+    void writeByte(uint8_t value) {
+        fputc(value, file);
+    }
+
+    void writeU16(int value) {
+        uint16_t bits = (uint16_t)std::min(std::max(value, -32768), 65535);
+        writeByte((uint8_t)bits);
+        writeByte((uint8_t)(bits >> 8));
+    }
+
+    void writeI32(int32_t value) {
+        uint32_t bits = (uint32_t)value;
+        for (int shift = 0; shift < 32; shift += 8) writeByte((uint8_t)(bits >> shift));
+    }
+
+    void writeVarint(uint64_t value) {
+        while (value >= 0x80) {
+            writeByte((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        writeByte((uint8_t)value);
+    }
+
+public:
+    // Виды событий в файле
+    enum Kind : uint8_t {
+        KIND_QUIT = 1,
+        KIND_RESIZE,         // Ширина, высота
+        KIND_BUTTON_DOWN,    // Кнопка (1 байт), x, y
+        KIND_BUTTON_UP,
+        KIND_MOTION,         // x, y
+        KIND_WHEEL,          // Прокрутка по y (1 байт со знаком)
+        KIND_KEY_DOWN,       // Код клавиши SDL (4 байта)
+        KIND_KEY_UP
+    };
+
+    static constexpr const char* MAGIC = "ENGINPUT";
+    static const size_t MAGIC_SIZE = 8;
+
+    InputRecorder() : file(nullptr), startNs(0), lastUs(0), events(0) {}
+
+    ~InputRecorder() {
+        close();
+    }
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    // Начало записи; nowNs — время начала (JobSystem::nowNs), width и height — размер окна
+    bool open(const char* path, int width, int height, uint64_t nowNs) {
+        close();
+        file = fopen(path, "wb");
+        if (!file) return false;
+        fwrite(MAGIC, 1, MAGIC_SIZE, file);
+        writeByte(VERSION);
+        writeU16(width);
+        writeU16(height);
+        startNs = nowNs;
+        lastUs = 0;
+        events = 0;
+        return true;
+    }
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    // Запись события, обработанного в момент nowNs. События, не влияющие на сцену, пропускаются.
+    void record(const SDL_Event& e, uint64_t nowNs) {
+        if (!file) return;
+        uint8_t kind = 0;
+        switch (e.type) {
+            case SDL_QUIT: kind = KIND_QUIT; break;
+            case SDL_WINDOWEVENT: kind = e.window.event == SDL_WINDOWEVENT_RESIZED ? KIND_RESIZE : 0; break;
+            case SDL_MOUSEBUTTONDOWN: kind = KIND_BUTTON_DOWN; break;
+            case SDL_MOUSEBUTTONUP: kind = KIND_BUTTON_UP; break;
+            case SDL_MOUSEMOTION: kind = KIND_MOTION; break;
+            case SDL_MOUSEWHEEL: kind = KIND_WHEEL; break;
+            case SDL_KEYDOWN: kind = KIND_KEY_DOWN; break;
+            case SDL_KEYUP: kind = KIND_KEY_UP; break;
+        }
+        if (!kind) return;
+
+        uint64_t timeUs = std::max(lastUs, (nowNs - std::min(nowNs, startNs)) / 1000);
+        writeVarint(timeUs - lastUs);
+        lastUs = timeUs;
+        writeByte(kind);
+        switch (kind) {
+            case KIND_RESIZE:
+                writeU16(e.window.data1);
+                writeU16(e.window.data2);
+                break;
+            case KIND_BUTTON_DOWN:
+            case KIND_BUTTON_UP:
+                writeByte(e.button.button);
+                writeU16(e.button.x);
+                writeU16(e.button.y);
+                break;
+            case KIND_MOTION:
+                writeU16(e.motion.x);
+                writeU16(e.motion.y);
+                break;
+            case KIND_WHEEL:
+                writeByte((uint8_t)(int8_t)std::min(std::max((int)e.wheel.y, -128), 127));
+                break;
+            case KIND_KEY_DOWN:
+            case KIND_KEY_UP:
+                writeI32(e.key.keysym.sym);
+                break;
+        }
+        events++;
+    }
+
+    // Число записанных событий
+    uint64_t getEventCount() const {
+        return events;
+    }
+
+    // Завершение записи; false — файл записан не полностью
+    bool close() {
+        if (!file) return true;
+        bool ok = !ferror(file);
+        ok = fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+};
+
+// Содержимое файла записи
+struct InputRecording {
+    int width = 0;
+    int height = 0;
+    std::vector<RecordedEvent> events;
+
+    // Время последнего события
+    uint64_t getDurationNs() const {
+        return events.empty() ? 0 : events.back().timeNs;
+    }
+
+    // Чтение файла; при ошибке error получает описание
+    bool load(const char* path, std::string& error) {
+        FILE* file = fopen(path, "rb");
+        if (!file) {
+            error = std::string("cannot open ") + path;
+            return false;
+        }
+        std::vector<uint8_t> data;
+        uint8_t chunk[4096];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            data.insert(data.end(), chunk, chunk + read);
+        }
+        fclose(file);
+
+        size_t position = 0;
+        bool truncated = false;
+        auto byte = [&]() -> uint8_t {
+            if (position >= data.size()) {
+                truncated = true;
+                return 0;
+            }
+            return data[position++];
+        };
+        auto u16 = [&]() -> uint16_t {
+            uint16_t low = byte();
+            return (uint16_t)(low | byte() << 8);
+        };
+
+        const size_t HEADER = InputRecorder::MAGIC_SIZE + 5;
+        if (data.size() < HEADER || memcmp(data.data(), InputRecorder::MAGIC, InputRecorder::MAGIC_SIZE) != 0) {
+            error = std::string(path) + " is not an input recording";
+            return false;
+        }
+        position = InputRecorder::MAGIC_SIZE;
+        if (byte() != 1) {
+            error = std::string(path) + ": unsupported recording version";
+            return false;
+        }
+        width = u16();
+        height = u16();
+
+        events.clear();
+        uint64_t timeUs = 0;
+        while (position < data.size()) {
+            uint64_t delta = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t part = byte();
+                delta |= (uint64_t)(part & 0x7F) << shift;
+                if (!(part & 0x80)) break;
+            }
+            timeUs += delta;
+
+            SDL_Event e;
+            memset(&e, 0, sizeof(e));
+            uint8_t kind = byte();
+            switch (kind) {
+                case InputRecorder::KIND_QUIT:
+                    e.type = SDL_QUIT;
+                    break;
+                case InputRecorder::KIND_RESIZE:
+                    e.type = SDL_WINDOWEVENT;
+                    e.window.event = SDL_WINDOWEVENT_RESIZED;
+                    e.window.data1 = u16();
+                    e.window.data2 = u16();
+                    break;
+                case InputRecorder::KIND_BUTTON_DOWN:
+                case InputRecorder::KIND_BUTTON_UP:
+                    e.type = kind == InputRecorder::KIND_BUTTON_DOWN ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+                    e.button.button = byte();
+                    e.button.x = (int16_t)u16();
+                    e.button.y = (int16_t)u16();
+                    break;
+                case InputRecorder::KIND_MOTION:
+                    e.type = SDL_MOUSEMOTION;
+                    e.motion.x = (int16_t)u16();
+                    e.motion.y = (int16_t)u16();
+                    break;
+                case InputRecorder::KIND_WHEEL:
+                    e.type = SDL_MOUSEWHEEL;
+                    e.wheel.y = (int8_t)byte();
+                    break;
+                case InputRecorder::KIND_KEY_DOWN:
+                case InputRecorder::KIND_KEY_UP: {
+                    e.type = kind == InputRecorder::KIND_KEY_DOWN ? SDL_KEYDOWN : SDL_KEYUP;
+                    uint32_t sym = 0;
+                    for (int shift = 0; shift < 32; shift += 8) sym |= (uint32_t)byte() << shift;
+                    e.key.keysym.sym = (SDL_Keycode)(int32_t)sym;
+                    break;
+                }
+                default:
+                    error = std::string(path) + ": unknown event at byte " + std::to_string(position - 1);
+                    return false;
+            }
+            if (truncated) {
+                error = std::string(path) + ": truncated";
+                return false;
+            }
+            events.push_back({ timeUs * 1000, e });
+        }
+        return true;
+    }
+};
+
+// Воспроизведение записи в сцене: перед кадром frame применяются события, записанные
+// до конца его периода. Команды проходят те же InputMapper, слияние и SceneController,
+// что и в окне; переключение панели производительности пропускается.
+class InputReplay {
+private:
+    const InputRecording& recording;
+    SceneController controller;
+    InputMapper mapper;
+    std::vector<SceneCommand> batch;
+    size_t nextEvent;
+    uint64_t frameNs;
+
+public:
+    static const uint64_t DEFAULT_FRAME_NS = 1000000000ull / 60;
+
+    InputReplay(Scene3D& scene, const InputRecording& recording, uint64_t frameNs = DEFAULT_FRAME_NS)
+        : recording(recording), controller(scene), nextEvent(0), frameNs(std::max<uint64_t>(frameNs, 1)) {}
+
+    // Модель, выбранная в начале записанного сеанса
+    void select(std::shared_ptr<Model3D> model) {
+        controller.select(std::move(model));
+    }
+
+    // Кадров в записи: до последнего события включительно
+    int getFrameCount() const {
+        return (int)(recording.getDurationNs() / frameNs) + 1;
+    }
+
+    uint64_t getFrameNs() const {
+        return frameNs;
+    }
+
+    // Команда от InputMapper; подряд идущие команды одного типа сливаются, как в RenderThread::push
+    void push(SceneCommand::Type type, float x = 0.0f, float y = 0.0f, float z = 0.0f) {
+        SceneCommand command = { type, x, y, z, 0 };
+        if (batch.empty() || !batch.back().merge(command)) {
+            batch.push_back(command);
+        }
+    }
+
+    // Применение событий кадра frame; возвращает их число
+    size_t advance(int frame) {
+        uint64_t frameEnd = (uint64_t)(frame + 1) * frameNs;
+        size_t first = nextEvent;
+        batch.clear();
+        while (nextEvent < recording.events.size() && recording.events[nextEvent].timeNs < frameEnd) {
+            mapper.handle(recording.events[nextEvent].event, *this);
+            nextEvent++;
+        }
+        for (const SceneCommand& command : batch) {
+            if (command.type != SceneCommand::TOGGLE_HUD) controller.apply(command);
+        }
+        return nextEvent - first;
+    }
+};
+
+#endif // _INPUT_RECORDING_HPP_
@@ -0,0 +1,64 @@
+#ifndef _INTERPOLATION_HPP_
+#define _INTERPOLATION_HPP_
+
+#include <cmath>
+
+// Интерполяция атрибутов вершин (цвет, нормаль, текстурные координаты) по треугольнику с учётом перспективы.
+//
+// Линейны в экранных координатах не сами величины a и w, а a / w и 1 / w, поэтому для каждого атрибута
+// и для 1 / w один раз на треугольник строится плоскость q = base + dx * (x - x0) + dy * (y - y0).
+// Растеризатор получает начало строки из плоскостей, дальше прибавляет dx на каждый пиксель;
+// атрибут пикселя — (a / w) * w, где w = 1 / (1 / w) нужно и для проверки глубины.
+template <int Count>
+struct AttributePlanes {
+    float originX, originY;
+    float base[Count];
+    float dx[Count];
+    float dy[Count];
+    float baseInverseW, dxInverseW, dyInverseW;
+
+    // Вершины: экранные x, y, 1 / w и значения атрибутов. false — треугольник вырожден.
+    bool setup(float x0, float y0, float inverseW0, const float* values0,
+               float x1, float y1, float inverseW1, const float* values1,
+               float x2, float y2, float inverseW2, const float* values2) {
+        float edge1X = x1 - x0, edge1Y = y1 - y0;
+        float edge2X = x2 - x0, edge2Y = y2 - y0;
+        float area = edge1X * edge2Y - edge2X * edge1Y;
+        if (area == 0.0f || !std::isfinite(area)) return false;
+        float inverseArea = 1.0f / area;
+
+        originX = x0;
+        originY = y0;
+        baseInverseW = inverseW0;
+        dxInverseW = ((inverseW1 - inverseW0) * edge2Y - (inverseW2 - inverseW0) * edge1Y) * inverseArea;
+        dyInverseW = ((inverseW2 - inverseW0) * edge1X - (inverseW1 - inverseW0) * edge2X) * inverseArea;
+        for (int i = 0; i < Count; ++i) {
+            float q0 = values0[i] * inverseW0;
+            float delta1 = values1[i] * inverseW1 - q0;
+            float delta2 = values2[i] * inverseW2 - q0;
+            base[i] = q0;
+            dx[i] = (delta1 * edge2Y - delta2 * edge1Y) * inverseArea;
+            dy[i] = (delta2 * edge1X - delta1 * edge2X) * inverseArea;
+        }
+        return true;
+    }
+
+    // Значения a / w и 1 / w в точке (x, y) — начало отрезка строки
+    void start(float x, float y, float* values, float& inverseW) const {
+        float offsetX = x - originX, offsetY = y - originY;
+        inverseW = baseInverseW + offsetX * dxInverseW + offsetY * dyInverseW;
+        for (int i = 0; i < Count; ++i) {
+            values[i] = base[i] + offsetX * dx[i] + offsetY * dy[i];
+        }
+    }
+
+    // Переход к следующему пикселю строки
+    void step(float* values, float& inverseW) const {
+        inverseW += dxInverseW;
+        for (int i = 0; i < Count; ++i) {
+            values[i] += dx[i];
+        }
+    }
+};
+
+#endif // _INTERPOLATION_HPP_
@@ -0,0 +1,371 @@
+#ifndef _JOB_SYSTEM_HPP_
+#define _JOB_SYSTEM_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <initializer_list>
+
+#include "Profiler.hpp"
+#include "AllocationTracker.hpp"
+
+// Система задач с перехватом работы (work stealing).
+//
+// У каждого рабочего потока своя очередь: владелец берёт задачи с конца (LIFO,
+// горячий кэш), остальные потоки при простое забирают задачи с начала чужих очередей.
+// Поток, ожидающий задачу (wait), выполняет задачи из очередей, поэтому система работает
+// и при нуле рабочих потоков. Когда очереди пусты, а задача ещё выполняется другим потоком,
+// ожидающий после короткого ожидания в цикле засыпает до её завершения.
+//
+// Задача может зависеть от других: она попадает в очередь, только когда
+// завершатся все её зависимости.
+//
+// Части parallelFor — задачи без std::function и зависимостей: они берутся из пула
+// и возвращаются в него после выполнения, поэтому установившийся кадр не выделяет память под задачи.
+class JobSystem {
+private:
+    struct Job {
+        std::function<void()> function;
+        const char* name;
+        std::atomic<int> pendingDependencies;
+        std::atomic<bool> done;
+        std::mutex mutex;                                // Защищает continuations и done при регистрации
+        std::vector<std::shared_ptr<Job>> continuations; // Задачи, ждущие завершения этой
+
+        // Часть parallelFor: rangeInvoke(rangeFunction, rangeBegin, rangeEnd), затем уменьшение remaining
+        const void* rangeFunction;
+        void (*rangeInvoke)(const void* function, size_t begin, size_t end);
+        size_t rangeBegin;
+        size_t rangeEnd;
+        const char* allocationTag;      // Этап вызывающего parallelFor для учёта выделений
+        std::atomic<size_t>* remaining; // Счётчик невыполненных частей на стеке вызывающего
+
+        Job(std::function<void()> fn, const char* jobName)
+            : function(std::move(fn)), name(jobName), pendingDependencies(1), done(false),
+              rangeFunction(nullptr), rangeInvoke(nullptr), rangeBegin(0), rangeEnd(0),
+              allocationTag(nullptr), remaining(nullptr) {}
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<Job>> jobs;
+    };
+
+public:
+    typedef std::shared_ptr<Job> JobHandle;
+
+    // Хук замера: имя задачи, номер потока, начало и конец в наносекундах steady_clock
+    typedef std::function<void(const char* name, unsigned worker, uint64_t startNs, uint64_t endNs)> TimingHook;
+
+private:
+    // Очереди 0..workerCount-1 принадлежат рабочим потокам,
+    // последняя — всем внешним потокам (например, основному).
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    static const int SPIN_COUNT = 64;  // Попыток найти задачу до засыпания ожидающего потока
+
+    // Засыпание рабочих и ожидающих потоков. Условия проверяются под sleepMutex,
+    // поэтому будящая сторона захватывает его перед notify, иначе пробуждение теряется.
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<int> queuedJobs;
+    std::atomic<int> sleepingWaiters;  // Потоки, спящие в waitUntil
+    std::atomic<bool> stopping;
+
+    TimingHook timingHook;
+
+    std::mutex poolMutex;
+    std::vector<JobHandle> freeRangeJobs;  // Выполненные части parallelFor для повторного использования
+
+    static unsigned& currentWorker() {
+        static thread_local unsigned index = ~0u;
+        return index;
+    }
+
+    // Очередь текущего потока в этой системе
+    unsigned ownQueue() const {
+        unsigned index = currentWorker();
+        return index < workers.size() ? index : (unsigned)workers.size();
+    }
+
+    void enqueue(const JobHandle& job) {
+        WorkerQueue& queue = *queues[ownQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(job);
+        }
+        queuedJobs.fetch_add(1);
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wakeCondition.notify_one();
+    }
+
+    // Завершение задачи, которую может ждать спящий поток
+    void notifyWaiters() {
+        if (!sleepingWaiters.load()) return;
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wakeCondition.notify_all();
+    }
+
+    // Выполнение задач из очередей, пока не выполнится done(). Если задач нет,
+    // поток недолго уступает процессор, а затем спит до новой задачи или notifyWaiters.
+    template <typename Done>
+    void waitUntil(const Done& done) {
+        unsigned self = ownQueue();
+        int idle = 0;
+        while (!done()) {
+            if (runOne(self)) {
+                idle = 0;
+            } else if (++idle < SPIN_COUNT) {
+                std::this_thread::yield();
+            } else {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                sleepingWaiters.fetch_add(1);
+                wakeCondition.wait(lock, [&] { return done() || queuedJobs.load() > 0; });
+                sleepingWaiters.fetch_sub(1);
+                idle = 0;
+            }
+        }
+    }
+
+    // Своя очередь с конца, затем чужие с начала
+    JobHandle take(unsigned self) {
+        {
+            WorkerQueue& queue = *queues[self];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                JobHandle job = queue.jobs.back();
+                queue.jobs.pop_back();
+                queuedJobs.fetch_sub(1);
+                return job;
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkerQueue& victim = *queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                JobHandle job = victim.jobs.front();
+                victim.jobs.pop_front();
+                queuedJobs.fetch_sub(1);
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    static void invoke(Job& job) {
+        if (job.rangeInvoke) {
+            // Части выполняются в других потоках, но их выделения относятся к этапу вызывающего
+            AllocationScope scope(job.allocationTag);
+            job.rangeInvoke(job.rangeFunction, job.rangeBegin, job.rangeEnd);
+        } else {
+            job.function();
+        }
+    }
+
+    // Задача для части parallelFor: из пула, а пока пул пуст — новая
+    JobHandle acquireRangeJob() {
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (!freeRangeJobs.empty()) {
+                JobHandle job = std::move(freeRangeJobs.back());
+                freeRangeJobs.pop_back();
+                return job;
+            }
+        }
+        return std::make_shared<Job>(nullptr, nullptr);
+    }
+
+    void execute(const JobHandle& job, unsigned self) {
+        {
+            PROFILE_SCOPE(job->name);
+            if (timingHook) {
+                uint64_t start = nowNs();
+                invoke(*job);
+                timingHook(job->name, self, start, nowNs());
+            } else {
+                invoke(*job);
+            }
+        }
+
+        if (job->rangeInvoke) {
+            // Счётчик живёт на стеке parallelFor: уменьшаем его последним, когда задача уже в пуле
+            std::atomic<size_t>* remaining = job->remaining;
+            {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                freeRangeJobs.push_back(job);
+            }
+            if (remaining->fetch_sub(1) == 1) notifyWaiters();
+            return;
+        }
+
+        std::vector<JobHandle> ready;
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            job->done.store(true);
+            ready.swap(job->continuations);
+        }
+        notifyWaiters();
+        for (const auto& continuation : ready) {
+            if (continuation->pendingDependencies.fetch_sub(1) == 1) {
+                enqueue(continuation);
+            }
+        }
+    }
+
+    bool runOne(unsigned self) {
+        JobHandle job = take(self);
+        if (!job) return false;
+        execute(job, self);
+        return true;
+    }
+
+    void workerLoop(unsigned index) {
+        currentWorker() = index;
+        PROFILE_THREAD("worker", (int)index);
+        while (!stopping.load()) {
+            if (runOne(index)) continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeCondition.wait(lock, [this] {
+                return stopping.load() || queuedJobs.load() > 0;
+            });
+        }
+    }
+
+public:
+    static uint64_t nowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Число рабочих потоков по умолчанию: все ядра, кроме занятого вызывающим потоком
+    static unsigned defaultWorkerCount() {
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 0;
+    }
+
+    explicit JobSystem(unsigned workerCount = defaultWorkerCount())
+        : queuedJobs(0), sleepingWaiters(0), stopping(false)
+    {
+        for (unsigned i = 0; i <= workerCount; ++i) {
+            queues.emplace_back(new WorkerQueue());
+        }
+        workers.reserve(workerCount);
+        for (unsigned i = 0; i < workerCount; ++i) {
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping.store(true);
+        }
+        wakeCondition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned getWorkerCount() const {
+        return (unsigned)workers.size();
+    }
+
+    // Число потоков, одновременно выполняющих задачи (рабочие + ожидающий)
+    unsigned getConcurrency() const {
+        return (unsigned)workers.size() + 1;
+    }
+
+    void setTimingHook(TimingHook hook) {
+        timingHook = std::move(hook);
+    }
+
+    // Постановка задачи. Она начнёт выполняться после завершения всех dependencies.
+    JobHandle submit(const char* name, std::function<void()> function,
+                     std::initializer_list<JobHandle> dependencies = {})
+    {
+        JobHandle job = std::make_shared<Job>(std::move(function), name);
+        for (const auto& dependency : dependencies) {
+            if (!dependency) continue;
+            std::lock_guard<std::mutex> lock(dependency->mutex);
+            if (!dependency->done.load()) {
+                job->pendingDependencies.fetch_add(1);
+                dependency->continuations.push_back(job);
+            }
+        }
+        // Снимаем начальную блокировку, удерживавшую задачу на время регистрации
+        if (job->pendingDependencies.fetch_sub(1) == 1) {
+            enqueue(job);
+        }
+        return job;
+    }
+
+    // Ожидание задачи; пока она не готова, вызывающий поток выполняет другие задачи
+    void wait(const JobHandle& job) {
+        if (!job) return;
+        waitUntil([&] { return job->done.load(); });
+    }
+
+    // Параллельный цикл по [begin, end) частями не меньше grain элементов.
+    // function(chunkBegin, chunkEnd) вызывается для каждой части; возврат — после всех частей.
+    template <typename Function>
+    void parallelFor(const char* name, size_t begin, size_t end, size_t grain, const Function& function) {
+        if (end <= begin) return;
+        grain = std::max<size_t>(grain, 1);
+        size_t count = end - begin;
+
+        // Не дробим мельче, чем нужно для загрузки всех потоков
+        size_t chunks = std::min((count + grain - 1) / grain, (size_t)getConcurrency() * 4);
+        if (chunks <= 1) {
+            PROFILE_SCOPE(name);
+            function(begin, end);
+            return;
+        }
+        size_t chunkSize = (count + chunks - 1) / chunks;
+
+        const char* allocationTag = AllocationTracker::currentTag();
+        std::atomic<size_t> remaining((count - 1) / chunkSize);
+        for (size_t chunkBegin = begin + chunkSize; chunkBegin < end; chunkBegin += chunkSize) {
+            JobHandle job = acquireRangeJob();
+            job->name = name;
+            job->rangeFunction = &function;
+            job->rangeInvoke = [](const void* target, size_t chunkBegin, size_t chunkEnd) {
+                (*static_cast<const Function*>(target))(chunkBegin, chunkEnd);
+            };
+            job->rangeBegin = chunkBegin;
+            job->rangeEnd = std::min(end, chunkBegin + chunkSize);
+            job->allocationTag = allocationTag;
+            job->remaining = &remaining;
+            enqueue(job);
+        }
+
+        // Первую часть выполняем сами
+        {
+            PROFILE_SCOPE(name);
+            if (timingHook) {
+                uint64_t start = nowNs();
+                function(begin, begin + chunkSize);
+                timingHook(name, ownQueue(), start, nowNs());
+            } else {
+                function(begin, begin + chunkSize);
+            }
+        }
+
+        // Пока части не выполнены, выполняем другие задачи
+        waitUntil([&] { return remaining.load() == 0; });
+    }
+};
+
+#endif // _JOB_SYSTEM_HPP_
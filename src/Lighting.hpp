@@ -0,0 +1,142 @@
+#ifndef _LIGHTING_HPP_
+#define _LIGHTING_HPP_
+
+#include "Position3D.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Цвет с каналами в долях 0..1 (для освещённости — может быть больше 1)
+struct ColorRGB {
+    float r, g, b;
+
+    // Из 0xRRGGBB, как задаётся fillColor
+    static ColorRGB fromPixel(uint32_t rgb) {
+        return { ((rgb >> 16) & 0xFF) / 255.0f, ((rgb >> 8) & 0xFF) / 255.0f, (rgb & 0xFF) / 255.0f };
+    }
+
+    // Обратно в 0xRRGGBB с насыщением
+    uint32_t toPixel() const {
+        return (channel(r) << 16) | (channel(g) << 8) | channel(b);
+    }
+
+    static uint32_t channel(float value) {
+        return (uint32_t)std::min(255.0f, std::max(0.0f, value * 255.0f + 0.5f));
+    }
+};
+
+enum LightType {
+    LIGHT_DIRECTIONAL,  // Параллельные лучи из бесконечности (солнце)
+    LIGHT_POINT         // Лучи из точки, яркость падает с расстоянием
+};
+
+struct Light {
+    LightType type;
+    Position3D direction;   // Направление лучей (единичное), для направленного
+    Position3D position;    // Положение источника, для точечного
+    ColorRGB color;         // Цвет с учётом яркости
+    float attenuation;      // Ослабление точечного: 1 / (1 + attenuation * d^2)
+
+    static Light directional(Position3D direction, ColorRGB color) {
+        direction.normalize();
+        return { LIGHT_DIRECTIONAL, direction, Position3D(), color, 0.0f };
+    }
+
+    static Light point(const Position3D& position, ColorRGB color, float attenuation) {
+        return { LIGHT_POINT, Position3D(), position, color, attenuation };
+    }
+};
+
+// Как модели освещаются при отрисовке сцены
+enum ShadingMode {
+    SHADING_NONE,     // Без освещения: полигоны заливаются fillColor
+    SHADING_FLAT,     // Освещённость считается по нормали грани, один цвет на полигон
+    SHADING_GOURAUD   // Освещённость считается в вершинах и интерполируется по полигону
+};
+
+// Цвет пикселя при затенении по Гуро: values — интерполированные a / w трёх каналов 0..255
+// (см. Camera3D::shadeTriangle), w — глубина пикселя. Результат 0xRRGGBB, как fillColor.
+struct GouraudShader {
+    uint32_t operator()(const float* values, float w) const {
+        return (channel(values[0] * w) << 16) | (channel(values[1] * w) << 8) | channel(values[2] * w);
+    }
+
+    static uint32_t channel(float value) {
+        return (uint32_t)std::min(255.0f, std::max(0.0f, value));
+    }
+};
+
+// Источники света сцены и рассеянный свет. Модель Ламберта, без бликов.
+class Lighting {
+private:
+    ColorRGB ambient;
+    std::vector<Light> lights;
+    uint64_t version;  // Растёт при любом изменении
+
+public:
+    Lighting() : ambient{ 0.2f, 0.2f, 0.2f }, version(0) {}
+
+    const ColorRGB& getAmbient() const { return ambient; }
+    void setAmbient(const ColorRGB& color) {
+        ambient = color;
+        version++;
+    }
+
+    const std::vector<Light>& getLights() const { return lights; }
+
+    // Возвращает индекс источника для setLight
+    size_t addLight(const Light& light) {
+        lights.push_back(light);
+        version++;
+        return lights.size() - 1;
+    }
+
+    void setLight(size_t index, const Light& light) {
+        lights[index] = light;
+        version++;
+    }
+
+    void clearLights() {
+        lights.clear();
+        version++;
+    }
+
+    uint64_t getVersion() const { return version; }
+
+    // Освещённость точки point с единичной нормалью normal
+    ColorRGB illuminate(const Position3D& point, const Position3D& normal) const {
+        ColorRGB result = ambient;
+        for (const Light& light : lights) {
+            float toX, toY, toZ;
+            float intensity = 1.0f;
+            if (light.type == LIGHT_DIRECTIONAL) {
+                toX = -light.direction.getX();
+                toY = -light.direction.getY();
+                toZ = -light.direction.getZ();
+            } else {
+                toX = light.position.getX() - point.getX();
+                toY = light.position.getY() - point.getY();
+                toZ = light.position.getZ() - point.getZ();
+                float distanceSquared = toX * toX + toY * toY + toZ * toZ;
+                float distance = std::sqrt(distanceSquared);
+                if (distance > 0.0f) {
+                    toX /= distance;
+                    toY /= distance;
+                    toZ /= distance;
+                }
+                intensity = 1.0f / (1.0f + light.attenuation * distanceSquared);
+            }
+
+            float lambert = normal.getX() * toX + normal.getY() * toY + normal.getZ() * toZ;
+            if (lambert <= 0.0f) continue;
+            result.r += light.color.r * lambert * intensity;
+            result.g += light.color.g * lambert * intensity;
+            result.b += light.color.b * lambert * intensity;
+        }
+        return result;
+    }
+};
+
+#endif // _LIGHTING_HPP_
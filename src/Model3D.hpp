@@ -5,22 +5,236 @@
 #include "Position3D.hpp"
 #include "Camera3D.hpp"
 #include "HiddenSurfaceRemoval.hpp"
+#include "BoundingBox.hpp"
+#include "Ray.hpp"
+#include "RadixSort.hpp"
+#include "Lighting.hpp"
+#include "Texture.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 #include <iostream>
 #include <set>
+#include <mutex>
 
 
+// Список индексов моделей, изменивших вершины. Модели могут пополнять его из разных потоков.
+struct MovedModelList {
+    std::mutex mutex;
+    std::vector<int> indices;
+
+    void push(int index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        indices.push_back(index);
+    }
+};
+
 class Model3D {
 private:
     Matrix vertices;              // Исходные вершины модели
     Matrix transformedVertices;   // Текущие вершины после преобразований
     Matrix transformMatrix;       // Матрица накопленных преобразований
+    Matrix parentMatrix;          // Мировая матрица узла графа сцены, к которому прикреплена модель
+    BoundingBox bounds;           // Границы преобразованных вершин в мировых координатах
+    uint32_t fillColor;           // Цвет заливки полигонов
+    std::vector<uint32_t> vertexColors;     // Цвета вершин 0xRRGGBB (пусто — у всех fillColor)
+    std::vector<Position3D> vertexNormals;  // Нормали вершин в системе модели (пусто — средние нормали граней)
+    std::vector<Position2D> vertexUVs;      // Текстурные координаты вершин (пусто — не заданы)
+    std::vector<std::vector<Position2D>> polygonUVs;  // Текстурные координаты углов полигона (пусто — берутся из vertexUVs)
+    std::shared_ptr<Texture> texture;       // Текстура полигонов с координатами (nullptr — заливка цветом)
+    uint64_t transformVersion;    // Растёт при каждом пересчёте преобразованных вершин
+    uint64_t geometryVersion;     // Растёт при изменении вершин, рёбер, полигонов или цвета
+    bool dynamic;                 // Модель часто меняется и рисуется поверх кэша статического слоя сцены
+
+    MovedModelList* movedModels;   // Список сцены, куда модель заносит свой индекс при изменении вершин
+    int sceneIndex;                // Индекс модели в сцене
+    bool movedPending;             // Индекс уже занесён и ещё не обработан сценой
+
+    // Данные текущего кадра
+    std::vector<Camera3D::Point2D> projected;  // Экранные координаты вершин
+    std::vector<float> projectedDepth;         // w отсечения вершин (глубина вдоль взгляда)
+    std::vector<float> projectedX, projectedY, projectedInverseW; // Результаты ядра проецирования до упаковки в projected
+    std::vector<uint8_t> polygonVisible;       // Полигон прошёл отбор нелицевых граней
+    float projectedLeft, projectedRight;       // Экранный прямоугольник, занятый вершинами
+    float projectedTop, projectedBottom;
+    std::vector<DepthRecord> visibleTriangles; // Полигоны, прошедшие отбор
+    size_t culledPolygons;                     // Отброшены как нелицевые
+    size_t nearRejectedPolygons;               // Отброшены целиком: вершина ближе ближней плоскости
+
+    // Для каких камеры, версий и индекса в сцене посчитаны данные кадра
+    const Camera3D* projectedCamera;
+    uint64_t projectedCameraVersion;
+    uint64_t projectedModelVersion;
+    uint32_t projectedModelIndex;
+
+    // Освещение: для каких источников, режима и версии модели посчитаны цвета
+    float normalMatrix[9];                     // Поворот нормалей в мировую систему (левый верхний блок 3x3)
+    const Lighting* shadedLighting;
+    uint64_t shadedLightingVersion;
+    uint64_t shadedModelVersion;
+    ShadingMode shadedMode;
+    TextureFilter shadedFilter;                // Выборка текселей при отрисовке
+    std::vector<uint32_t> polygonColors;       // SHADING_FLAT: цвет полигона
+    std::vector<float> vertexShades;           // SHADING_GOURAUD: освещённый цвет вершины, 3 канала 0..255
+    std::vector<Position3D> worldNormals;      // Нормали вершин в мировых координатах
+
+    // Полигоны, которым принадлежит каждое ребро: edgePolygons[edgePolygonStart[e] .. edgePolygonStart[e + 1])
+    std::vector<int> edgePolygonStart;
+    std::vector<int> edgePolygons;
+    bool adjacencyDirty;
+
+    // Цвет вершины для освещения. У текстурированной модели цвет даёт текстура, освещается белый.
+    ColorRGB vertexColor(size_t index) const {
+        if (texture) return { 1.0f, 1.0f, 1.0f };
+        return ColorRGB::fromPixel(vertexColors.empty() ? fillColor : vertexColors[index]);
+    }
+
+    bool hasPolygonUVs(size_t polygonIndex) const {
+        return !polygonUVs[polygonIndex].empty() || !vertexUVs.empty();
+    }
+
+    Position2D cornerUV(size_t polygonIndex, size_t corner) const {
+        const std::vector<Position2D>& uvs = polygonUVs[polygonIndex];
+        return uvs.empty() ? vertexUVs[polygons[polygonIndex][corner]] : uvs[corner];
+    }
+
+    // Треугольник с текстурой уровня level; values — по Count значений на вершину (см. TextureShader)
+    template <int Count, bool Lit, typename State>
+    void shadeTextured(Camera3D& camera, SDL_Surface* surface, const Camera3D::Point2D* corners[3], const float values[3][5],
+                       const TextureLevel& level, Zbuffer& zbuffer, const SDL_Rect* clip, const State& state) const {
+        if (shadedFilter == TEXTURE_BILINEAR) {
+            camera.shadeTriangle<Count>(surface, *corners[0], *corners[1], *corners[2], values[0], values[1], values[2],
+                                        TextureShader<TEXTURE_BILINEAR, Lit>{ &level }, zbuffer, clip, state);
+        } else {
+            camera.shadeTriangle<Count>(surface, *corners[0], *corners[1], *corners[2], values[0], values[1], values[2],
+                                        TextureShader<TEXTURE_NEAREST, Lit>{ &level }, zbuffer, clip, state);
+        }
+    }
+
+    // Текстурированный полигон веером треугольников. Уровень mip-цепочки выбирается для каждого треугольника
+    // по отношению площади в текселях к площади на экране. С освещением цвет текселя умножается на освещённость
+    // грани (плоское) или интерполированную освещённость вершин (по Гуро).
+    template <typename State>
+    void drawTexturedPolygon(Camera3D& camera, SDL_Surface* surface, size_t polygonIndex, Zbuffer& zbuffer,
+                             const SDL_Rect* clip, const State& state) const {
+        const std::vector<int>& polygon = polygons[polygonIndex];
+        float flatLight[3];
+        if (shadedMode == SHADING_FLAT) {
+            uint32_t color = polygonColors[polygonIndex];
+            flatLight[0] = (color >> 16 & 0xFF) + 0.5f;
+            flatLight[1] = (color >> 8 & 0xFF) + 0.5f;
+            flatLight[2] = (color & 0xFF) + 0.5f;
+        }
+
+        for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+            const size_t cornerIndices[3] = { 0, i, i + 1 };
+            const Camera3D::Point2D* corners[3];
+            Position2D uvs[3];
+            for (int k = 0; k < 3; ++k) {
+                corners[k] = &projected[polygon[cornerIndices[k]]];
+                uvs[k] = cornerUV(polygonIndex, cornerIndices[k]);
+            }
+
+            float screenArea = 0.5f * std::fabs((corners[1]->x - corners[0]->x) * (corners[2]->y - corners[0]->y)
+                                              - (corners[2]->x - corners[0]->x) * (corners[1]->y - corners[0]->y));
+            float uvArea = 0.5f * std::fabs((uvs[1].x - uvs[0].x) * (uvs[2].y - uvs[0].y)
+                                          - (uvs[2].x - uvs[0].x) * (uvs[1].y - uvs[0].y));
+            const TextureLevel& level = texture->getLevel(texture->selectLevel(uvArea, screenArea));
+
+            // Сдвиг на целое число повторений текстуры: координаты треугольника становятся неотрицательными,
+            // как того требует texelFloor, а изображение не меняется
+            float shiftU = std::floor(std::min(uvs[0].x, std::min(uvs[1].x, uvs[2].x)));
+            float shiftV = std::floor(std::min(uvs[0].y, std::min(uvs[1].y, uvs[2].y)));
+            float values[3][5];
+            for (int k = 0; k < 3; ++k) {
+                values[k][0] = (uvs[k].x - shiftU) * level.width;
+                values[k][1] = (uvs[k].y - shiftV) * level.height;
+                const float* light = shadedMode == SHADING_FLAT ? flatLight : &vertexShades[polygon[cornerIndices[k]] * 3];
+                if (shadedMode != SHADING_NONE) {
+                    values[k][2] = light[0];
+                    values[k][3] = light[1];
+                    values[k][4] = light[2];
+                }
+            }
+
+            if (shadedMode == SHADING_NONE) {
+                shadeTextured<2, false>(camera, surface, corners, values, level, zbuffer, clip, state);
+            } else {
+                shadeTextured<5, true>(camera, surface, corners, values, level, zbuffer, clip, state);
+            }
+        }
+    }
+
+    // Канал освещённого цвета вершины 0..255 (с поправкой на округление при отбрасывании дробной части)
+    static float shadeChannel(float value) {
+        return std::min(255.0f, std::max(0.0f, value * 255.0f)) + 0.5f;
+    }
+
+    // Нормали вершин в мировых координатах: заданные, повёрнутые вместе с моделью,
+    // либо нормированные суммы нормалей полигонов, в которые входит вершина
+    void updateWorldNormals() {
+        size_t count = transformedVertices.getCols();
+        worldNormals.assign(count, Position3D());
+        if (vertexNormals.size() == count) {
+            const float* m = normalMatrix;
+            for (size_t i = 0; i < count; ++i) {
+                const Position3D& n = vertexNormals[i];
+                worldNormals[i] = Position3D(m[0] * n.getX() + m[1] * n.getY() + m[2] * n.getZ(),
+                                             m[3] * n.getX() + m[4] * n.getY() + m[5] * n.getZ(),
+                                             m[6] * n.getX() + m[7] * n.getY() + m[8] * n.getZ());
+            }
+        } else {
+            for (size_t p = 0; p < polygons.size(); ++p) {
+                if (polygons[p].size() < 3) continue;
+                for (int index : polygons[p]) {
+                    worldNormals[index] = worldNormals[index] + hsr.getNormal(p);
+                }
+            }
+        }
+        for (Position3D& normal : worldNormals) {
+            normal.normalize();
+        }
+    }
+
+    // Стороны всех полигонов сортируются по паре вершин, и полигоны ребра находятся двоичным поиском:
+    // перебор всех полигонов для каждого ребра на сетках в десятки тысяч треугольников занимает секунды
+    void updateEdgeAdjacency() {
+        if (!adjacencyDirty) return;
+        auto sideKey = [](int a, int b) {
+            return (uint64_t)(uint32_t)std::min(a, b) << 32 | (uint32_t)std::max(a, b);
+        };
+        std::vector<std::pair<uint64_t, int>> sides;
+        for (size_t p = 0; p < polygons.size(); ++p) {
+            const std::vector<int>& polygon = polygons[p];
+            for (size_t i = 0; i < polygon.size(); ++i) {
+                sides.push_back({ sideKey(polygon[i], polygon[(i + 1) % polygon.size()]), (int)p });
+            }
+        }
+        std::sort(sides.begin(), sides.end());
+        sides.erase(std::unique(sides.begin(), sides.end()), sides.end());
+
+        edgePolygonStart.assign(1, 0);
+        edgePolygons.clear();
+        for (const auto& edge : edges) {
+            uint64_t key = sideKey(edge.first, edge.second);
+            auto side = std::lower_bound(sides.begin(), sides.end(), std::make_pair(key, 0));
+            for (; side != sides.end() && side->first == key; ++side) {
+                edgePolygons.push_back(side->second);
+            }
+            edgePolygonStart.push_back((int)edgePolygons.size());
+        }
+        adjacencyDirty = false;
+    }
     std::vector<std::pair<int, int>> edges;  // Рёбра модели
 
     std::vector<std::vector<int>> polygons;  // Полигоны модели
     HiddenSurfaceRemoval hsr;    // Обработчик удаления невидимых поверхностей
+    std::vector<Position3D> transformedPositions;  // Буфер вершин для hsr, обменивается с ним при каждом переносе
     Position3D position;         // Позиция модели в 3D пространстве
 
     float modelSizeXs;
@@ -40,12 +254,39 @@ public:
     Model3D(size_t vertexCount) 
         : vertices(4, vertexCount),
           transformedVertices(4, vertexCount),
-          transformMatrix(Matrix::identity(4))
+          transformMatrix(Matrix::identity(4)),
+          parentMatrix(Matrix::identity(4)),
+          fillColor(0x006600),
+          transformVersion(0),
+          geometryVersion(0),
+          dynamic(false),
+          movedModels(nullptr),
+          sceneIndex(-1),
+          movedPending(false),
+          projectedLeft(0.0f),
+          projectedRight(0.0f),
+          projectedTop(0.0f),
+          projectedBottom(0.0f),
+          culledPolygons(0),
+          nearRejectedPolygons(0),
+          projectedCamera(nullptr),
+          projectedCameraVersion(0),
+          projectedModelVersion(0),
+          projectedModelIndex(0),
+          shadedLighting(nullptr),
+          shadedLightingVersion(0),
+          shadedModelVersion(0),
+          shadedMode(SHADING_NONE),
+          shadedFilter(TEXTURE_NEAREST),
+          adjacencyDirty(true)
     {
         // Устанавливаем w-координату для всех вершин
         for (size_t i = 0; i < vertexCount; ++i) {
             vertices.at(3, i) = 1.0f;
         }
+        for (int i = 0; i < 9; ++i) {
+            normalMatrix[i] = i % 4 == 0 ? 1.0f : 0.0f;
+        }
     }
 
     // Добавление вершины
@@ -54,6 +295,7 @@ public:
             vertices.at(0, index) = x;
             vertices.at(1, index) = y;
             vertices.at(2, index) = z;
+            geometryVersion++;
             updateTransformedVertices();
         }
     }
@@ -62,6 +304,8 @@ public:
     void addEdge(int v1, int v2) {
         if (v1 < vertices.getCols() && v2 < vertices.getCols()) {
             edges.push_back({v1, v2});
+            adjacencyDirty = true;
+            geometryVersion++;
         }
     }
 
@@ -81,88 +325,305 @@ public:
 
     // Обновление преобразованных вершин
     void updateTransformedVertices() {
-        transformedVertices = transformMatrix * vertices;
+        Matrix combined = parentMatrix * transformMatrix;
+        size_t count = vertices.getCols();
+        if (vertices.getRows() == 4 && count > 0) {
+            // Все вершины одним ядром: строки матрицы вершин лежат в памяти подряд
+            if (transformedVertices.getRows() != 4 || transformedVertices.getCols() != count) {
+                transformedVertices = Matrix(4, count);
+            }
+            float matrix[16];
+            for (int row = 0; row < 4; ++row) {
+                for (int col = 0; col < 4; ++col) {
+                    matrix[row * 4 + col] = combined.at(row, col);
+                }
+            }
+            for (int row = 0; row < 3; ++row) {
+                for (int col = 0; col < 3; ++col) {
+                    normalMatrix[row * 3 + col] = matrix[row * 4 + col];
+                }
+            }
+            const float* in[4] = { &vertices.at(0, 0), &vertices.at(1, 0), &vertices.at(2, 0), &vertices.at(3, 0) };
+            float* out[4] = { &transformedVertices.at(0, 0), &transformedVertices.at(1, 0),
+                              &transformedVertices.at(2, 0), &transformedVertices.at(3, 0) };
+            simdKernels().transformPoints(matrix, in, out, count);
+        } else {
+            transformedVertices = combined * vertices;
+            for (int row = 0; row < 3; ++row) {
+                for (int col = 0; col < 3; ++col) {
+                    normalMatrix[row * 3 + col] = combined.at(row, col);
+                }
+            }
+        }
+        transformVersion++;
         
         // Обновляем данные для удаления невидимых поверхностей
-        std::vector<Position3D> transformedPositions;
+        transformedPositions.clear();
+        bounds = BoundingBox();
         for (size_t i = 0; i < transformedVertices.getCols(); ++i) {
             transformedPositions.emplace_back(
                 transformedVertices.at(0, i),
                 transformedVertices.at(1, i),
                 transformedVertices.at(2, i)
             );
+            bounds.expand(transformedPositions.back());
         }
-        hsr.setVertices(transformedPositions);
+        hsr.swapVertices(transformedPositions);
         hsr.updatePolygons();
+
+        // Сообщаем сцене, что границы модели могли измениться
+        if (movedModels && !movedPending) {
+            movedPending = true;
+            movedModels->push(sceneIndex);
+        }
     }
 
-    // Отрисовка модели
-    void draw(Camera3D& camera, SDL_Surface* surface, uint32_t color, uint32_t fill_color, Zbuffer &zbuffer) {
-        // Получаем видимые полигоны
-        auto visiblePolygons = getVisiblePolygons(camera);
-        
-        // Создаем множество видимых ребер
-        std::set<std::pair<int, int>> visibleEdges;
-        
-        // Для каждого видимого полигона добавляем его ребра в множество видимых ребер
-        for (const auto& polygon : visiblePolygons) {
-            for (size_t i = 0; i < polygon.vertexIndices.size(); ++i) {
-                int v1 = polygon.vertexIndices[i];
-                int v2 = polygon.vertexIndices[(i + 1) % polygon.vertexIndices.size()];
-                
-                // Нормализуем ребро (меньший индекс всегда первый)
-                if (v1 > v2) std::swap(v1, v2);
-                visibleEdges.insert({v1, v2});
-            }
+    // Подключение к списку перемещённых моделей сцены (nullptr — отключение)
+    void attachToScene(MovedModelList* moved, int index) {
+        movedModels = moved;
+        sceneIndex = index;
+        movedPending = false;
+    }
+
+    // Индекс модели в сцене (-1 — не в сцене)
+    int getSceneIndex() const {
+        return sceneIndex;
+    }
+
+    // Сцена обработала перемещение модели
+    void clearMoved() {
+        movedPending = false;
+    }
+
+    // Проецирование всех вершин камерой. Вызывается раз в кадр перед отбором полигонов.
+    void projectVertices(const Camera3D& camera) {
+        size_t count = transformedVertices.getCols();
+        projected.resize(count);
+        projectedDepth.resize(count);
+        projectedLeft = projectedTop = std::numeric_limits<float>::max();
+        projectedRight = projectedBottom = -std::numeric_limits<float>::max();
+        if (count == 0) return;
+        projectedX.resize(count);
+        projectedY.resize(count);
+        projectedInverseW.resize(count);
+        camera.projectPoints(&transformedVertices.at(0, 0), &transformedVertices.at(1, 0), &transformedVertices.at(2, 0), count,
+                             projectedX.data(), projectedY.data(), projectedInverseW.data(), projectedDepth.data());
+        for (size_t i = 0; i < count; ++i) {
+            projected[i].x = projectedX[i];
+            projected[i].y = projectedY[i];
+            projected[i].w = projectedInverseW[i];
+            projectedLeft = std::min(projectedLeft, projected[i].x);
+            projectedRight = std::max(projectedRight, projected[i].x);
+            projectedTop = std::min(projectedTop, projected[i].y);
+            projectedBottom = std::max(projectedBottom, projected[i].y);
         }
-        
-        size_t index = 0;
-        for (const auto& polygon : visiblePolygons) {
-            // Получаем координаты вершин полигона
-            std::vector<Matrix> verticesQQQ;
-            for (int index : polygon.vertexIndices) {
-                Matrix vertex(4, 1);
-                for (size_t i = 0; i < 4; ++i) {
-                    vertex.at(i, 0) = transformedVertices.at(i, index);
-                }
-                verticesQQQ.push_back(vertex);
+    }
+
+    // Экранный прямоугольник, который занимают вершины полигона
+    void getPolygonExtent(size_t polygonIndex, float& left, float& top, float& right, float& bottom) const {
+        const std::vector<int>& polygon = polygons[polygonIndex];
+        left = right = projected[polygon[0]].x;
+        top = bottom = projected[polygon[0]].y;
+        for (size_t i = 1; i < polygon.size(); ++i) {
+            left = std::min(left, projected[polygon[i]].x);
+            right = std::max(right, projected[polygon[i]].x);
+            top = std::min(top, projected[polygon[i]].y);
+            bottom = std::max(bottom, projected[polygon[i]].y);
+        }
+    }
+
+    // Экранный прямоугольник, который занимает вся модель в текущем кадре
+    void getProjectedExtent(float& left, float& top, float& right, float& bottom) const {
+        left = projectedLeft;
+        top = projectedTop;
+        right = projectedRight;
+        bottom = projectedBottom;
+    }
+
+    // Отбор видимых полигонов кадра: проецирует вершины, отбрасывает нелицевые грани
+    // и полигоны за ближней плоскостью, а остальные сохраняет с ключом средней глубины.
+    // Если с прошлого вызова не менялись ни камера, ни модель, данные прошлого кадра остаются как есть.
+    // Смежность рёбер строится здесь, а не при отрисовке: рёбра рисуются параллельно из нескольких полос.
+    const std::vector<DepthRecord>& updateVisibleTriangles(const Camera3D& camera, uint32_t modelIndex) {
+        if (projectedCamera == &camera && projectedCameraVersion == camera.getVersion()
+            && projectedModelVersion == getVersion() && projectedModelIndex == modelIndex) {
+            return visibleTriangles;
+        }
+        projectedCamera = &camera;
+        projectedCameraVersion = camera.getVersion();
+        projectedModelVersion = getVersion();
+        projectedModelIndex = modelIndex;
+
+        projectVertices(camera);
+        updateEdgeAdjacency();
+
+        Position3D cameraPos = camera.getPosition();
+        float nearPlane = camera.getNear();
+        hsr.cullBackFaces(cameraPos, polygonVisible);
+        visibleTriangles.clear();
+        culledPolygons = 0;
+        nearRejectedPolygons = 0;
+
+        for (size_t p = 0; p < polygons.size(); ++p) {
+            const std::vector<int>& polygon = polygons[p];
+            if (polygon.size() < 3 || !polygonVisible[p]) {
+                polygonVisible[p] = 0;
+                culledPolygons++;
+                continue;
+            }
+
+            // Отсечения ближней плоскостью нет: полигон, у которого хоть одна вершина ближе неё, не рисуется
+            // совсем, иначе деление на w такой вершины выворачивает треугольник через весь экран.
+            // Поэтому большие полигоны у самой камеры пропадают целиком, а не обрезаются.
+            float depthSum = 0.0f;
+            bool behindCamera = false;
+            for (int index : polygon) {
+                behindCamera |= projectedDepth[index] < nearPlane;
+                depthSum += projectedDepth[index];
             }
-            //std::cout << "=== VI: "  << index++ << " : " << polygon.vertexIndices[0] << " " << polygon.vertexIndices[1] << " " << polygon.vertexIndices[2] << std::endl;
-            camera.fillTriangleAlt(surface, verticesQQQ[0], verticesQQQ[1], verticesQQQ[2], fill_color, zbuffer);
+            if (behindCamera) {
+                polygonVisible[p] = 0;
+                nearRejectedPolygons++;
+                continue;
+            }
+            visibleTriangles.push_back({depthKey(depthSum / polygon.size()), modelIndex, (uint32_t)p});
         }
+        return visibleTriangles;
+    }
 
-        // Отрисовываем только видимые ребра
-        for (const auto& edge : edges) {
-            // Нормализуем ребро для сравнения
-            int v1 = edge.first;
-            int v2 = edge.second;
-            if (v1 > v2) std::swap(v1, v2);
-            
-            // Проверяем, является ли ребро частью видимого полигона
-            if (visibleEdges.find({v1, v2}) != visibleEdges.end()) {
-                Matrix vert1(4, 1), vert2(4, 1);
-                
-                // Получаем координаты первой вершины
-                for (size_t i = 0; i < 4; ++i) {
-                    vert1.at(i, 0) = transformedVertices.at(i, edge.first);
-                }
-                
-                // Получаем координаты второй вершины
-                for (size_t i = 0; i < 4; ++i) {
-                    vert2.at(i, 0) = transformedVertices.at(i, edge.second);
-                }
-                
-                // Отрисовываем ребро с соответствующим цветом
-                uint32_t edgeColor = color;
-                if ((edge.first == 2 && edge.second == 3) || (edge.first == 3 && edge.second == 2)) {
-                    edgeColor = 0xFFFF00;  // Желтый цвет
+    // Итог последнего updateVisibleTriangles: всего полигонов, нелицевых и отброшенных из-за ближней плоскости
+    size_t getPolygonCount() const { return polygons.size(); }
+    size_t getCulledCount() const { return culledPolygons; }
+    size_t getNearRejectedCount() const { return nearRejectedPolygons; }
+
+    // То же, с добавлением отобранных полигонов в records
+    void collectVisibleTriangles(const Camera3D& camera, uint32_t modelIndex, std::vector<DepthRecord>& records) {
+        const std::vector<DepthRecord>& triangles = updateVisibleTriangles(camera, modelIndex);
+        records.insert(records.end(), triangles.begin(), triangles.end());
+    }
+
+    // Заливка полигона, отобранного collectVisibleTriangles (веером от первой вершины).
+    // Рисуются только пиксели внутри clip (nullptr — весь экран); state — см. Camera3D::fillTriangle.
+    template <typename State = OpaqueRaster>
+    void drawPolygon(Camera3D& camera, SDL_Surface* surface, size_t polygonIndex, uint32_t fill_color, Zbuffer& zbuffer,
+                     const SDL_Rect* clip = nullptr, const State& state = State()) {
+        const std::vector<int>& polygon = polygons[polygonIndex];
+        for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+            camera.fillTriangle(surface, projected[polygon[0]], projected[polygon[i]], projected[polygon[i + 1]], fill_color, zbuffer,
+                                clip, state);
+        }
+    }
+
+    // Освещение модели в режиме mode по источникам lighting (после updateTransformedVertices).
+    // Пересчитывается, только если изменились модель, источники или режим. filter — выборка текселей текстуры.
+    void updateShading(const Lighting& lighting, ShadingMode mode, TextureFilter filter = TEXTURE_NEAREST) {
+        shadedFilter = filter;
+        if (shadedMode == mode && shadedLighting == &lighting && shadedLightingVersion == lighting.getVersion()
+            && shadedModelVersion == getVersion()) {
+            return;
+        }
+        shadedMode = mode;
+        shadedLighting = &lighting;
+        shadedLightingVersion = lighting.getVersion();
+        shadedModelVersion = getVersion();
+
+        if (mode == SHADING_FLAT) {
+            // Одна освещённость на полигон: в центре грани по её нормали
+            polygonColors.resize(polygons.size());
+            for (size_t p = 0; p < polygons.size(); ++p) {
+                const std::vector<int>& polygon = polygons[p];
+                if (polygon.size() < 3) {
+                    polygonColors[p] = fillColor;
+                    continue;
                 }
-                if ((edge.first == 3 && edge.second == 0) || (edge.first == 0 && edge.second == 3)) {
-                    edgeColor = 0xFF00FF;  // Фиолетовый цвет
+                float x = 0.0f, y = 0.0f, z = 0.0f;
+                ColorRGB base = { 0.0f, 0.0f, 0.0f };
+                for (int index : polygon) {
+                    x += transformedVertices.at(0, index);
+                    y += transformedVertices.at(1, index);
+                    z += transformedVertices.at(2, index);
+                    ColorRGB color = vertexColor(index);
+                    base.r += color.r;
+                    base.g += color.g;
+                    base.b += color.b;
                 }
-                camera.drawLine(surface, vert1, vert2, edgeColor, zbuffer);
+                float share = 1.0f / polygon.size();
+                ColorRGB light = lighting.illuminate(Position3D(x * share, y * share, z * share), hsr.getNormal(p));
+                polygonColors[p] = ColorRGB{ base.r * share * light.r, base.g * share * light.g, base.b * share * light.b }.toPixel();
+            }
+        } else if (mode == SHADING_GOURAUD) {
+            // Освещённость в вершинах; между ними её интерполирует растеризатор
+            updateWorldNormals();
+            size_t count = transformedVertices.getCols();
+            vertexShades.resize(count * 3);
+            for (size_t i = 0; i < count; ++i) {
+                Position3D position(transformedVertices.at(0, i), transformedVertices.at(1, i), transformedVertices.at(2, i));
+                ColorRGB light = lighting.illuminate(position, worldNormals[i]);
+                ColorRGB base = vertexColor(i);
+                vertexShades[i * 3 + 0] = shadeChannel(base.r * light.r);
+                vertexShades[i * 3 + 1] = shadeChannel(base.g * light.g);
+                vertexShades[i * 3 + 2] = shadeChannel(base.b * light.b);
+            }
+        }
+    }
+
+    // Заливка полигона с освещением из updateShading; без освещения — fillColor, как drawPolygon.
+    // Полигон с текстурными координатами у модели с текстурой рисуется текстурой.
+    template <typename State = OpaqueRaster>
+    void drawShadedPolygon(Camera3D& camera, SDL_Surface* surface, size_t polygonIndex, Zbuffer& zbuffer,
+                           const SDL_Rect* clip = nullptr, const State& state = State()) {
+        if (texture && hasPolygonUVs(polygonIndex)) {
+            drawTexturedPolygon(camera, surface, polygonIndex, zbuffer, clip, state);
+            return;
+        }
+        if (shadedMode != SHADING_GOURAUD) {
+            uint32_t color = shadedMode == SHADING_FLAT ? polygonColors[polygonIndex] : fillColor;
+            drawPolygon(camera, surface, polygonIndex, color, zbuffer, clip, state);
+            return;
+        }
+        const std::vector<int>& polygon = polygons[polygonIndex];
+        for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+            camera.shadeTriangle<3>(surface, projected[polygon[0]], projected[polygon[i]], projected[polygon[i + 1]],
+                                    &vertexShades[polygon[0] * 3], &vertexShades[polygon[i] * 3], &vertexShades[polygon[i + 1] * 3],
+                                    GouraudShader(), zbuffer, clip, state);
+        }
+    }
+
+    // Отрисовка рёбер, принадлежащих видимым полигонам текущего кадра (после collectVisibleTriangles)
+    template <typename State = OpaqueRaster>
+    void drawVisibleEdges(Camera3D& camera, SDL_Surface* surface, uint32_t color, Zbuffer& zbuffer,
+                          const SDL_Rect* clip = nullptr, const State& state = State()) {
+        for (size_t e = 0; e < edges.size(); ++e) {
+            bool visible = false;
+            for (int i = edgePolygonStart[e]; i < edgePolygonStart[e + 1] && !visible; ++i) {
+                visible = polygonVisible[edgePolygons[i]] != 0;
+            }
+            if (!visible) continue;
+
+            const auto& edge = edges[e];
+            // Отрисовываем ребро с соответствующим цветом
+            uint32_t edgeColor = color;
+            if ((edge.first == 2 && edge.second == 3) || (edge.first == 3 && edge.second == 2)) {
+                edgeColor = 0xFFFF00;  // Желтый цвет
             }
+            if ((edge.first == 3 && edge.second == 0) || (edge.first == 0 && edge.second == 3)) {
+                edgeColor = 0xFF00FF;  // Фиолетовый цвет
+            }
+            camera.drawLine(surface, projected[edge.first], projected[edge.second], edgeColor, zbuffer, clip, state);
+        }
+    }
+
+    // Отрисовка модели отдельно от сцены (порядок художника только внутри модели)
+    void draw(Camera3D& camera, SDL_Surface* surface, uint32_t color, uint32_t fill_color, Zbuffer &zbuffer) {
+        std::vector<DepthRecord> records;
+        collectVisibleTriangles(camera, 0, records);
+        std::stable_sort(records.begin(), records.end(),
+            [](const DepthRecord& a, const DepthRecord& b) { return a.key < b.key; });
+
+        for (const auto& record : records) {
+            drawPolygon(camera, surface, record.triangle, fill_color, zbuffer);
         }
+        drawVisibleEdges(camera, surface, color, zbuffer);
     }
     
     float getRotationX() const { return rotationX; }
@@ -188,8 +649,119 @@ public:
         updateTransformedVertices();
     }
 
+    // Установить мировую матрицу родительского узла.
+    // Собственные преобразования модели задаются в пространстве родителя.
+    void setParentMatrix(const Matrix& matrix) {
+        parentMatrix = matrix;
+        updateTransformedVertices();
+    }
+
+    const BoundingBox& getBounds() const {
+        return bounds;
+    }
+
+    uint32_t getFillColor() const { return fillColor; }
+    void setFillColor(uint32_t color) {
+        if (color != fillColor) geometryVersion++;
+        fillColor = color;
+    }
+
+    // Цвета вершин 0xRRGGBB для освещения, по одному на вершину (пустой вектор — у всех fillColor)
+    void setVertexColors(const std::vector<uint32_t>& colors) {
+        if (!colors.empty() && colors.size() != vertices.getCols()) return;
+        vertexColors = colors;
+        geometryVersion++;
+    }
+    const std::vector<uint32_t>& getVertexColors() const { return vertexColors; }
+
+    // Нормали вершин в системе модели (пустой вектор — средние нормали прилегающих граней)
+    void setVertexNormals(const std::vector<Position3D>& normals) {
+        if (!normals.empty() && normals.size() != vertices.getCols()) return;
+        vertexNormals = normals;
+        geometryVersion++;
+    }
+    const std::vector<Position3D>& getVertexNormals() const { return vertexNormals; }
+
+    // Текстурные координаты вершин
+    void setVertexUVs(const std::vector<Position2D>& uvs) {
+        if (!uvs.empty() && uvs.size() != vertices.getCols()) return;
+        vertexUVs = uvs;
+        geometryVersion++;
+    }
+    const std::vector<Position2D>& getVertexUVs() const { return vertexUVs; }
+
+    // Текстурные координаты углов полигона в порядке его вершин; важнее координат вершин,
+    // поэтому общая вершина соседних граней может иметь на каждой грани свои координаты
+    void setPolygonUVs(size_t polygonIndex, const std::vector<Position2D>& uvs) {
+        if (polygonIndex >= polygons.size() || (!uvs.empty() && uvs.size() != polygons[polygonIndex].size())) return;
+        polygonUVs[polygonIndex] = uvs;
+        geometryVersion++;
+    }
+
+    // Координаты углов всех полигонов проекцией на грани ограничивающего параллелепипеда модели:
+    // полигон проецируется вдоль оси, к которой ближе всего его нормаль, и получает 0..1 по двум другим осям
+    void generateBoxUVs() {
+        size_t count = vertices.getCols();
+        if (count == 0) return;
+        float low[3], high[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            low[axis] = high[axis] = vertices.at(axis, 0);
+            for (size_t i = 1; i < count; ++i) {
+                low[axis] = std::min(low[axis], vertices.at(axis, i));
+                high[axis] = std::max(high[axis], vertices.at(axis, i));
+            }
+        }
+        auto normalized = [&](int axis, int index) {
+            float size = high[axis] - low[axis];
+            return size > 0.0f ? (vertices.at(axis, index) - low[axis]) / size : 0.0f;
+        };
+
+        for (size_t p = 0; p < polygons.size(); ++p) {
+            const std::vector<int>& polygon = polygons[p];
+            if (polygon.size() < 3) continue;
+            float edge1[3], edge2[3];
+            for (int axis = 0; axis < 3; ++axis) {
+                edge1[axis] = vertices.at(axis, polygon[1]) - vertices.at(axis, polygon[0]);
+                edge2[axis] = vertices.at(axis, polygon[2]) - vertices.at(axis, polygon[0]);
+            }
+            float normal[3] = { std::fabs(edge1[1] * edge2[2] - edge1[2] * edge2[1]),
+                                std::fabs(edge1[2] * edge2[0] - edge1[0] * edge2[2]),
+                                std::fabs(edge1[0] * edge2[1] - edge1[1] * edge2[0]) };
+            // Вдоль X и Z вертикаль изображения — ось Y (верх текстуры наверху), вдоль Y — ось Z
+            int uAxis = 0, vAxis = 1;
+            if (normal[0] >= normal[1] && normal[0] >= normal[2]) uAxis = 2;
+            else if (normal[1] >= normal[2]) vAxis = 2;
+
+            std::vector<Position2D> uvs(polygon.size());
+            for (size_t k = 0; k < polygon.size(); ++k) {
+                float v = normalized(vAxis, polygon[k]);
+                uvs[k] = Position2D(normalized(uAxis, polygon[k]), vAxis == 1 ? 1.0f - v : v);
+            }
+            polygonUVs[p] = uvs;
+        }
+        geometryVersion++;
+    }
+
+    // Текстура полигонов, у которых есть текстурные координаты (nullptr — заливка цветом)
+    void setTexture(const std::shared_ptr<Texture>& newTexture) {
+        texture = newTexture;
+        geometryVersion++;
+    }
+    const std::shared_ptr<Texture>& getTexture() const { return texture; }
+
+    bool isDynamic() const { return dynamic; }
+    void setDynamic(bool value) { dynamic = value; }
+
+    uint64_t getTransformVersion() const { return transformVersion; }
+    uint64_t getGeometryVersion() const { return geometryVersion; }
+
+    // Общая версия модели: растёт при любом изменении, влияющем на изображение
+    uint64_t getVersion() const { return transformVersion + geometryVersion; }
+
     // Добавление полигона
     void addPolygon(const std::vector<int>& vertexIndices) {
+        adjacencyDirty = true;
+        geometryVersion++;
         switch(vertexIndices.size()) {
             case 3: {
                 polygons.push_back(vertexIndices);
@@ -208,6 +780,13 @@ public:
                 }
                 break;
         }    
+        polygonUVs.emplace_back();
+    }
+
+    // Добавление полигона с текстурными координатами углов (см. setPolygonUVs)
+    void addPolygon(const std::vector<int>& vertexIndices, const std::vector<Position2D>& uvs) {
+        addPolygon(vertexIndices);
+        setPolygonUVs(polygons.size() - 1, uvs);
     }
 
     static std::shared_ptr<Model3D> createTriangle(float size = 1.0f)
@@ -344,9 +923,258 @@ public:
         // Грань нижняя
         cube->addPolygon({4, 0, 1});
         cube->addPolygon({4, 1, 5});
+
+        // Каждая грань получает текстуру целиком
+        cube->generateBoxUVs();
         return cube;
     }
 
+    // Создание сферы из rings поясов по широте и segments секторов по долготе.
+    // Полюса — отдельные вершины, у полюсов треугольники, между поясами — пары треугольников.
+    static std::shared_ptr<Model3D> createSphere(float radius = 0.5f, int rings = 16, int segments = 32) {
+        rings = std::max(rings, 2);
+        segments = std::max(segments, 3);
+        int bottom = 1 + (rings - 1) * segments;
+        auto sphere = std::make_shared<Model3D>(bottom + 1);
+        sphere->model_size_X = 1.0f;
+        sphere->model_size_Y = 1.0f;
+        sphere->model_size_Z = 1.0f;
+
+        sphere->modelSizeXs = radius * 2.0f;
+        sphere->modelSizeYs = radius * 2.0f;
+        sphere->modelSizeZs = radius * 2.0f;
+
+        sphere->rotationX = 0.0f;
+        sphere->rotationY = 0.0f;
+        sphere->rotationZ = 0.0f;
+
+        // Вершины пишутся напрямую: setVertex пересчитывает все преобразованные вершины на каждый вызов
+        auto place = [&](int index, float x, float y, float z) {
+            sphere->vertices.at(0, index) = x;
+            sphere->vertices.at(1, index) = y;
+            sphere->vertices.at(2, index) = z;
+        };
+        // Вершина j-го сектора i-го пояса (пояса от 1 до rings - 1 сверху вниз)
+        auto ringVertex = [&](int ring, int segment) {
+            return 1 + (ring - 1) * segments + segment % segments;
+        };
+        const float PI = 3.14159265358979f;
+        place(0, 0.0f, radius, 0.0f);
+        place(bottom, 0.0f, -radius, 0.0f);
+        for (int ring = 1; ring < rings; ++ring) {
+            float latitude = PI * ring / rings;
+            for (int segment = 0; segment < segments; ++segment) {
+                float longitude = 2.0f * PI * segment / segments;
+                place(ringVertex(ring, segment), radius * std::sin(latitude) * std::cos(longitude),
+                      radius * std::cos(latitude), -radius * std::sin(latitude) * std::sin(longitude));
+            }
+        }
+        sphere->geometryVersion++;
+        sphere->updateTransformedVertices();
+
+        // Обход против часовой стрелки снаружи, как у куба: нормали наружу
+        for (int segment = 0; segment < segments; ++segment) {
+            sphere->addEdge(0, ringVertex(1, segment));
+            sphere->addPolygon({0, ringVertex(1, segment), ringVertex(1, segment + 1)});
+            for (int ring = 1; ring < rings - 1; ++ring) {
+                int a = ringVertex(ring, segment), b = ringVertex(ring, segment + 1);
+                int c = ringVertex(ring + 1, segment), d = ringVertex(ring + 1, segment + 1);
+                sphere->addEdge(a, b);
+                sphere->addEdge(a, c);
+                sphere->addPolygon({a, c, d});
+                sphere->addPolygon({a, d, b});
+            }
+            sphere->addEdge(ringVertex(rings - 1, segment), ringVertex(rings - 1, segment + 1));
+            sphere->addEdge(ringVertex(rings - 1, segment), bottom);
+            sphere->addPolygon({ringVertex(rings - 1, segment), bottom, ringVertex(rings - 1, segment + 1)});
+        }
+        return sphere;
+    }
+
+    // Сфера из икосаэдра, каждая грань которого subdivisions раз делится на четыре с выносом
+    // новых вершин на сферу: 20 * 4^subdivisions почти одинаковых треугольников без сгущения у полюсов.
+    static std::shared_ptr<Model3D> createIcosphere(float radius = 0.5f, int subdivisions = 2) {
+        subdivisions = std::min(std::max(subdivisions, 0), 7);
+        const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+        std::vector<Position3D> points = {
+            { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+            { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+            { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 }
+        };
+        std::vector<int> faces = {
+            0, 11, 5,  0, 5, 1,   0, 1, 7,   0, 7, 10,  0, 10, 11,
+            1, 5, 9,   5, 11, 4,  11, 10, 2, 10, 7, 6,  7, 1, 8,
+            3, 9, 4,   3, 4, 2,   3, 2, 6,   3, 6, 8,   3, 8, 9,
+            4, 9, 5,   2, 4, 11,  6, 2, 10,  8, 6, 7,   9, 8, 1
+        };
+        for (Position3D& point : points) point.normalize();
+        // Обход против часовой стрелки снаружи, как у createSphere; деление граней его сохраняет
+        for (size_t f = 0; f < faces.size(); f += 3) {
+            const Position3D& a = points[faces[f]];
+            Position3D normal = (points[faces[f + 1]] - a).cross(points[faces[f + 2]] - a);
+            if (normal.dot(a + points[faces[f + 1]] + points[faces[f + 2]]) < 0.0f) std::swap(faces[f + 1], faces[f + 2]);
+        }
+
+        auto edgeKey = [](int a, int b) {
+            return (uint64_t)(uint32_t)std::min(a, b) << 32 | (uint32_t)std::max(a, b);
+        };
+        for (int level = 0; level < subdivisions; ++level) {
+            // Середина ребра общая для двух граней
+            std::unordered_map<uint64_t, int> middles;
+            auto middle = [&](int a, int b) {
+                auto inserted = middles.insert({ edgeKey(a, b), (int)points.size() });
+                if (inserted.second) {
+                    Position3D point = points[a] + points[b];
+                    point.normalize();
+                    points.push_back(point);
+                }
+                return inserted.first->second;
+            };
+            std::vector<int> divided;
+            divided.reserve(faces.size() * 4);
+            for (size_t f = 0; f < faces.size(); f += 3) {
+                int a = faces[f], b = faces[f + 1], c = faces[f + 2];
+                int ab = middle(a, b), bc = middle(b, c), ca = middle(c, a);
+                divided.insert(divided.end(), { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca });
+            }
+            faces.swap(divided);
+        }
+
+        auto sphere = std::make_shared<Model3D>(points.size());
+        sphere->model_size_X = 1.0f;
+        sphere->model_size_Y = 1.0f;
+        sphere->model_size_Z = 1.0f;
+
+        sphere->modelSizeXs = radius * 2.0f;
+        sphere->modelSizeYs = radius * 2.0f;
+        sphere->modelSizeZs = radius * 2.0f;
+
+        sphere->rotationX = 0.0f;
+        sphere->rotationY = 0.0f;
+        sphere->rotationZ = 0.0f;
+
+        for (size_t i = 0; i < points.size(); ++i) {
+            sphere->vertices.at(0, i) = radius * points[i].getX();
+            sphere->vertices.at(1, i) = radius * points[i].getY();
+            sphere->vertices.at(2, i) = radius * points[i].getZ();
+        }
+        sphere->geometryVersion++;
+        sphere->updateTransformedVertices();
+
+        // Каждое ребро заносится один раз — из грани, где оно идёт по возрастанию вершин
+        sphere->polygons.reserve(faces.size() / 3);
+        for (size_t f = 0; f < faces.size(); f += 3) {
+            for (int k = 0; k < 3; ++k) {
+                int a = faces[f + k], b = faces[f + (k + 1) % 3];
+                if (a < b) sphere->addEdge(a, b);
+            }
+            sphere->addPolygon({ faces[f], faces[f + 1], faces[f + 2] });
+        }
+        return sphere;
+    }
+
+    // Набор из count отдельных треугольников, разбросанных по кубу со стороной extent с центром в начале координат.
+    // Треугольники равносторонние, сторона распределена логарифмически равномерно в [minSize, maxSize],
+    // плоскость повёрнута случайно, но лицевая сторона смотрит в полупространство +Z (к камере по умолчанию),
+    // поэтому почти все треугольники доходят до растеризации. Рёбер нет: каркас удвоил бы работу растеризатора.
+    // Одинаковые параметры и seed дают одинаковый набор на любой платформе.
+    static std::shared_ptr<Model3D> createTriangleSoup(int count, float extent = 4.0f, float minSize = 0.05f,
+                                                       float maxSize = 0.2f, uint32_t seed = 1) {
+        count = std::max(count, 1);
+        minSize = std::max(minSize, 1e-4f);
+        maxSize = std::max(maxSize, minSize);
+        auto soup = std::make_shared<Model3D>((size_t)count * 3);
+        soup->model_size_X = 1.0f;
+        soup->model_size_Y = 1.0f;
+        soup->model_size_Z = 1.0f;
+
+        soup->modelSizeXs = extent;
+        soup->modelSizeYs = extent;
+        soup->modelSizeZs = extent;
+
+        soup->rotationX = 0.0f;
+        soup->rotationY = 0.0f;
+        soup->rotationZ = 0.0f;
+
+        // mt19937 выдаёт одну и ту же последовательность везде, в отличие от распределений <random>
+        std::mt19937 random(seed);
+        auto uniform = [&](float low, float high) {
+            return low + (high - low) * (float)(random() >> 8) * (1.0f / 16777216.0f);
+        };
+        const float PI = 3.14159265358979f;
+        float logMin = std::log(minSize), logMax = std::log(maxSize);
+        for (int i = 0; i < count; ++i) {
+            Position3D center(uniform(-0.5f, 0.5f) * extent, uniform(-0.5f, 0.5f) * extent, uniform(-0.5f, 0.5f) * extent);
+            float size = std::exp(uniform(logMin, logMax));
+            // Нормаль в пределах 60 градусов от +Z и базис плоскости треугольника
+            float tilt = std::acos(uniform(0.5f, 1.0f)), heading = uniform(0.0f, 2.0f * PI);
+            Position3D normal(std::sin(tilt) * std::cos(heading), std::sin(tilt) * std::sin(heading), std::cos(tilt));
+            Position3D u = normal.cross(Position3D(0.0f, 1.0f, 0.0f));
+            u.normalize();
+            Position3D v = normal.cross(u);
+            // Вершины на окружности радиусом size / sqrt(3) через 120 градусов против часовой стрелки вокруг нормали
+            float spin = uniform(0.0f, 2.0f * PI), circumradius = size / std::sqrt(3.0f);
+            for (int k = 0; k < 3; ++k) {
+                float angle = spin + k * 2.0f * PI / 3.0f;
+                float along = circumradius * std::cos(angle), across = circumradius * std::sin(angle);
+                int index = i * 3 + k;
+                soup->vertices.at(0, index) = center.getX() + along * u.getX() + across * v.getX();
+                soup->vertices.at(1, index) = center.getY() + along * u.getY() + across * v.getY();
+                soup->vertices.at(2, index) = center.getZ() + along * u.getZ() + across * v.getZ();
+            }
+        }
+        soup->geometryVersion++;
+        soup->updateTransformedVertices();
+
+        soup->polygons.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            soup->addPolygon({ i * 3, i * 3 + 1, i * 3 + 2 });
+        }
+        return soup;
+    }
+
+    // Стопка из layers квадратов со стороной size, параллельных плоскости XY и обращённых к +Z,
+    // равномерно по глубине от -depth / 2 до depth / 2. Каждый пиксель под стопкой закрыт layers раз:
+    // сложность по глубине задаётся числом слоёв, площадь на экране — размером.
+    static std::shared_ptr<Model3D> createQuadStack(int layers, float size = 2.0f, float depth = 2.0f) {
+        layers = std::max(layers, 1);
+        auto stack = std::make_shared<Model3D>((size_t)layers * 4);
+        stack->model_size_X = 1.0f;
+        stack->model_size_Y = 1.0f;
+        stack->model_size_Z = 1.0f;
+
+        stack->modelSizeXs = size;
+        stack->modelSizeYs = size;
+        stack->modelSizeZs = depth;
+
+        stack->rotationX = 0.0f;
+        stack->rotationY = 0.0f;
+        stack->rotationZ = 0.0f;
+
+        float half = size / 2.0f;
+        const float corners[4][2] = { { -half, -half }, { half, -half }, { half, half }, { -half, half } };
+        for (int layer = 0; layer < layers; ++layer) {
+            float z = layers > 1 ? depth * ((float)layer / (layers - 1) - 0.5f) : 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                stack->vertices.at(0, layer * 4 + k) = corners[k][0];
+                stack->vertices.at(1, layer * 4 + k) = corners[k][1];
+                stack->vertices.at(2, layer * 4 + k) = z;
+            }
+        }
+        stack->geometryVersion++;
+        stack->updateTransformedVertices();
+
+        // Контур каждого слоя и два треугольника против часовой стрелки при взгляде с +Z
+        stack->polygons.reserve(layers * 2);
+        for (int layer = 0; layer < layers; ++layer) {
+            int first = layer * 4;
+            for (int k = 0; k < 4; ++k) stack->addEdge(first + k, first + (k + 1) % 4);
+            stack->addPolygon({ first, first + 1, first + 2 });
+            stack->addPolygon({ first, first + 2, first + 3 });
+        }
+        return stack;
+    }
+
     // Перемещение
     void translate(float dx, float dy, float dz) {
         position.move(dx, dy, dz);
@@ -365,37 +1193,8 @@ public:
     }
 
     Position3D getPosition() const {
-        Position3D firstModelEdge, secondModelEdge, centerModelEdge;
-        firstModelEdge = getTransformedVertexPos(0);
-        secondModelEdge = getTransformedVertexPos(0);
-
-        for(size_t i = 0; i < vertices.getCols(); i++) {
-            Position3D currentEdge = getTransformedVertexPos(i);
-            if (currentEdge.getX() < firstModelEdge.getX()) {
-                firstModelEdge.setX(currentEdge.getX());
-            }
-            if (currentEdge.getY() < firstModelEdge.getY()) {
-                firstModelEdge.setY(currentEdge.getY());
-            }
-            if (currentEdge.getZ() < firstModelEdge.getZ()) {
-                firstModelEdge.setZ(currentEdge.getZ());
-            }
-            if (currentEdge.getX() > secondModelEdge.getX()) {
-                secondModelEdge.setX(currentEdge.getX());
-            }
-            if (currentEdge.getY() > secondModelEdge.getY()) {
-                secondModelEdge.setY(currentEdge.getY());
-            }
-            if (currentEdge.getZ() > secondModelEdge.getZ()) {
-                secondModelEdge.setZ(currentEdge.getZ());
-            }
-        }
-        centerModelEdge.setX((firstModelEdge.getX() + secondModelEdge.getX()) * 1.0f / 2.0f);
-        centerModelEdge.setY((firstModelEdge.getY() + secondModelEdge.getY()) * 1.0f / 2.0f);
-        centerModelEdge.setZ((firstModelEdge.getZ() + secondModelEdge.getZ()) * 1.0f / 2.0f);
-        // std::cout<< "centerModelEdge = " << centerModelEdge.getX() << " " << centerModelEdge.getY() << " " << centerModelEdge.getZ() << std::endl;
-        return centerModelEdge;
-        //return position;
+        // Центр ограничивающего параллелепипеда преобразованных вершин
+        return bounds.getCenter();
     }
 
     // Масштабирование
@@ -498,6 +1297,28 @@ public:
         return visiblePolygons;
     }
 
+    // Ближайшее пересечение луча с полигонами модели, если оно ближе distance.
+    // Полигоны разбиваются на треугольники веером от первой вершины.
+    bool intersectRay(const Ray& ray, float& distance, int& polygonIndex) const {
+        bool hit = false;
+        for (size_t p = 0; p < polygons.size(); ++p) {
+            const std::vector<int>& polygon = polygons[p];
+            if (polygon.size() < 3) continue;
+
+            Position3D a = getTransformedVertexPos(polygon[0]);
+            for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+                float t;
+                if (ray.intersectTriangle(a, getTransformedVertexPos(polygon[i]), getTransformedVertexPos(polygon[i + 1]), t)
+                    && t < distance) {
+                    distance = t;
+                    polygonIndex = (int)p;
+                    hit = true;
+                }
+            }
+        }
+        return hit;
+    }
+
     std::vector<std::vector<int>> getPolygons()
     {
         return polygons;  // Полигоны модели
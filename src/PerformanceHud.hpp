@@ -0,0 +1,153 @@
+#ifndef _PERFORMANCE_HUD_HPP_
+#define _PERFORMANCE_HUD_HPP_
+
+#include "BitmapFont.hpp"
+#include "Scene3D.hpp"
+#include "JobSystem.hpp"
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+// Панель производительности поверх кадра: частота кадров, график времени кадров, время этапов
+// и счётчики последнего render(). Все данные лежат в массивах фиксированного размера, текст
+// форматируется в буфер на стеке: рисование панели не выделяет память и не пишет в консоль,
+// поэтому не искажает измерения, которые показывает.
+class PerformanceHud {
+private:
+    static const int COLUMNS = 30;          // Символов в строке текста
+    static const int HISTORY = 180;         // Кадров в графике (столбец на кадр)
+    static const int GRAPH_HEIGHT = 40;     // Высота графика при масштабе 1
+    static const int PADDING = 4;
+    static const int TEXT_LINES = 5;
+    static const int PANEL_WIDTH = COLUMNS * BitmapFont::ADVANCE + 2 * PADDING;  // При масштабе 1
+
+    float frameMs[HISTORY];       // Время отрисовки кадров по кругу
+    float intervalMs[HISTORY];    // Время между соседними кадрами
+    int next;                     // Куда писать следующий кадр
+    int count;                    // Сколько кадров накоплено (не больше HISTORY)
+    uint64_t lastFrameNs;
+    RenderStats last;             // Счётчики последнего кадра
+
+    // Затемнение прямоугольника вдвое: текст читается на любом фоне
+    static void darken(SDL_Surface* surface, const SDL_Rect& rect) {
+        for (int y = rect.y; y < rect.y + rect.h; ++y) {
+            uint32_t* row = (uint32_t*)((uint8_t*)surface->pixels + y * surface->pitch) + rect.x;
+            for (int x = 0; x < rect.w; ++x) {
+                row[x] = (row[x] >> 1) & 0x7F7F7F7Fu;
+            }
+        }
+    }
+
+    static void fill(SDL_Surface* surface, int x, int y, int w, int h, uint32_t color) {
+        for (int line = y; line < y + h; ++line) {
+            uint32_t* row = (uint32_t*)((uint8_t*)surface->pixels + line * surface->pitch);
+            std::fill(row + x, row + x + w, color);
+        }
+    }
+
+public:
+    PerformanceHud() : next(0), count(0), lastFrameNs(0) {
+        std::fill(frameMs, frameMs + HISTORY, 0.0f);
+        std::fill(intervalMs, intervalMs + HISTORY, 0.0f);
+    }
+
+    // Учёт только что нарисованного кадра: время его отрисовки и счётчики сцены
+    void addFrame(double renderMs, const RenderStats& stats) {
+        uint64_t now = JobSystem::nowNs();
+        frameMs[next] = (float)renderMs;
+        intervalMs[next] = lastFrameNs ? (float)((now - lastFrameNs) / 1e6) : (float)renderMs;
+        lastFrameNs = now;
+        next = (next + 1) % HISTORY;
+        count = std::min(count + 1, HISTORY);
+        last = stats;
+    }
+
+    // Масштаб шрифта и графика под размер поверхности
+    static int scaleFor(const SDL_Surface* surface) {
+        return surface->h >= 900 ? 2 : 1;
+    }
+
+    // Прямоугольник, который займёт панель на surface (левый верхний угол)
+    static SDL_Rect area(const SDL_Surface* surface) {
+        int scale = scaleFor(surface);
+        SDL_Rect rect = { 0, 0, PANEL_WIDTH * scale,
+                          (2 * PADDING + TEXT_LINES * BitmapFont::LINE_HEIGHT + GRAPH_HEIGHT) * scale };
+        rect.w = std::min(rect.w, surface->w);
+        rect.h = std::min(rect.h, surface->h);
+        return rect;
+    }
+
+    // Панель в левом верхнем углу surface (32 бита на пиксель). Возвращает занятый прямоугольник,
+    // пустой, если панель не нарисована.
+    SDL_Rect draw(SDL_Surface* surface) const {
+        SDL_Rect rect = area(surface);
+        if (surface->format->BytesPerPixel != 4 || rect.w <= 0 || rect.h <= 0) return SDL_Rect{ 0, 0, 0, 0 };
+        int scale = scaleFor(surface);
+
+        if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+        darken(surface, rect);
+
+        double totalFrame = 0.0, totalInterval = 0.0, worst = 0.0;
+        for (int i = 0; i < count; ++i) {
+            totalFrame += frameMs[i];
+            totalInterval += intervalMs[i];
+            worst = std::max(worst, (double)frameMs[i]);
+        }
+        double averageFrame = count ? totalFrame / count : 0.0;
+        double fps = totalInterval > 0.0 ? count * 1e3 / totalInterval : 0.0;
+
+        uint32_t white = SDL_MapRGB(surface->format, 0xFF, 0xFF, 0xFF);
+        uint32_t gray = SDL_MapRGB(surface->format, 0xA0, 0xA0, 0xA0);
+        char line[64];
+        int x = PADDING * scale;
+        int y = PADDING * scale;
+        int step = BitmapFont::LINE_HEIGHT * scale;
+
+        snprintf(line, sizeof(line), "%.0f fps %.2f ms max %.2f", fps, averageFrame, worst);
+        BitmapFont::drawText(surface, x, y, line, white, scale, &rect);
+        y += step;
+        snprintf(line, sizeof(line), "upd %.2f cull %.2f sort %.2f", last.updateNs / 1e6, last.cullNs / 1e6,
+                 last.sortNs / 1e6);
+        BitmapFont::drawText(surface, x, y, line, gray, scale, &rect);
+        y += step;
+        snprintf(line, sizeof(line), "raster %.2f present %.2f", last.rasterNs / 1e6, last.presentNs / 1e6);
+        BitmapFont::drawText(surface, x, y, line, gray, scale, &rect);
+        y += step;
+        snprintf(line, sizeof(line), "tri %llu/%llu drawn",
+                 (unsigned long long)last.trianglesRasterized, (unsigned long long)last.trianglesSubmitted);
+        BitmapFont::drawText(surface, x, y, line, gray, scale, &rect);
+        y += step;
+        if (last.raster.spans) {
+            snprintf(line, sizeof(line), "px %lluk %.1f MB", (unsigned long long)(last.raster.pixelsWritten / 1000),
+                     last.raster.bytesTouched / 1e6);
+        } else {
+            snprintf(line, sizeof(line), "px - (raster stats off)");
+        }
+        BitmapFont::drawText(surface, x, y, line, gray, scale, &rect);
+        y += step;
+
+        // График: столбец на кадр, от старых к новым; линия — 16.7 мс, шкала — до 33.3 мс
+        int graphHeight = GRAPH_HEIGHT * scale;
+        int graphBottom = std::min(y + graphHeight, rect.y + rect.h);
+        const double scaleMs = 1000.0 / 30.0;
+        uint32_t good = SDL_MapRGB(surface->format, 0x40, 0xD0, 0x40);
+        uint32_t slow = SDL_MapRGB(surface->format, 0xE0, 0x40, 0x40);
+        int columns = std::min(count, (rect.w - x) / scale);
+        for (int i = 0; i < columns; ++i) {
+            float ms = frameMs[(next - columns + i + HISTORY) % HISTORY];
+            int height = (int)std::min((double)graphHeight, ms / scaleMs * graphHeight);
+            int top = std::max(y, graphBottom - height);
+            fill(surface, x + i * scale, top, scale, graphBottom - top, ms > 1000.0 / 60.0 ? slow : good);
+        }
+        int target = graphBottom - graphHeight / 2;
+        if (target >= y && target < graphBottom && rect.w > x) {
+            fill(surface, x, target, std::min(HISTORY * scale, rect.w - x), 1, white);
+        }
+        if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+        return rect;
+    }
+};
+
+#endif // _PERFORMANCE_HUD_HPP_
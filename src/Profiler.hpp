@@ -0,0 +1,216 @@
+#ifndef _PROFILER_HPP_
+#define _PROFILER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Профилировщик этапов кадра: интервалы PROFILE_SCOPE из всех потоков попадают в кольцевой буфер
+// и выгружаются в формате трассы Chrome (chrome://tracing, Perfetto).
+//
+// Замеры включаются при сборке с ENGINE_PROFILE (make PROFILE=1). Без него макросы пусты
+// и не оставляют в коде ни вызовов, ни переменных.
+
+// Интервал работы одного потока
+struct ProfileEvent {
+    const char* name;   // Строковый литерал или другая строка, живущая до выгрузки
+    uint64_t startNs;
+    uint64_t endNs;
+    uint32_t thread;    // Номер потока профилировщика (см. Profiler::threadId)
+    int32_t arg;        // Модель, полоса и т. п.; -1 — нет
+};
+
+class Profiler {
+private:
+    // Ячейка кольца. sequence нечётна, пока ячейка пишется, и равна 2 * (номер записи + 1) после записи:
+    // читатель берёт ячейку, только если sequence до и после чтения совпадает с ожидаемой.
+    // Поля атомарны, чтобы одновременное чтение и запись не были гонкой данных.
+    struct Slot {
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<uint64_t> startNs{ 0 };
+        std::atomic<uint64_t> endNs{ 0 };
+        std::atomic<uint64_t> threadAndArg{ 0 };
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+    std::atomic<uint64_t> head;          // Номер следующей записи; старые записи затираются по кругу
+    std::atomic<uint64_t> firstTicket;   // Записи до этого номера сброшены (reset)
+    std::atomic<uint32_t> threadCount;
+
+    std::mutex namesMutex;               // Только для имён потоков, не для записи интервалов
+    std::vector<std::string> threadNames;
+
+    explicit Profiler(size_t capacity) : head(0), firstTicket(0), threadCount(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.reset(new Slot[size]);
+        mask = size - 1;
+    }
+
+    static void writeEscaped(FILE* file, const char* text) {
+        for (; *text; ++text) {
+            if (*text == '"' || *text == '\\') fputc('\\', file);
+            fputc(*text, file);
+        }
+    }
+
+public:
+    static const size_t DEFAULT_CAPACITY = 1 << 18;
+
+    // Один профилировщик на процесс: в него пишут все потоки всех систем задач
+    static Profiler& instance() {
+        static Profiler profiler(DEFAULT_CAPACITY);
+        return profiler;
+    }
+
+    // Собран ли движок с замерами (ENGINE_PROFILE)
+    static constexpr bool compiledIn() {
+#ifdef ENGINE_PROFILE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static uint64_t nowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Номер вызывающего потока, выдаётся при первом обращении
+    uint32_t threadId() {
+        static thread_local uint32_t id = ~0u;
+        if (id == ~0u) {
+            id = threadCount.fetch_add(1);
+        }
+        return id;
+    }
+
+    // Имя вызывающего потока в трассе; index >= 0 дописывается через пробел ("worker 3")
+    void nameThread(const char* name, int index = -1) {
+        uint32_t id = threadId();
+        std::string text = name;
+        if (index >= 0) text += " " + std::to_string(index);
+        std::lock_guard<std::mutex> lock(namesMutex);
+        if (threadNames.size() <= id) threadNames.resize(id + 1);
+        threadNames[id] = text;
+    }
+
+    // Запись интервала без блокировок: место в кольце выделяется атомарным счётчиком
+    void record(const char* name, uint64_t startNs, uint64_t endNs, int32_t arg = -1) {
+        uint64_t ticket = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[ticket & mask];
+        slot.sequence.store(2 * ticket + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.startNs.store(startNs, std::memory_order_relaxed);
+        slot.endNs.store(endNs, std::memory_order_relaxed);
+        slot.threadAndArg.store((uint64_t)threadId() << 32 | (uint32_t)arg, std::memory_order_relaxed);
+        slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+    }
+
+    // Интервалы, оставшиеся в кольце, от старых к новым. Можно вызывать, пока другие потоки пишут:
+    // недописанные и уже затёртые ячейки пропускаются.
+    std::vector<ProfileEvent> snapshot() const {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(end > mask + 1 ? end - (mask + 1) : 0, firstTicket.load(std::memory_order_acquire));
+        std::vector<ProfileEvent> events;
+        events.reserve(end - begin);
+        for (uint64_t ticket = begin; ticket < end; ++ticket) {
+            const Slot& slot = slots[ticket & mask];
+            uint64_t expected = 2 * ticket + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != expected) continue;
+            uint64_t threadAndArg = slot.threadAndArg.load(std::memory_order_relaxed);
+            ProfileEvent event = { slot.name.load(std::memory_order_relaxed), slot.startNs.load(std::memory_order_relaxed),
+                                   slot.endNs.load(std::memory_order_relaxed), (uint32_t)(threadAndArg >> 32),
+                                   (int32_t)(uint32_t)threadAndArg };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != expected) continue;
+            events.push_back(event);
+        }
+        return events;
+    }
+
+    // Забыть записанные интервалы (имена потоков остаются)
+    void reset() {
+        firstTicket.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Выгрузка в JSON трассы Chrome: события "X" с длительностью, время в микросекундах от первого события
+    bool writeChromeTrace(const char* path) {
+        std::vector<ProfileEvent> events = snapshot();
+        FILE* file = fopen(path, "w");
+        if (!file) return false;
+
+        uint64_t origin = UINT64_MAX;
+        for (const ProfileEvent& event : events) origin = std::min(origin, event.startNs);
+
+        fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        bool first = true;
+        {
+            std::lock_guard<std::mutex> lock(namesMutex);
+            for (size_t id = 0; id < threadNames.size(); ++id) {
+                if (threadNames[id].empty()) continue;
+                fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %zu, \"args\": {\"name\": \"",
+                        first ? "" : ",\n", id);
+                writeEscaped(file, threadNames[id].c_str());
+                fprintf(file, "\"}}");
+                first = false;
+            }
+        }
+        for (const ProfileEvent& event : events) {
+            fprintf(file, "%s{\"name\": \"", first ? "" : ",\n");
+            writeEscaped(file, event.name ? event.name : "?");
+            fprintf(file, "\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+                    event.thread, (event.startNs - origin) / 1e3, (event.endNs - event.startNs) / 1e3);
+            if (event.arg >= 0) fprintf(file, ", \"args\": {\"index\": %d}", event.arg);
+            fprintf(file, "}");
+            first = false;
+        }
+        fprintf(file, "\n]}\n");
+        return fclose(file) == 0;
+    }
+};
+
+// Замер от создания до конца области видимости
+class ProfileScope {
+private:
+    const char* name;
+    int32_t arg;
+    uint64_t startNs;
+
+public:
+    explicit ProfileScope(const char* scopeName, int32_t scopeArg = -1)
+        : name(scopeName), arg(scopeArg), startNs(Profiler::nowNs()) {}
+
+    ~ProfileScope() {
+        Profiler::instance().record(name, startNs, Profiler::nowNs(), arg);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENGINE_PROFILE
+// PROFILE_SCOPE("raster") — интервал до конца блока; PROFILE_SCOPE_ARG("cull", index) — с номером модели или полосы
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_SCOPE_ARG(name, arg) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, (int32_t)(arg))
+#define PROFILE_THREAD(name, index) Profiler::instance().nameThread(name, index)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_SCOPE_ARG(name, arg) ((void)0)
+#define PROFILE_THREAD(name, index) ((void)0)
+#endif
+
+#endif // _PROFILER_HPP_
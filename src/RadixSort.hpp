@@ -0,0 +1,110 @@
+#ifndef _RADIX_SORT_HPP_
+#define _RADIX_SORT_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "JobSystem.hpp"
+
+// Запись кадрового списка треугольников: ключ глубины и ссылка на полигон модели
+struct DepthRecord {
+    uint32_t key;       // Ключ сортировки, см. depthKey
+    uint32_t model;     // Индекс модели в сцене
+    uint32_t triangle;  // Индекс полигона модели
+};
+
+// Ключ для порядка художника: дальние полигоны получают меньший ключ.
+// Биты положительного float монотонны, поэтому сравнение целых совпадает со сравнением глубин.
+inline uint32_t depthKey(float depth) {
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    // Переводим в беззнаковый порядок: отрицательные числа инвертируются целиком
+    bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    // Дальние (большая глубина) должны идти первыми
+    return ~bits;
+}
+
+// Поразрядная сортировка (LSD, 4 прохода по 8 бит) записей по возрастанию ключа.
+// Каждый проход делится на части по потокам системы задач: гистограмма, префиксные суммы, раскладка.
+// Проходы, в которых у всех ключей одинаковый байт, пропускаются. scratch и histograms — буферы
+// вызывающего, переиспользуемые между кадрами.
+inline void radixSortByDepth(std::vector<DepthRecord>& records, std::vector<DepthRecord>& scratch,
+                             std::vector<size_t>& histograms, JobSystem& jobs)
+{
+    const size_t RADIX = 256;
+    const size_t MIN_RECORDS_PER_THREAD = 16384;  // Меньшие части дешевле сортировать в одном потоке
+
+    size_t count = records.size();
+    if (count < 2) return;
+
+    unsigned threadCount = (unsigned)std::min<size_t>(jobs.getConcurrency(), (count + MIN_RECORDS_PER_THREAD - 1) / MIN_RECORDS_PER_THREAD);
+    size_t chunk = (count + threadCount - 1) / threadCount;
+
+    scratch.resize(count);
+    histograms.resize(threadCount * RADIX);
+
+    DepthRecord* source = records.data();
+    DepthRecord* target = scratch.data();
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        std::fill(histograms.begin(), histograms.end(), 0);
+
+        auto countPart = [&](unsigned part) {
+            size_t* histogram = &histograms[part * RADIX];
+            size_t end = std::min(count, (part + 1) * chunk);
+            for (size_t i = part * chunk; i < end; ++i) {
+                histogram[(source[i].key >> shift) & 0xFF]++;
+            }
+        };
+
+        auto scatterPart = [&](unsigned part) {
+            size_t* offsets = &histograms[part * RADIX];
+            size_t end = std::min(count, (part + 1) * chunk);
+            for (size_t i = part * chunk; i < end; ++i) {
+                target[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+            }
+        };
+
+        auto runParts = [&](const auto& job) {
+            jobs.parallelFor("sort", 0, threadCount, 1, [&](size_t begin, size_t end) {
+                for (size_t part = begin; part < end; ++part) job((unsigned)part);
+            });
+        };
+
+        runParts(countPart);
+
+        // Если весь байт одинаков, проход ничего не меняет
+        bool trivial = false;
+        for (size_t digit = 0; digit < RADIX; ++digit) {
+            size_t total = 0;
+            for (unsigned part = 0; part < threadCount; ++part) {
+                total += histograms[part * RADIX + digit];
+            }
+            if (total == count) trivial = true;
+            if (total != 0) break;
+        }
+        if (trivial) continue;
+
+        // Смещения: цифры по возрастанию, внутри цифры — части по порядку (сохраняет устойчивость)
+        size_t offset = 0;
+        for (size_t digit = 0; digit < RADIX; ++digit) {
+            for (unsigned part = 0; part < threadCount; ++part) {
+                size_t& slot = histograms[part * RADIX + digit];
+                size_t partCount = slot;
+                slot = offset;
+                offset += partCount;
+            }
+        }
+
+        runParts(scatterPart);
+        std::swap(source, target);
+    }
+
+    if (source != records.data()) {
+        records.swap(scratch);
+    }
+}
+
+#endif // _RADIX_SORT_HPP_
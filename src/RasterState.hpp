@@ -0,0 +1,242 @@
+#ifndef _RASTER_STATE_HPP_
+#define _RASTER_STATE_HPP_
+
+#include <SDL2/SDL.h>
+#include "Zbuffer.hpp"
+
+#include <cstdint>
+#include <utility>
+
+// Работа растеризатора с буфером глубины
+enum DepthMode {
+    DEPTH_OFF,         // Без проверки и записи; глубина не интерполируется
+    DEPTH_TEST,        // Только проверка
+    DEPTH_TEST_WRITE   // Проверка и запись
+};
+
+// Запись цвета
+enum BlendMode {
+    BLEND_REPLACE,     // Цвет заменяет пиксель
+    BLEND_DISABLED     // Цвет не пишется, обновляется только глубина
+};
+
+// Раскладка пикселей поверхности
+enum PixelLayout {
+    PIXELS_32,         // 4 байта на пиксель, цвет пишется одним словом
+    PIXELS_ANY         // BytesPerPixel берётся из формата поверхности
+};
+
+// Состояние растеризации, известное только во время выполнения.
+// Общий путь: каждая ветвь проверяется на каждом пикселе.
+struct RasterState {
+    DepthMode depth;
+    BlendMode blend;
+    PixelLayout pixels;
+    DepthEncoding encoding;   // Должна совпадать с кодировкой буфера глубины
+
+    // Нужна ли интерполяция 1 / w вдоль строк
+    bool interpolatesDepth() const {
+        return depth != DEPTH_OFF;
+    }
+};
+
+// То же состояние как параметры шаблона. Растеризатор, получивший такой дескриптор,
+// компилируется отдельно для каждого сочетания, и ветви по состоянию из циклов исчезают.
+template <DepthMode Depth, BlendMode Blend, PixelLayout Pixels, DepthEncoding Encoding = DEPTH_VIEW_W>
+struct RasterPermutation {
+    static constexpr DepthMode depth = Depth;
+    static constexpr BlendMode blend = Blend;
+    static constexpr PixelLayout pixels = Pixels;
+    static constexpr DepthEncoding encoding = Encoding;
+
+    static constexpr bool interpolatesDepth() {
+        return Depth != DEPTH_OFF;
+    }
+};
+
+// Счётчики растеризации за кадр (см. CountingRaster)
+struct RasterStats {
+    uint64_t spans = 0;           // Строки треугольников, переданные на заливку
+    uint64_t pixelsTested = 0;    // Пиксели, прошедшие через проверку глубины
+    uint64_t pixelsPassed = 0;    // Из них видимые (без проверки глубины — все)
+    uint64_t pixelsWritten = 0;   // Записи цвета
+    uint64_t bytesTouched = 0;    // Прочитанные и записанные байты глубины и цвета
+
+    void add(const RasterStats& other) {
+        spans += other.spans;
+        pixelsTested += other.pixelsTested;
+        pixelsPassed += other.pixelsPassed;
+        pixelsWritten += other.pixelsWritten;
+        bytesTouched += other.bytesTouched;
+    }
+};
+
+// Состояние State с подсчётом работы: растеризатор ведёт себя так же, но каждый пиксель
+// учитывается в stats, а при заданном overdraw ещё и число записей цвета в каждый пиксель.
+// Подсчёт идёт скалярным путём, векторные ядра заливки для него не используются.
+template <typename State>
+struct CountingRaster : State {
+    RasterStats* stats;
+    uint16_t* overdraw;   // Счётчики записей, width на строку; nullptr — не вести
+    int width;
+
+    CountingRaster(const State& state, RasterStats* counters, uint16_t* overdrawCounts = nullptr, int overdrawWidth = 0)
+        : State(state), stats(counters), overdraw(overdrawCounts), width(overdrawWidth) {}
+};
+
+// Ведёт ли state подсчёт (CountingRaster)
+template <typename State>
+constexpr bool countsRaster(const State&) {
+    return false;
+}
+
+template <typename State>
+constexpr bool countsRaster(const CountingRaster<State>&) {
+    return true;
+}
+
+// Учёт строки треугольника; для состояний без подсчёта ничего не делает
+template <typename State>
+inline void countSpan(const State&) {}
+
+template <typename State>
+inline void countSpan(const CountingRaster<State>& state) {
+    state.stats->spans++;
+}
+
+// Обычная отрисовка сцены: непрозрачный цвет с проверкой и записью глубины в 32-битную поверхность
+typedef RasterPermutation<DEPTH_TEST_WRITE, BLEND_REPLACE, PIXELS_32> OpaqueRaster;
+
+// Запись цвета в пиксель поверхности произвольного формата (цвет уже в формате поверхности)
+inline void storePixel(SDL_Surface* surface, int x, int y, uint32_t color) {
+    int bytes = surface->format->BytesPerPixel;
+    uint8_t* pixel = (uint8_t*)surface->pixels + y * surface->pitch + x * bytes;
+    switch (bytes) {
+        case 1:
+            *pixel = (uint8_t)color;
+            break;
+        case 2:
+            *(uint16_t*)pixel = (uint16_t)color;
+            break;
+        case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+            pixel[0] = (uint8_t)(color >> 16);
+            pixel[1] = (uint8_t)(color >> 8);
+            pixel[2] = (uint8_t)color;
+#else
+            pixel[0] = (uint8_t)color;
+            pixel[1] = (uint8_t)(color >> 8);
+            pixel[2] = (uint8_t)(color >> 16);
+#endif
+            break;
+        default:
+            *(uint32_t*)pixel = color;
+            break;
+    }
+}
+
+// Значение глубины пикселя по интерполированному 1 / w в кодировке state
+template <typename State>
+inline float depthValue(const State& state, float inverseW) {
+    return state.encoding == DEPTH_REVERSE_Z ? inverseW : 1.0f / inverseW;
+}
+
+// Проверка глубины пикселя (и запись при DEPTH_TEST_WRITE); true — пиксель виден.
+// z — значение depthValue; ближе то, что меньше, а при DEPTH_REVERSE_Z — больше.
+template <typename State>
+inline bool passDepth(const State& state, Zbuffer& zbuffer, int x, int y, float z) {
+    if (state.depth != DEPTH_OFF) {
+        float stored = zbuffer.getValue(x, y);
+        if (state.encoding == DEPTH_REVERSE_Z ? !(z > stored) : !(z < stored)) return false;
+        if (state.depth == DEPTH_TEST_WRITE) zbuffer.setValue(x, y, z);
+    }
+    return true;
+}
+
+template <typename State>
+inline bool passDepth(const CountingRaster<State>& state, Zbuffer& zbuffer, int x, int y, float z) {
+    bool passed = passDepth(static_cast<const State&>(state), zbuffer, x, y, z);
+    if (state.depth != DEPTH_OFF) {
+        state.stats->pixelsTested++;
+        state.stats->bytesTouched += sizeof(float);
+        if (passed && state.depth == DEPTH_TEST_WRITE) state.stats->bytesTouched += sizeof(float);
+    }
+    if (passed) state.stats->pixelsPassed++;
+    return passed;
+}
+
+// Запись цвета пикселя, прошедшего проверку глубины
+template <typename State>
+inline void writeColor(const State& state, SDL_Surface* surface, int x, int y, uint32_t color) {
+    if (state.blend == BLEND_DISABLED) return;
+    if (state.pixels == PIXELS_32) {
+        ((uint32_t*)surface->pixels)[y * surface->pitch / 4 + x] = color;
+    } else {
+        storePixel(surface, x, y, color);
+    }
+}
+
+template <typename State>
+inline void writeColor(const CountingRaster<State>& state, SDL_Surface* surface, int x, int y, uint32_t color) {
+    if (state.blend == BLEND_DISABLED) return;
+    writeColor(static_cast<const State&>(state), surface, x, y, color);
+    state.stats->pixelsWritten++;
+    state.stats->bytesTouched += surface->format->BytesPerPixel;
+    if (state.overdraw) {
+        uint16_t& count = state.overdraw[(size_t)y * state.width + x];
+        if (count < UINT16_MAX) count++;
+    }
+}
+
+// Проверка глубины и запись одного пикселя по состоянию state
+template <typename State>
+inline void plotPixel(const State& state, SDL_Surface* surface, Zbuffer& zbuffer, int x, int y, float z, uint32_t color) {
+    if (passDepth(state, zbuffer, x, y, z)) writeColor(state, surface, x, y, color);
+}
+
+// Выбор по смешиванию, раскладке и кодировке глубины для withRasterPermutation
+template <DepthMode Depth, BlendMode Blend, PixelLayout Pixels, typename Draw>
+void dispatchRasterEncoding(const RasterState& state, Draw&& draw) {
+    if (state.encoding == DEPTH_REVERSE_Z) {
+        draw(RasterPermutation<Depth, Blend, Pixels, DEPTH_REVERSE_Z>());
+    } else {
+        draw(RasterPermutation<Depth, Blend, Pixels, DEPTH_VIEW_W>());
+    }
+}
+
+template <DepthMode Depth, BlendMode Blend, typename Draw>
+void dispatchRasterPixels(const RasterState& state, Draw&& draw) {
+    if (state.pixels == PIXELS_32) {
+        dispatchRasterEncoding<Depth, Blend, PIXELS_32>(state, std::forward<Draw>(draw));
+    } else {
+        dispatchRasterEncoding<Depth, Blend, PIXELS_ANY>(state, std::forward<Draw>(draw));
+    }
+}
+
+template <DepthMode Depth, typename Draw>
+void dispatchRasterBlend(const RasterState& state, Draw&& draw) {
+    if (state.blend == BLEND_REPLACE) {
+        dispatchRasterPixels<Depth, BLEND_REPLACE>(state, std::forward<Draw>(draw));
+    } else {
+        dispatchRasterPixels<Depth, BLEND_DISABLED>(state, std::forward<Draw>(draw));
+    }
+}
+
+// Вызов draw(permutation) с экземпляром RasterPermutation, соответствующим state.
+// Выбор делается один раз на вызов отрисовки, внутри draw состояние уже известно компилятору.
+template <typename Draw>
+void withRasterPermutation(const RasterState& state, Draw&& draw) {
+    switch (state.depth) {
+        case DEPTH_OFF:
+            dispatchRasterBlend<DEPTH_OFF>(state, std::forward<Draw>(draw));
+            break;
+        case DEPTH_TEST:
+            dispatchRasterBlend<DEPTH_TEST>(state, std::forward<Draw>(draw));
+            break;
+        default:
+            dispatchRasterBlend<DEPTH_TEST_WRITE>(state, std::forward<Draw>(draw));
+            break;
+    }
+}
+
+#endif // _RASTER_STATE_HPP_
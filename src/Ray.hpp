@@ -0,0 +1,70 @@
+#ifndef _RAY_HPP_
+#define _RAY_HPP_
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "Position3D.hpp"
+#include "BoundingBox.hpp"
+
+// Луч в мировых координатах. Направление нормализовано,
+// поэтому параметр пересечения t равен расстоянию от начала луча.
+struct Ray {
+    Position3D origin;
+    Position3D direction;
+    Position3D invDirection;  // 1 / direction для теста пересечения с AABB
+
+    Ray(const Position3D& rayOrigin, const Position3D& rayDirection)
+        : origin(rayOrigin), direction(rayDirection)
+    {
+        direction.normalize();
+        invDirection.setPosition(1.0f / direction.getX(), 1.0f / direction.getY(), 1.0f / direction.getZ());
+    }
+
+    // Пересечение с параллелепипедом методом плит (slab test)
+    bool intersectBox(const BoundingBox& box, float tMax, float& tNear) const {
+        float t1 = (box.min.getX() - origin.getX()) * invDirection.getX();
+        float t2 = (box.max.getX() - origin.getX()) * invDirection.getX();
+        float tMin = std::min(t1, t2);
+        float tFar = std::max(t1, t2);
+
+        t1 = (box.min.getY() - origin.getY()) * invDirection.getY();
+        t2 = (box.max.getY() - origin.getY()) * invDirection.getY();
+        tMin = std::max(tMin, std::min(t1, t2));
+        tFar = std::min(tFar, std::max(t1, t2));
+
+        t1 = (box.min.getZ() - origin.getZ()) * invDirection.getZ();
+        t2 = (box.max.getZ() - origin.getZ()) * invDirection.getZ();
+        tMin = std::max(tMin, std::min(t1, t2));
+        tFar = std::min(tFar, std::max(t1, t2));
+
+        tNear = tMin;
+        return tFar >= std::max(tMin, 0.0f) && tMin < tMax;
+    }
+
+    // Пересечение с треугольником (алгоритм Мёллера — Трумбора)
+    bool intersectTriangle(const Position3D& a, const Position3D& b, const Position3D& c, float& t) const {
+        const float epsilon = 1e-7f;
+
+        Position3D edge1 = b - a;
+        Position3D edge2 = c - a;
+        Position3D p = direction.cross(edge2);
+        float det = edge1.dot(p);
+        if (std::fabs(det) < epsilon) return false;  // Луч параллелен плоскости треугольника
+
+        float invDet = 1.0f / det;
+        Position3D s = origin - a;
+        float u = s.dot(p) * invDet;
+        if (u < 0.0f || u > 1.0f) return false;
+
+        Position3D q = s.cross(edge1);
+        float v = direction.dot(q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return false;
+
+        t = edge2.dot(q) * invDet;
+        return t > epsilon;
+    }
+};
+
+#endif // _RAY_HPP_
@@ -0,0 +1,313 @@
+#ifndef _RENDER_THREAD_HPP_
+#define _RENDER_THREAD_HPP_
+
+#include <SDL2/SDL.h>
+#include "Scene3D.hpp"
+#include "SceneController.hpp"
+#include "CommandQueue.hpp"
+#include "JobSystem.hpp"
+#include "FrameScheduler.hpp"
+#include "PerformanceHud.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Задержка от события ввода до показа кадра с его результатом
+struct LatencyStats {
+    uint64_t lastNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t totalNs = 0;
+    uint32_t samples = 0;
+
+    void add(uint64_t latencyNs) {
+        lastNs = latencyNs;
+        maxNs = std::max(maxNs, latencyNs);
+        totalNs += latencyNs;
+        samples++;
+    }
+
+    double averageMs() const {
+        return samples ? totalNs / 1e6 / samples : 0.0;
+    }
+
+    void reset() {
+        *this = LatencyStats();
+    }
+};
+
+// Поток отрисовки, отделённый от цикла событий SDL.
+//
+// Сцена принадлежит только этому потоку: поток ввода не трогает её, а кладёт
+// команды в очередь без блокировок. Поток отрисовки применяет все накопившиеся
+// команды, рисует кадр в свой задний буфер и публикует его в тройной буфер кадров,
+// после чего будит основной поток пользовательским событием SDL.
+// Показ окна остаётся в основном потоке: SDL требует вызывать функции окна из него.
+// Ни одна из сторон не ждёт другую: при отставании отрисовки
+// промежуточные кадры просто заменяются более свежими.
+// Вместе с кадром передаются его изменения относительно кадра, показанного в окне,
+// и в окно копируются и обновляются только они.
+class RenderThread {
+private:
+    static const int FRAME_COUNT = 3;
+    static const int FRESH = 4;         // Флаг в readyFrame: кадр опубликован и ещё не показан
+    static const int INDEX_MASK = 3;
+
+    Scene3D& scene;
+    SceneController controller;         // Применение команд к сцене и выбранной модели
+
+    CommandQueue<SceneCommand> commands;
+    std::vector<SceneCommand> batch;    // Команды текущей пачки событий, ещё не переданные (только поток ввода)
+    std::vector<SceneCommand> overflow; // Команды, не поместившиеся в очередь (только поток ввода)
+
+    std::thread thread;
+    std::mutex wakeMutex;               // Только для засыпания потока отрисовки, не держится во время отрисовки
+    std::condition_variable wakeCondition;
+    std::atomic<bool> stopping;
+
+    // Тройной буфер кадров: задним владеет поток отрисовки, передним — основной,
+    // третий лежит в readyFrame и передаётся атомарным обменом.
+    Uint32 pixelFormat;
+    SDL_Surface* frames[FRAME_COUNT];
+    uint64_t frameInputNs[FRAME_COUNT]; // Самое раннее событие ввода, учтённое в кадре (0 — нет)
+    DirtyRegion frameDamage[FRAME_COUNT]; // Изменения кадра относительно последнего забранного основным потоком
+    DirtyRegion windowDamage;           // Изменения с последнего забранного кадра (только поток отрисовки)
+    SDL_Surface* windowSurface;         // Поверхность окна, на которую показан передний кадр (только основной поток)
+    int backFrame;
+    int frontFrame;
+    std::atomic<int> readyFrame;
+
+    Uint32 frameEvent;                  // Тип события SDL «кадр готов»
+    LatencyStats latency;
+    FrameScheduler scheduler;
+
+    // Панель производительности рисуется потоком отрисовки в задний буфер поверх кадра сцены
+    PerformanceHud hud;
+    bool hudVisible;
+    bool hudShown;                      // Панель есть в последнем опубликованном кадре
+
+    void apply(const SceneCommand& command) {
+        if (command.type == SceneCommand::TOGGLE_HUD) {
+            hudVisible = !hudVisible;
+            return;
+        }
+        controller.apply(command);
+    }
+
+    // Задний буфер под текущий размер сцены. Сцена рисует в него напрямую, если формат окна
+    // совпадает с её собственным, и дорисовывает только изменения с кадра, уже лежащего в буфере.
+    SDL_Surface* backSurface() {
+        SDL_Surface*& frame = frames[backFrame];
+        if (!frame || frame->w != scene.getWidth() || frame->h != scene.getHeight()) {
+            if (frame) SDL_FreeSurface(frame);
+            frame = SDL_CreateRGBSurfaceWithFormat(0, scene.getWidth(), scene.getHeight(), 32, pixelFormat);
+            // Кадр копируется в окно как есть, без смешивания по альфа-каналу
+            SDL_SetSurfaceBlendMode(frame, SDL_BLENDMODE_NONE);
+        }
+        return frame;
+    }
+
+    void run() {
+        PROFILE_THREAD("render", -1);
+        bool redraw = true;  // Первый кадр рисуется без команд
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wakeCondition.wait(lock, [&] { return redraw || stopping.load() || !commands.empty(); });
+
+                // Не раньше следующего периода кадра; тем временем команды копятся
+                auto deadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(scheduler.getNextFrameTime()));
+                wakeCondition.wait_until(lock, deadline, [&] { return stopping.load(); });
+            }
+            if (stopping.load()) return;
+
+            uint64_t frameStart = JobSystem::nowNs();
+            uint64_t oldestInput = 0;
+            SceneCommand command;
+            while (commands.pop(command)) {
+                apply(command);
+                if (!oldestInput) oldestInput = command.inputNs;
+            }
+            redraw = false;
+
+            SDL_Surface* back = backSurface();
+            uint64_t renderStart = JobSystem::nowNs();
+            scene.render(back);
+            hud.addFrame((JobSystem::nowNs() - renderStart) / 1e6, scene.getStats());
+            frameInputNs[backFrame] = oldestInput;
+            windowDamage.add(scene.getDamage());
+
+            // Сцена вернёт изображение под панелью при следующей отрисовке в этот буфер;
+            // в окне обновляется место панели, пока она видна, и ещё раз после скрытия
+            if (hudVisible || hudShown) windowDamage.add(PerformanceHud::area(back));
+            if (hudVisible) scene.invalidateTarget(back, hud.draw(back));
+            hudShown = hudVisible;
+            frameDamage[backFrame] = windowDamage;
+            scheduler.frameFinished(frameStart, JobSystem::nowNs());
+
+            // Публикуем кадр и забираем себе тот, что лежал готовым
+            int previous = readyFrame.exchange(backFrame | FRESH);
+            backFrame = previous & INDEX_MASK;
+
+            // Предыдущий кадр основной поток уже забрал: следующему достаточно изменений, начиная с этого.
+            // Иначе предыдущий кадр пропадёт непоказанным, и его изменения остаются в накоплении.
+            if (!(previous & FRESH)) {
+                windowDamage = scene.getDamage();
+            }
+
+            SDL_Event event = {};
+            event.type = frameEvent;
+            SDL_PushEvent(&event);
+        }
+    }
+
+    // Перенос отложенных команд в очередь в исходном порядке
+    void flushOverflow() {
+        size_t moved = 0;
+        while (moved < overflow.size() && commands.push(overflow[moved])) {
+            moved++;
+        }
+        overflow.erase(overflow.begin(), overflow.begin() + moved);
+        if (moved) wake();
+    }
+
+    void wake() {
+        // Захват мьютекса упорядочивает команду относительно проверки условия в run()
+        { std::lock_guard<std::mutex> lock(wakeMutex); }
+        wakeCondition.notify_one();
+    }
+
+public:
+    // pixelFormat — формат кадров, совпадающий с поверхностью окна, чтобы показ был простым копированием
+    RenderThread(Scene3D& scene, Uint32 pixelFormat)
+        : scene(scene),
+          controller(scene),
+          stopping(false),
+          pixelFormat(pixelFormat),
+          windowSurface(nullptr),
+          backFrame(0),
+          frontFrame(1),
+          readyFrame(2),
+          frameEvent(SDL_RegisterEvents(1)),
+          hudVisible(false),
+          hudShown(false)
+    {
+        for (int i = 0; i < FRAME_COUNT; ++i) {
+            frames[i] = nullptr;
+            frameInputNs[i] = 0;
+        }
+    }
+
+    ~RenderThread() {
+        stop();
+        for (SDL_Surface* frame : frames) {
+            if (frame) SDL_FreeSurface(frame);
+        }
+    }
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Модель, выбранная до запуска потока
+    void setSelected(std::shared_ptr<Model3D> model) {
+        controller.select(std::move(model));
+    }
+
+    void start() {
+        thread = std::thread(&RenderThread::run, this);
+    }
+
+    void stop() {
+        if (!thread.joinable()) return;
+        stopping.store(true);
+        wake();
+        thread.join();
+    }
+
+    // Тип события SDL, которым поток отрисовки сообщает о новом кадре
+    Uint32 getFrameEvent() const {
+        return frameEvent;
+    }
+
+    // Добавление изменения сцены в текущую пачку. Подряд идущие команды одного типа сливаются.
+    // Вызывается только из потока ввода.
+    void push(SceneCommand::Type type, float x = 0.0f, float y = 0.0f, float z = 0.0f) {
+        SceneCommand command = { type, x, y, z, JobSystem::nowNs() };
+        if (batch.empty() || !batch.back().merge(command)) {
+            batch.push_back(command);
+        }
+    }
+
+    // Передача пачки потоку отрисовки. Вызывается только из потока ввода и никогда не ждёт.
+    void submit() {
+        if (batch.empty()) return;
+        flushOverflow();
+        size_t sent = 0;
+        if (overflow.empty()) {
+            while (sent < batch.size() && commands.push(batch[sent])) {
+                sent++;
+            }
+        }
+        overflow.insert(overflow.end(), batch.begin() + sent, batch.end());
+        batch.clear();
+        if (sent) wake();
+    }
+
+    // Показ последнего готового кадра в окне (основной поток): копируются и
+    // обновляются только изменившиеся прямоугольники. Возвращает false, если нового кадра нет.
+    bool present(SDL_Window* window) {
+        flushOverflow();
+        if (!(readyFrame.load() & FRESH)) return false;
+        frontFrame = readyFrame.exchange(frontFrame) & INDEX_MASK;
+
+        SDL_Surface* surface = SDL_GetWindowSurface(window);
+        SDL_Surface* frame = frames[frontFrame];
+        if (surface && frame) {
+            // Новая поверхность окна (после изменения размера) не содержит прошлых кадров
+            if (surface != windowSurface || surface->w != frame->w || surface->h != frame->h) {
+                SDL_BlitSurface(frame, nullptr, surface, nullptr);
+                SDL_UpdateWindowSurface(window);
+                windowSurface = surface;
+            } else if (!frameDamage[frontFrame].empty()) {
+                const std::vector<SDL_Rect>& rects = frameDamage[frontFrame].getRects();
+                for (SDL_Rect rect : rects) {
+                    SDL_Rect target = rect;
+                    SDL_BlitSurface(frame, &rect, surface, &target);
+                }
+                SDL_UpdateWindowSurfaceRects(window, rects.data(), (int)rects.size());
+            }
+        }
+        if (frameInputNs[frontFrame]) {
+            latency.add(JobSystem::nowNs() - frameInputNs[frontFrame]);
+        }
+        return true;
+    }
+
+    // Полный повторный показ текущего кадра, например когда окно было перекрыто (основной поток)
+    void refresh(SDL_Window* window) {
+        windowSurface = nullptr;
+        SDL_Surface* surface = SDL_GetWindowSurface(window);
+        if (surface && frames[frontFrame]) {
+            SDL_BlitSurface(frames[frontFrame], nullptr, surface, nullptr);
+            SDL_UpdateWindowSurface(window);
+            windowSurface = surface;
+        }
+    }
+
+    // Статистика задержки ввода; читается и сбрасывается основным потоком
+    LatencyStats& getLatency() {
+        return latency;
+    }
+
+    FrameScheduler& getScheduler() {
+        return scheduler;
+    }
+};
+
+#endif // _RENDER_THREAD_HPP_
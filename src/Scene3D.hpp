@@ -5,14 +5,563 @@
 #include "Model3D.hpp"
 #include "HiddenSurfaceRemoval.hpp"
 #include "Zbuffer.hpp"
+#include "SceneGraph.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "RadixSort.hpp"
+#include "JobSystem.hpp"
+#include "DirtyRegion.hpp"
+#include "Lighting.hpp"
+#include "Profiler.hpp"
+#include "AllocationTracker.hpp"
 #include <vector>
 #include <memory>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+// Результат выбора модели лучом из точки экрана
+struct PickResult {
+    std::shared_ptr<Model3D> model;  // nullptr, если луч ни во что не попал
+    int triangle;                    // Индекс полигона модели
+    float distance;                  // Расстояние от камеры до точки попадания
+};
+
+// Что показывает кадр
+enum RenderMode {
+    RENDER_COLOR,     // Обычное изображение
+    RENDER_OVERDRAW   // Тепловая карта: сколько раз в каждый пиксель записывался цвет
+};
+
+// Работа последнего render(). Пусто, если кадр не перерисовывался.
+struct RenderStats {
+    uint64_t trianglesSubmitted = 0;     // Полигоны моделей, прошедших отсечение пирамидой видимости
+    uint64_t trianglesCulled = 0;        // Отброшены как нелицевые
+    uint64_t trianglesNearRejected = 0;  // Отброшены целиком из-за вершины ближе ближней плоскости (отсечения нет)
+    uint64_t trianglesRasterized = 0;    // Переданы растеризатору (с учётом перерисовки только изменившихся областей)
+    RasterStats raster;                  // Счётчики растеризатора, если подсчёт включён (setRasterStatsEnabled)
+
+    // Время этапов в наносекундах
+    uint64_t updateNs = 0;    // Мировые матрицы и BVH
+    uint64_t cullNs = 0;      // Отсечение, отбор полигонов и поиск изменившихся областей
+    uint64_t sortNs = 0;      // Сбор полигонов, сортировка и раскладка по полосам
+    uint64_t rasterNs = 0;    // Растеризация, включая перестройку статического слоя
+    uint64_t presentNs = 0;   // Копирование из собственного буфера кадра в цель
+};
 
 class Scene3D {
 private:
+    static const int BAND_HEIGHT = 32;  // Высота полосы экрана, растеризуемой одной задачей
+
+    std::unique_ptr<JobSystem> jobs;    // Потоки, общие для всех стадий отрисовки
     std::vector<std::shared_ptr<Model3D>> models;
+    SceneGraph graph;            // Иерархия преобразований моделей
+    BoundingVolumeHierarchy bvh; // Иерархия границ моделей для отсечения и выбора лучом
+    bool bvhDirty;               // Набор моделей изменился, нужна полная перестройка
+    MovedModelList movedModels;  // Модели, изменившие вершины после последней синхронизации BVH
+
+    Lighting lighting;           // Источники света
+    ShadingMode shadingMode;     // Режим освещения моделей
+    TextureFilter textureFilter; // Выборка текселей текстурированных моделей
+
+    // Версии, по которым нарисован последний кадр. Совпадение всех версий позволяет не рисовать кадр заново.
+    uint64_t membershipVersion;           // Растёт при добавлении моделей и узлов
+    uint64_t shadingVersion;              // Растёт при смене режима освещения или фильтрации текстур
+    bool frameValid;                      // Последний кадр соответствует версиям ниже
+    uint64_t frameCameraVersion;
+    uint64_t frameSceneVersion;
+    std::vector<uint64_t> frameModelVersions;
+
+    // Кэш статического слоя: фон, оси и все модели, не отмеченные динамическими (цвет и глубина).
+    // Пока камера и статические модели не меняются, кадр начинается с копии слоя,
+    // а растеризуются только динамические модели.
+    static constexpr uint64_t DYNAMIC_MODEL = ~0ull;  // Метка динамической модели в staticModelVersions
+    std::vector<uint32_t> staticColor;
+    std::vector<float> staticDepth;
+    bool staticValid;
+    uint64_t staticCameraVersion;
+    uint64_t staticSceneVersion;
+    std::vector<uint64_t> staticModelVersions;
+    std::vector<int> staticVisible;   // Видимые статические модели кадра
+    std::vector<int> dynamicVisible;  // Видимые динамические модели кадра
+
+    // Как начинается растеризация полосы
+    enum BandStart {
+        CLEAR_BAND,           // Фон и оси
+        RESTORE_STATIC_BAND,  // Копия строк статического слоя
+        KEEP_BAND             // Поверх уже нарисованного
+    };
+
+    // Изменившиеся области кадра. Если камера и состав сцены не менялись, перерисовываются
+    // только прямоугольники изменившихся моделей (где они были и где стали), остальное остаётся от прошлого кадра.
+    static const int DAMAGE_HISTORY = 4;  // Сколько последних кадров помнит damageHistory
+    std::vector<SDL_Rect> footprints;       // Экранные прямоугольники моделей в последнем кадре (пустой — не видна)
+    std::vector<SDL_Rect> frameFootprints;  // То же для предыдущего кадра
+    std::vector<int> damagedModels;         // Видимые модели, задевающие изменившиеся области
+    DirtyRegion damage;                     // Что изменилось в кадре за последний render()
+    DirtyRegion damageHistory[DAMAGE_HISTORY];
+    DirtyRegion redrawRegion;               // Что дорисовать на поверхности в текущем render()
+    DirtyRegion presentRegion;              // Что скопировать на цель в present()
+    uint64_t frameNumber;                   // Номер последнего кадра; растёт с каждым изменившимся кадром
+
+    // Какой кадр последним нарисован или скопирован на поверхность (возраст буфера).
+    // Сюда попадают и собственный буфер кадра, и цели прямой отрисовки.
+    struct TargetFrame {
+        SDL_Surface* surface;
+        int width, height;
+        uint64_t frame;
+        DirtyRegion overlay;  // Поверх кадра нарисовано чужое (invalidateTarget)
+    };
+    std::vector<TargetFrame> targetFrames;
+
+    // Общий для всей сцены список видимых полигонов кадра в порядке художника
+    std::vector<DepthRecord> frameTriangles;
+    std::vector<DepthRecord> sortScratch;
+    std::vector<size_t> sortHistograms;     // Гистограммы частей поразрядной сортировки
+    std::vector<int> visibleModels;
+
+    // Распределение работы по полосам экрана: индексы в frameTriangles и visibleModels
+    std::vector<std::vector<uint32_t>> bandTriangles;
+    std::vector<std::vector<int>> bandModels;
+
+    // Подсчёт работы растеризатора: счётчики каждой полосы отдельно, чтобы потоки не делили их
+    RenderMode renderMode;
+    bool rasterStatsEnabled;
+    RenderStats stats;
+    std::vector<RasterStats> bandStats;
+    std::vector<uint16_t> overdraw;   // Число записей цвета в пиксель кадра (RENDER_OVERDRAW)
+
+    // Цвет тепловой карты для числа записей: 0 — фон, дальше от синего через зелёный и жёлтый к красному и белому
+    static void overdrawPalette(const SDL_PixelFormat* format, uint32_t palette[9]) {
+        static const uint8_t colors[9][3] = {
+            { 0x11, 0x11, 0x11 }, { 0x00, 0x00, 0xA0 }, { 0x00, 0x60, 0xFF }, { 0x00, 0xC0, 0x60 }, { 0x60, 0xE0, 0x00 },
+            { 0xFF, 0xE0, 0x00 }, { 0xFF, 0x80, 0x00 }, { 0xFF, 0x00, 0x00 }, { 0xFF, 0xFF, 0xFF }
+        };
+        for (int i = 0; i < 9; ++i) {
+            palette[i] = SDL_MapRGB(format, colors[i][0], colors[i][1], colors[i][2]);
+        }
+    }
+
+    // Полосы экрана, которые пересекает диапазон строк [top, bottom]
+    void bandRange(float top, float bottom, int& firstBand, int& lastBand) const {
+        int bandCount = (int)bandTriangles.size();
+        firstBand = std::max(0, std::min(bandCount - 1, (int)std::floor(top) / BAND_HEIGHT));
+        lastBand  = std::max(0, std::min(bandCount - 1, (int)std::ceil(bottom) / BAND_HEIGHT));
+    }
+
+    // Экранный прямоугольник модели в текущем кадре с запасом в пиксель, обрезанный экраном.
+    // Модель должна быть спроецирована текущей камерой.
+    SDL_Rect modelFootprint(int index) const {
+        float left, top, right, bottom;
+        models[index]->getProjectedExtent(left, top, right, bottom);
+        SDL_Rect screen = { 0, 0, frameBuffer->w, frameBuffer->h };
+        if (!std::isfinite(left) || !std::isfinite(top) || !std::isfinite(right) || !std::isfinite(bottom)) {
+            return screen;  // Вершина в плоскости камеры: границы не определены
+        }
+        // Ограничиваем заранее, чтобы далёкие проекции не переполняли int
+        left = std::max(left, -2.0f);
+        top = std::max(top, -2.0f);
+        right = std::min(right, (float)frameBuffer->w + 2.0f);
+        bottom = std::min(bottom, (float)frameBuffer->h + 2.0f);
+
+        SDL_Rect rect;
+        rect.x = (int)std::floor(left) - 1;
+        rect.y = (int)std::floor(top) - 1;
+        rect.w = (int)std::ceil(right) + 2 - rect.x;
+        rect.h = (int)std::ceil(bottom) + 2 - rect.y;
+        if (!SDL_IntersectRect(&rect, &screen, &rect)) {
+            return SDL_Rect{ 0, 0, 0, 0 };
+        }
+        return rect;
+    }
+
+    // Может ли полигон с экранными границами задеть clip. Непредставимые границы (NaN) считаются задевающими.
+    static bool extentTouches(const SDL_Rect& clip, float left, float top, float right, float bottom) {
+        return !(right + 1.0f < clip.x || left - 1.0f >= clip.x + clip.w
+              || bottom + 1.0f < clip.y || top - 1.0f >= clip.y + clip.h);
+    }
+
+    // Растеризация прямоугольника clip внутри полосы: начало (см. BandStart), полигоны в порядке художника, рёбра.
+    // filter — отбрасывать полигоны и модели полосы, не задевающие clip. state — выбранная RasterPermutation.
+    template <typename State>
+    void rasterizeRect(int band, const SDL_Rect& clip, BandStart start, uint32_t background, bool filter, const State& state) {
+        if (renderMode == RENDER_OVERDRAW) {
+            for (int y = clip.y; y < clip.y + clip.h; ++y) {
+                std::fill_n(&overdraw[(size_t)y * surface->w + clip.x], clip.w, 0);
+            }
+        }
+        if (start == CLEAR_BAND) {
+            PROFILE_SCOPE_ARG("clear", band);
+            for (int y = clip.y; y < clip.y + clip.h; ++y) {
+                uint32_t* row = (uint32_t*)((uint8_t*)surface->pixels + y * surface->pitch);
+                std::fill(row + clip.x, row + clip.x + clip.w, background);
+            }
+
+            // Оси рисуются со своим буфером глубины и не перекрывают модели
+            zbuffer.clearRect(clip.x, clip.y, clip.w, clip.h);
+            camera.drawAxes(surface, zbuffer, &clip, state);
+            zbuffer.clearRect(clip.x, clip.y, clip.w, clip.h);
+        } else if (start == RESTORE_STATIC_BAND) {
+            PROFILE_SCOPE_ARG("restore layer", band);
+            for (int y = clip.y; y < clip.y + clip.h; ++y) {
+                size_t offset = (size_t)y * surface->w + clip.x;
+                std::memcpy((uint32_t*)((uint8_t*)surface->pixels + y * surface->pitch) + clip.x, &staticColor[offset],
+                            clip.w * sizeof(uint32_t));
+                std::memcpy(zbuffer.getRow(y) + clip.x, &staticDepth[offset], clip.w * sizeof(float));
+            }
+        }
+
+        {
+            PROFILE_SCOPE_ARG("triangles", band);
+            for (uint32_t index : bandTriangles[band]) {
+                const DepthRecord& record = frameTriangles[index];
+                const auto& model = models[record.model];
+                if (filter) {
+                    float left, top, right, bottom;
+                    model->getPolygonExtent(record.triangle, left, top, right, bottom);
+                    if (!extentTouches(clip, left, top, right, bottom)) continue;
+                }
+                model->drawShadedPolygon(camera, surface, record.triangle, zbuffer, &clip, state);
+            }
+        }
+        {
+            PROFILE_SCOPE_ARG("lines", band);
+            for (int index : bandModels[band]) {
+                if (filter && !SDL_HasIntersection(&footprints[index], &clip)) continue;
+                models[index]->drawVisibleEdges(camera, surface, 0xFFFFFF, zbuffer, &clip, state);  // Белый цвет для рёбер
+            }
+        }
+
+        // Цвет кадра заменяется числом записей; восемь и больше — белый
+        if (renderMode == RENDER_OVERDRAW) {
+            uint32_t palette[9];
+            overdrawPalette(surface->format, palette);
+            for (int y = clip.y; y < clip.y + clip.h; ++y) {
+                uint32_t* row = (uint32_t*)((uint8_t*)surface->pixels + y * surface->pitch);
+                const uint16_t* counts = &overdraw[(size_t)y * surface->w];
+                for (int x = clip.x; x < clip.x + clip.w; ++x) {
+                    row[x] = palette[std::min<int>(counts[x], 8)];
+                }
+            }
+        }
+    }
+
+    // Растеризация полосы строк целиком или только её пересечений с region
+    template <typename State>
+    void rasterizeBand(int band, BandStart start, uint32_t background, const DirtyRegion* region, const State& state) {
+        int top = band * BAND_HEIGHT;
+        SDL_Rect bandRect = { 0, top, surface->w, std::min(surface->h, top + BAND_HEIGHT) - top };
+        if (!region) {
+            rasterizeRect(band, bandRect, start, background, false, state);
+            return;
+        }
+        for (const SDL_Rect& rect : region->getRects()) {
+            SDL_Rect clip;
+            if (SDL_IntersectRect(&rect, &bandRect, &clip)) {
+                rasterizeRect(band, clip, start, background, true, state);
+            }
+        }
+    }
+
+    // Отрисовка моделей modelIndices в surface: общий порядок художника, полосы растеризуются параллельно.
+    // Полигоны моделей должны быть отобраны (updateVisibleTriangles) для текущей камеры.
+    // region — перерисовать только эти области (nullptr — весь кадр); участвуют лишь задевающие их модели.
+    void drawModels(const std::vector<int>& allIndices, BandStart start, const DirtyRegion* region) {
+        const std::vector<int>* indices = &allIndices;
+        if (region) {
+            damagedModels.clear();
+            for (int index : allIndices) {
+                if (region->intersects(footprints[index])) damagedModels.push_back(index);
+            }
+            indices = &damagedModels;
+        }
+        const std::vector<int>& modelIndices = *indices;
+        ALLOCATION_SCOPE("sort");
+
+        frameTriangles.clear();
+        for (int index : modelIndices) {
+            PROFILE_SCOPE_ARG("gather model", index);
+            const std::vector<DepthRecord>& triangles = models[index]->updateVisibleTriangles(camera, (uint32_t)index);
+            frameTriangles.insert(frameTriangles.end(), triangles.begin(), triangles.end());
+            models[index]->updateShading(lighting, shadingMode, textureFilter);
+        }
+
+        uint64_t sortStart = JobSystem::nowNs();
+
+        // Единый порядок художника: от дальних к ближним
+        {
+            PROFILE_SCOPE("sort");
+            radixSortByDepth(frameTriangles, sortScratch, sortHistograms, *jobs);
+        }
+
+        // Раскладка полигонов и рёбер по полосам с сохранением порядка
+        int bandCount = (surface->h + BAND_HEIGHT - 1) / BAND_HEIGHT;
+        {
+            PROFILE_SCOPE("bin");
+            bandTriangles.resize(bandCount);
+            bandModels.resize(bandCount);
+            for (int band = 0; band < bandCount; ++band) {
+                bandTriangles[band].clear();
+                bandModels[band].clear();
+            }
+
+            int firstBand, lastBand;
+            for (size_t i = 0; i < frameTriangles.size(); ++i) {
+                float left, top, right, bottom;
+                models[frameTriangles[i].model]->getPolygonExtent(frameTriangles[i].triangle, left, top, right, bottom);
+                bandRange(top, bottom, firstBand, lastBand);
+                for (int band = firstBand; band <= lastBand; ++band) {
+                    bandTriangles[band].push_back((uint32_t)i);
+                }
+            }
+            for (int index : modelIndices) {
+                float left, top, right, bottom;
+                models[index]->getProjectedExtent(left, top, right, bottom);
+                bandRange(top, bottom, firstBand, lastBand);
+                for (int band = firstBand; band <= lastBand; ++band) {
+                    bandModels[band].push_back(index);
+                }
+            }
+        }
+
+        stats.sortNs += JobSystem::nowNs() - sortStart;
+        ALLOCATION_SCOPE("raster");
+
+        // Растеризация полос независимо: строки буфера кадра и глубины не пересекаются.
+        // Вариант растеризатора выбирается один раз на весь проход.
+        uint32_t background = SDL_MapRGB(surface->format, 0x11, 0x11, 0x11);
+        RasterState state = { DEPTH_TEST_WRITE, BLEND_REPLACE, surface->format->BytesPerPixel == 4 ? PIXELS_32 : PIXELS_ANY,
+                              zbuffer.getEncoding() };
+        stats.trianglesRasterized += frameTriangles.size();
+        if (!rasterStatsEnabled && renderMode == RENDER_COLOR) {
+            withRasterPermutation(state, [&](auto permutation) {
+                jobs->parallelFor("raster", 0, bandCount, 1, [&](size_t begin, size_t end) {
+                    for (size_t band = begin; band < end; ++band) {
+                        rasterizeBand((int)band, start, background, region, permutation);
+                    }
+                });
+            });
+            return;
+        }
+
+        // С подсчётом тот же вариант растеризатора оборачивается в CountingRaster
+        bandStats.assign(bandCount, RasterStats());
+        uint16_t* overdrawCounts = nullptr;
+        if (renderMode == RENDER_OVERDRAW) {
+            overdraw.resize((size_t)surface->w * surface->h);
+            overdrawCounts = overdraw.data();
+        }
+        withRasterPermutation(state, [&](auto permutation) {
+            jobs->parallelFor("raster", 0, bandCount, 1, [&](size_t begin, size_t end) {
+                for (size_t band = begin; band < end; ++band) {
+                    CountingRaster<decltype(permutation)> counting(permutation, &bandStats[band], overdrawCounts, surface->w);
+                    rasterizeBand((int)band, start, background, region, counting);
+                }
+            });
+        });
+        for (const RasterStats& counters : bandStats) {
+            stats.raster.add(counters);
+        }
+    }
+
+    // Версия всего, что меняет кадр целиком, кроме камеры: состав сцены, источники света и режим освещения
+    uint64_t sceneVersion() const {
+        return membershipVersion + shadingVersion + lighting.getVersion();
+    }
+
+    // Статический слой соответствует текущим камере, сцене, статическим моделям и отметкам динамичности
+    bool isStaticLayerCurrent() const {
+        if (!staticValid || staticCameraVersion != camera.getVersion() || staticSceneVersion != sceneVersion()) {
+            return false;
+        }
+        for (size_t i = 0; i < models.size(); ++i) {
+            uint64_t expected = models[i]->isDynamic() ? DYNAMIC_MODEL : models[i]->getVersion();
+            if (staticModelVersions[i] != expected) return false;
+        }
+        return true;
+    }
+
+    // Сохранение только что нарисованного статического содержимого surface и буфера глубины
+    void saveStaticLayer() {
+        int width = surface->w;
+        staticColor.resize((size_t)width * surface->h);
+        staticDepth.resize((size_t)width * surface->h);
+        jobs->parallelFor("layer", 0, surface->h, 64, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y) {
+                std::memcpy(&staticColor[y * width], (uint8_t*)surface->pixels + y * surface->pitch, width * sizeof(uint32_t));
+                std::memcpy(&staticDepth[y * width], zbuffer.getRow(y), width * sizeof(float));
+            }
+        });
+
+        staticValid = true;
+        staticCameraVersion = camera.getVersion();
+        staticSceneVersion = sceneVersion();
+        staticModelVersions.resize(models.size());
+        for (size_t i = 0; i < models.size(); ++i) {
+            staticModelVersions[i] = models[i]->isDynamic() ? DYNAMIC_MODEL : models[i]->getVersion();
+        }
+    }
+
+    // Последний кадр нарисован при текущих версиях камеры, сцены и всех моделей
+    bool isFrameCurrent() const {
+        if (!frameValid || frameCameraVersion != camera.getVersion() || frameSceneVersion != sceneVersion()) {
+            return false;
+        }
+        for (size_t i = 0; i < models.size(); ++i) {
+            if (frameModelVersions[i] != models[i]->getVersion()) return false;
+        }
+        return true;
+    }
+
+    void rememberFrame() {
+        frameValid = true;
+        frameCameraVersion = camera.getVersion();
+        frameSceneVersion = sceneVersion();
+        frameModelVersions.resize(models.size());
+        for (size_t i = 0; i < models.size(); ++i) {
+            frameModelVersions[i] = models[i]->getVersion();
+        }
+    }
+
+    // Изменения нового кадра относительно предыдущего (footprints уже посчитаны).
+    // Весь кадр, если сменились камера, состав сцены, освещение или размер,
+    // либо изменилась бо́льшая часть экрана и отдельные прямоугольники не окупаются.
+    void collectDamage() {
+        damage.clear();
+        bool partial = frameValid && frameCameraVersion == camera.getVersion() && frameSceneVersion == sceneVersion();
+        if (partial) {
+            for (size_t i = 0; i < models.size(); ++i) {
+                if (frameModelVersions[i] == models[i]->getVersion()) continue;
+                damage.add(frameFootprints[i]);
+                damage.add(footprints[i]);
+            }
+            partial = damage.getArea() * 2 <= (int64_t)frameBuffer->w * frameBuffer->h;
+        }
+        if (!partial) damage.setFull(frameBuffer->w, frameBuffer->h);
+    }
+
+    // Что нужно скопировать на целевую поверхность, чтобы на ней оказался текущий кадр.
+    // Для поверхности, получившей один из последних кадров, это объединение изменений
+    // с тех пор; для незнакомой или давно не обновлявшейся — весь кадр. Результат пишется в result,
+    // чтобы переиспользовать его память от кадра к кадру.
+    void targetDamage(SDL_Surface* targetSurface, DirtyRegion& result) {
+        result.clear();
+        auto known = std::find_if(targetFrames.begin(), targetFrames.end(),
+                                  [&](const TargetFrame& entry) { return entry.surface == targetSurface; });
+        if (known != targetFrames.end() && known->width == targetSurface->w && known->height == targetSurface->h
+            && frameNumber - known->frame <= DAMAGE_HISTORY) {
+            for (uint64_t frame = known->frame + 1; frame <= frameNumber; ++frame) {
+                result.add(damageHistory[frame % DAMAGE_HISTORY]);
+            }
+            result.add(known->overlay);
+        } else {
+            result.setFull(frameBuffer->w, frameBuffer->h);
+            if (known == targetFrames.end()) {
+                // Помним несколько поверхностей (буферы кадров потока отрисовки); самую давнюю вытесняем
+                if (targetFrames.size() >= 8) {
+                    known = std::min_element(targetFrames.begin(), targetFrames.end(),
+                                             [](const TargetFrame& a, const TargetFrame& b) { return a.frame < b.frame; });
+                } else {
+                    known = targetFrames.insert(targetFrames.end(), TargetFrame());
+                }
+            }
+        }
+        known->surface = targetSurface;
+        known->width = targetSurface->w;
+        known->height = targetSurface->h;
+        known->frame = frameNumber;
+        known->overlay.clear();
+    }
+
+    // Можно ли растеризовать прямо в поверхность: тот же размер и 32-битные пиксели с нашим порядком каналов
+    bool canDrawInto(SDL_Surface* targetSurface) const {
+        const SDL_PixelFormat* own = frameBuffer->format;
+        const SDL_PixelFormat* target = targetSurface->format;
+        return directRendering && targetSurface->w == frameBuffer->w && targetSurface->h == frameBuffer->h
+            && target->BytesPerPixel == 4
+            && target->Rmask == own->Rmask && target->Gmask == own->Gmask && target->Bmask == own->Bmask;
+    }
+
+    // Копирование кадра из буфера кадра на целевую поверхность: только то, чего на ней ещё нет.
+    // Одинаковые форматы копируются построчно параллельно; 32-битные форматы с другим порядком
+    // каналов перепаковываются в том же проходе, остальные преобразует SDL.
+    void present(SDL_Surface* targetSurface) {
+        PROFILE_SCOPE("present");
+        ALLOCATION_SCOPE("present");
+        targetDamage(targetSurface, presentRegion);
+        const DirtyRegion& copy = presentRegion;
+        if (copy.empty()) return;
+
+        const SDL_PixelFormat* source = frameBuffer->format;
+        const SDL_PixelFormat* target = targetSurface->format;
+        bool sameFormat = source->BitsPerPixel == target->BitsPerPixel
+            && source->Rmask == target->Rmask && source->Gmask == target->Gmask && source->Bmask == target->Bmask;
+        bool repack = !sameFormat && target->BytesPerPixel == 4 && !target->Rloss && !target->Gloss && !target->Bloss;
+
+        if (!sameFormat && !repack) {
+            for (SDL_Rect rect : copy.getRects()) {
+                SDL_Rect targetRect = rect;
+                SDL_BlitSurface(frameBuffer, &rect, targetSurface, &targetRect);
+            }
+            return;
+        }
+
+        if (SDL_MUSTLOCK(targetSurface)) SDL_LockSurface(targetSurface);
+        SDL_Rect bounds = { 0, 0, std::min(frameBuffer->w, targetSurface->w), std::min(frameBuffer->h, targetSurface->h) };
+        for (const SDL_Rect& rect : copy.getRects()) {
+            SDL_Rect area;
+            if (!SDL_IntersectRect(&rect, &bounds, &area)) continue;
+            size_t columnBytes = (size_t)area.x * source->BytesPerPixel;
+            size_t rowBytes = (size_t)area.w * source->BytesPerPixel;
+            jobs->parallelFor("blit", area.y, area.y + area.h, 64, [&](size_t begin, size_t end) {
+                for (size_t y = begin; y < end; ++y) {
+                    uint8_t* to = (uint8_t*)targetSurface->pixels + y * targetSurface->pitch + columnBytes;
+                    const uint8_t* from = (const uint8_t*)frameBuffer->pixels + y * frameBuffer->pitch + columnBytes;
+                    if (sameFormat) {
+                        std::memcpy(to, from, rowBytes);
+                    } else {
+                        simdKernels().repackPixels((const uint32_t*)from, (uint32_t*)to, area.w, source, target);
+                    }
+                }
+            });
+        }
+        if (SDL_MUSTLOCK(targetSurface)) SDL_UnlockSurface(targetSurface);
+    }
+
+    // Растеризация кадра в surface: region — только эти области (nullptr — весь кадр).
+    // rebuildLayer — статический слой устарел при неподвижной камере и перестраивается (только весь кадр).
+    void drawFrame(const DirtyRegion* region, bool rebuildLayer) {
+        ALLOCATION_SCOPE("raster");
+        staticVisible.clear();
+        dynamicVisible.clear();
+        for (int index : visibleModels) {
+            (models[index]->isDynamic() ? dynamicVisible : staticVisible).push_back(index);
+        }
+        bool hasDynamic = false;
+        for (const auto& model : models) {
+            hasDynamic |= model->isDynamic();
+        }
+
+        // Тепловой карте нужны записи всех моделей, поэтому слой в ней не используется
+        if (!hasDynamic || renderMode == RENDER_OVERDRAW) {
+            drawModels(visibleModels, CLEAR_BAND, region);
+        } else if (isStaticLayerCurrent()) {
+            // Статика не менялась: копия слоя и только динамические модели
+            drawModels(dynamicVisible, RESTORE_STATIC_BAND, region);
+        } else if (rebuildLayer) {
+            // Перестройка слоя по статическим моделям, затем динамические поверх
+            drawModels(staticVisible, CLEAR_BAND, nullptr);
+            saveStaticLayer();
+            drawModels(dynamicVisible, KEEP_BAND, nullptr);
+        } else {
+            // Камера движется: слой устареет уже к следующему кадру, рисуем всё за один проход
+            drawModels(visibleModels, CLEAR_BAND, region);
+        }
+    }
+
     Camera3D camera;
-    SDL_Surface* surface;
+    SDL_Surface* frameBuffer;    // Собственный буфер кадра, если цель нельзя рисовать напрямую
+    SDL_Surface* surface;        // Куда растеризуется текущий кадр: frameBuffer или сама цель
+    bool directRendering;        // Рисовать прямо в подходящую цель, минуя frameBuffer
     
     Zbuffer zbuffer;
     HiddenSurfaceRemoval hsr;    // Обработчик удаления невидимых поверхностей
@@ -20,71 +569,327 @@ private:
 
 public:
     Scene3D(int width, int height) 
-        : camera(width, height),
-          surface(SDL_CreateRGBSurface(0, width, height, 32, 0, 0, 0, 0)),
+        : jobs(new JobSystem()),
+          bvhDirty(true),
+          shadingMode(SHADING_NONE),
+          textureFilter(TEXTURE_BILINEAR),
+          membershipVersion(0),
+          shadingVersion(0),
+          frameValid(false),
+          frameCameraVersion(0),
+          frameSceneVersion(0),
+          staticValid(false),
+          staticCameraVersion(0),
+          staticSceneVersion(0),
+          frameNumber(0),
+          renderMode(RENDER_COLOR),
+          rasterStatsEnabled(false),
+          camera(width, height),
+          frameBuffer(SDL_CreateRGBSurface(0, width, height, 32, 0, 0, 0, 0)),
+          surface(frameBuffer),
+          directRendering(true),
           zbuffer(width, height)
     {
     }
 
     ~Scene3D() {
-        if (surface) {
-            SDL_FreeSurface(surface);
+        for (auto& model : models) {
+            model->attachToScene(nullptr, -1);
+        }
+        if (frameBuffer) {
+            SDL_FreeSurface(frameBuffer);
         }
     }
 
-    // Добавление модели в сцену
-    void addModel(std::shared_ptr<Model3D> model) {
+    // Добавление модели в сцену. Возвращает узел графа сцены, к которому прикреплена модель.
+    SceneGraph::NodeId addModel(std::shared_ptr<Model3D> model, SceneGraph::NodeId parent = SceneGraph::ROOT) {
+        static const uint32_t model_colors[] = { 0x006600, 0x660000 };
+        model->setFillColor(model_colors[models.size() % 2]);
+        model->attachToScene(&movedModels, (int)models.size());
         models.push_back(model);
+        bvhDirty = true;
+        membershipVersion++;
+        return graph.addNode(parent, model);
+    }
+
+    // Добавление пустого узла-группы для совместного перемещения моделей
+    SceneGraph::NodeId addGroup(SceneGraph::NodeId parent = SceneGraph::ROOT) {
+        membershipVersion++;
+        return graph.addNode(parent);
+    }
+
+    SceneGraph& getGraph() {
+        return graph;
     }
 
     // Очистка экрана
     void clear(uint32_t color = 0) {
-        SDL_FillRect(surface, nullptr, color);
+        SDL_FillRect(frameBuffer, nullptr, color);
+        frameValid = false;
+        staticValid = false;
     }
 
-    // Отрисовка всей сцены
+    // Число рабочих потоков отрисовки (0 — всё в вызывающем потоке)
+    void setWorkerCount(unsigned workerCount) {
+        jobs.reset(new JobSystem(workerCount));
+    }
+
+    JobSystem& getJobSystem() {
+        return *jobs;
+    }
+
+    // Прямая отрисовка в цель подходящего формата вместо копирования из собственного буфера кадра.
+    // Цель должна сохранять содержимое между вызовами render(): в неё дорисовываются только изменения.
+    void setDirectRendering(bool enabled) {
+        directRendering = enabled;
+    }
+
+    // Отрисовка всей сцены в targetSurface
     void render(SDL_Surface* targetSurface) {
         if (!targetSurface) return;
+        PROFILE_SCOPE("frame");
+        stats = RenderStats();
+        uint64_t stageStart = JobSystem::nowNs();
 
-        // Очищаем поверхность светло-серым цветом
-        SDL_FillRect(surface, NULL, SDL_MapRGB(surface->format, 0x11, 0x11, 0x11));
-        
-        zbuffer.clear();
-        // Отрисовка осей координат
-        camera.drawAxes(surface, zbuffer);
-        
-        std::vector<uint32_t> model_colors;
-        model_colors.push_back(0x006600);
-        model_colors.push_back(0x660000);
+        // Преобразования изменившихся моделей и уточнение BVH
+        {
+            ALLOCATION_SCOPE("update");
+            updateBoundingVolumes();
+        }
+        uint64_t stageEnd = JobSystem::nowNs();
+        stats.updateNs = stageEnd - stageStart;
+        stageStart = stageEnd;
 
-        size_t indexModel = 0;
-        // Отрисовка всех моделей
-        for (auto& model : models) {
-            // std::cout << "Model : " << indexModel << std::endl;
-            model->draw(camera, surface, 0xFFFFFF, model_colors[indexModel++], zbuffer);  // Белый цвет для моделей
+        bool rebuildLayer = false;
+        if (isFrameCurrent()) {
+            // Ничего не изменилось: кадр остаётся прежним, его нужно лишь донести до цели
+            damage.clear();
+        } else {
+            ALLOCATION_SCOPE("cull");
+            // Отсечение пирамидой видимости по BVH
+            visibleModels.clear();
+            {
+                PROFILE_SCOPE("frustum cull");
+                bvh.forEachVisible(camera.getFrustum(), [&](int index) {
+                    visibleModels.push_back(index);
+                });
+                // Порядок обхода зависит от истории уточнений BVH; рёбра и равные по глубине полигоны
+                // рисуются в порядке моделей, поэтому кадр не должен зависеть от того, как BVH строилась
+                std::sort(visibleModels.begin(), visibleModels.end());
+            }
+
+            // Проецирование и отбор полигонов видимых моделей, параллельно по моделям.
+            // Модели, не изменившиеся при неподвижной камере, берут данные прошлого кадра.
+            jobs->parallelFor("cull", 0, visibleModels.size(), 16, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    PROFILE_SCOPE_ARG("cull model", visibleModels[i]);
+                    models[visibleModels[i]]->updateVisibleTriangles(camera, (uint32_t)visibleModels[i]);
+                }
+            });
+
+            // Где модели оказались в этом кадре и что из-за этого изменилось
+            footprints.assign(models.size(), SDL_Rect{ 0, 0, 0, 0 });
+            for (int index : visibleModels) {
+                footprints[index] = modelFootprint(index);
+            }
+            collectDamage();
+
+            // Статический слой сохраняется целиком, поэтому при его перестройке меняется весь кадр
+            bool hasDynamic = false;
+            for (const auto& model : models) {
+                hasDynamic |= model->isDynamic();
+            }
+            rebuildLayer = hasDynamic && !isStaticLayerCurrent()
+                && frameValid && frameCameraVersion == camera.getVersion();
+            if (rebuildLayer) damage.setFull(frameBuffer->w, frameBuffer->h);
+
+            rememberFrame();
+            frameFootprints = footprints;
+            frameNumber++;
+            damageHistory[frameNumber % DAMAGE_HISTORY] = damage;
+            stageEnd = JobSystem::nowNs();
+            stats.cullNs = stageEnd - stageStart;
         }
-        //getAllTransformedVerticies();
-        
 
-        // Копируем результат на целевую поверхность
-        SDL_BlitSurface(surface, nullptr, targetSurface, nullptr);
+        // Подходящую цель рисуем напрямую, иначе — собственный буфер с последующим копированием.
+        // В обоих случаях дорисовывается только то, что изменилось с кадра, уже лежащего на поверхности.
+        surface = canDrawInto(targetSurface) ? targetSurface : frameBuffer;
+        targetDamage(surface, redrawRegion);
+        const DirtyRegion& redraw = redrawRegion;
+        if (!redraw.empty()) {
+            for (int index : visibleModels) {
+                stats.trianglesSubmitted += models[index]->getPolygonCount();
+                stats.trianglesCulled += models[index]->getCulledCount();
+                stats.trianglesNearRejected += models[index]->getNearRejectedCount();
+            }
+            bool full = redraw.getArea() * 2 > (int64_t)surface->w * surface->h;
+            stageStart = JobSystem::nowNs();
+            if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+            drawFrame(full ? nullptr : &redraw, rebuildLayer);
+            if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+            stats.rasterNs = JobSystem::nowNs() - stageStart - stats.sortNs;
+        }
+        if (surface != targetSurface) {
+            stageStart = JobSystem::nowNs();
+            present(targetSurface);
+            stats.presentNs = JobSystem::nowNs() - stageStart;
+        }
+        surface = frameBuffer;
     }
 
-    
-
     // Изменение размера окна
     void resize(int width, int height) {
-        if (surface) {
-            SDL_FreeSurface(surface);
+        if (frameBuffer) {
+            SDL_FreeSurface(frameBuffer);
         }
-        surface = SDL_CreateRGBSurface(0, width, height, 32, 0, 0, 0, 0);
+        frameBuffer = SDL_CreateRGBSurface(0, width, height, 32, 0, 0, 0, 0);
+        surface = frameBuffer;
         camera.setScreenSize(width, height);
-        zbuffer.clear();
+        zbuffer.make_matrix(width, height);
+        frameValid = false;
+        staticValid = false;
+        targetFrames.clear();
     }
 
     Camera3D& getCamera() {
         return camera;
     }
+
+    // Источники света; изменения учитываются в следующем render()
+    Lighting& getLighting() {
+        return lighting;
+    }
+
+    ShadingMode getShadingMode() const {
+        return shadingMode;
+    }
+
+    void setShadingMode(ShadingMode mode) {
+        if (mode == shadingMode) return;
+        shadingMode = mode;
+        shadingVersion++;
+    }
+
+    DepthEncoding getDepthEncoding() const {
+        return zbuffer.getEncoding();
+    }
+
+    // Что хранит буфер глубины. Смена меняет проекцию камеры, а с ней её версию, поэтому кадр
+    // и кэш статического слоя (его глубина — в старой кодировке) рисуются заново.
+    void setDepthEncoding(DepthEncoding encoding) {
+        if (encoding == zbuffer.getEncoding()) return;
+        camera.setDepthEncoding(encoding);
+        zbuffer.setEncoding(encoding);
+    }
+
+    TextureFilter getTextureFilter() const {
+        return textureFilter;
+    }
+
+    void setTextureFilter(TextureFilter filter) {
+        if (filter == textureFilter) return;
+        textureFilter = filter;
+        shadingVersion++;
+    }
+
+    RenderMode getRenderMode() const {
+        return renderMode;
+    }
+
+    // Смена режима перерисовывает кадр целиком, как смена освещения
+    void setRenderMode(RenderMode mode) {
+        if (mode == renderMode) return;
+        renderMode = mode;
+        shadingVersion++;
+    }
+
+    // Подсчёт пикселей, строк и байтов растеризатора в getStats(). Изображение не меняется,
+    // но растеризация идёт скалярным путём и заметно медленнее. В RENDER_OVERDRAW подсчёт ведётся всегда.
+    void setRasterStatsEnabled(bool enabled) {
+        rasterStatsEnabled = enabled;
+    }
+
+    // Работа последнего render(): отбор полигонов и, при подсчёте, растеризация
+    const RenderStats& getStats() const {
+        return stats;
+    }
+
+    // Поверх кадра в targetSurface нарисовано своё (например, HUD) в пределах rect.
+    // Следующий render() в эту цель вернёт там изображение кадра, даже если сцена не менялась.
+    void invalidateTarget(SDL_Surface* targetSurface, const SDL_Rect& rect) {
+        for (TargetFrame& entry : targetFrames) {
+            if (entry.surface == targetSurface) entry.overlay.add(rect);
+        }
+    }
+
+    // Изменившиеся области последнего render() относительно предыдущего кадра.
+    // Пусто, если кадр не менялся.
+    const DirtyRegion& getDamage() const {
+        return damage;
+    }
+
+    int getWidth() const {
+        return frameBuffer->w;
+    }
+
+    int getHeight() const {
+        return frameBuffer->h;
+    }
+
+    // Пересчёт мировых матриц графа сцены и синхронизация BVH с границами моделей
+    void updateBoundingVolumes() {
+        graph.updateWorldTransforms(jobs.get());
+
+        PROFILE_SCOPE("bvh update");
+        if (bvhDirty) {
+            std::vector<BoundingBox> bounds;
+            bounds.reserve(models.size());
+            for (const auto& model : models) {
+                bounds.push_back(model->getBounds());
+            }
+            // Поддеревья графа становятся отдельными узлами BVH и отсекаются целиком
+            std::vector<int> groups(models.size(), -1);
+            graph.forEachModelGroup([&](const std::shared_ptr<Model3D>& model, int group) {
+                int index = model->getSceneIndex();
+                if (index >= 0) groups[index] = group;
+            });
+            bvh.build(bounds, groups);
+            bvhDirty = false;
+        } else {
+            // Уточняем дерево только для сдвинувшихся моделей
+            for (int index : movedModels.indices) {
+                if (models[index]->getBounds() != bvh.getItemBounds(index)) {
+                    bvh.updateItem(index, models[index]->getBounds());
+                }
+            }
+            bvh.refit();
+        }
+
+        for (int index : movedModels.indices) {
+            models[index]->clearMoved();
+        }
+        movedModels.indices.clear();
+    }
+
+    // Выбор ближайшей модели под точкой экрана
+    PickResult pick(int screenX, int screenY) {
+        updateBoundingVolumes();
+
+        PickResult result = { nullptr, -1, std::numeric_limits<float>::max() };
+        // Луч через центр пикселя
+        Ray ray = camera.screenRay(screenX + 0.5f, screenY + 0.5f);
+
+        bvh.intersectRay(ray, result.distance, [&](int index, float& tMax) {
+            int polygon;
+            if (models[index]->intersectRay(ray, tMax, polygon)) {
+                result.model = models[index];
+                result.triangle = polygon;
+                return true;
+            }
+            return false;
+        });
+        return result;
+    }
     
     // Получение отсортированных видимых полигонов
     std::vector<Polygon3D> getVisiblePolygons(const Camera3D& camera) {
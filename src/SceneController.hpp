@@ -0,0 +1,138 @@
+#ifndef _SCENE_CONTROLLER_HPP_
+#define _SCENE_CONTROLLER_HPP_
+
+#include "Scene3D.hpp"
+
+#include <cstdint>
+#include <memory>
+
+// Изменение сцены, переданное из потока ввода в поток отрисовки
+struct SceneCommand {
+    enum Type {
+        SELECT_AT,         // Выбор модели в точке экрана (x, y)
+        ROTATE_MODEL,      // Поворот выбранной модели вокруг центра: x — по Y, y — по X
+        ROTATE_OVER_EDGE,  // Поворот выбранной модели вокруг ребра 2-3 на x
+        TRANSLATE_MODEL,   // Сдвиг выбранной модели на (x, y, z)
+        SCALE_MODEL,       // Масштаб выбранной модели относительно центра на x
+        ROTATE_CAMERA,     // Поворот камеры на (x, y)
+        MOVE_CAMERA,       // Перемещение камеры: вперёд x, вправо y, вверх z
+        RESIZE,            // Новый размер окна (x, y)
+        CYCLE_SHADING,     // Следующий режим освещения: без освещения, плоское, по Гуро
+        TOGGLE_FILTER,     // Переключение выборки текселей: ближайший или билинейная
+        TOGGLE_OVERDRAW,   // Переключение изображения и тепловой карты перерисовки
+        TOGGLE_HUD         // Показ или скрытие панели производительности
+    };
+
+    Type type;
+    float x, y, z;
+    uint64_t inputNs;  // Момент обработки события ввода, JobSystem::nowNs()
+
+    // Слияние со следующей командой того же типа. Время ввода остаётся от более ранней.
+    // Повороты складываются приближённо, чего для интерактивного ввода достаточно.
+    bool merge(const SceneCommand& next) {
+        if (next.type != type) return false;
+        switch (type) {
+            case SCALE_MODEL:
+                x *= next.x;
+                return true;
+            case RESIZE:
+                x = next.x;
+                y = next.y;
+                return true;
+            case SELECT_AT:
+            case CYCLE_SHADING:
+            case TOGGLE_FILTER:
+            case TOGGLE_OVERDRAW:
+            case TOGGLE_HUD:
+                return false;
+            default:
+                x += next.x;
+                y += next.y;
+                z += next.z;
+                return true;
+        }
+    }
+};
+
+// Применение команд к сцене и выбранной модели. Один и тот же код служит потоку отрисовки
+// окна и воспроизведению записанного ввода, поэтому запись меняет сцену так же, как живой сеанс.
+// TOGGLE_HUD относится к тому, кто показывает кадры, и здесь не обрабатывается.
+class SceneController {
+private:
+    Scene3D& scene;
+    std::shared_ptr<Model3D> selected;  // Модель, к которой применяются команды ввода
+
+public:
+    explicit SceneController(Scene3D& scene) : scene(scene) {}
+
+    void apply(const SceneCommand& command) {
+        if (command.type == SceneCommand::SELECT_AT) {
+            PickResult picked = scene.pick((int)command.x, (int)command.y);
+            if (picked.model) {
+                select(picked.model);
+            }
+            return;
+        }
+        if (command.type == SceneCommand::ROTATE_CAMERA) {
+            scene.getCamera().rotate(command.x, command.y);
+            return;
+        }
+        if (command.type == SceneCommand::MOVE_CAMERA) {
+            scene.getCamera().move(command.x, command.y, command.z);
+            return;
+        }
+        if (command.type == SceneCommand::RESIZE) {
+            scene.resize((int)command.x, (int)command.y);
+            return;
+        }
+        if (command.type == SceneCommand::CYCLE_SHADING) {
+            scene.setShadingMode((ShadingMode)((scene.getShadingMode() + 1) % (SHADING_GOURAUD + 1)));
+            return;
+        }
+        if (command.type == SceneCommand::TOGGLE_FILTER) {
+            scene.setTextureFilter(scene.getTextureFilter() == TEXTURE_NEAREST ? TEXTURE_BILINEAR : TEXTURE_NEAREST);
+            return;
+        }
+        if (command.type == SceneCommand::TOGGLE_OVERDRAW) {
+            scene.setRenderMode(scene.getRenderMode() == RENDER_OVERDRAW ? RENDER_COLOR : RENDER_OVERDRAW);
+            return;
+        }
+        if (!selected) return;
+
+        Position3D center = selected->getPosition();
+        switch (command.type) {
+            case SceneCommand::ROTATE_MODEL:
+                // Вращение вокруг центра модели
+                selected->translate(-center.getX(), -center.getY(), -center.getZ());
+                selected->rotateY(command.x);
+                selected->rotateX(command.y);
+                selected->translate(center.getX(), center.getY(), center.getZ());
+                break;
+            case SceneCommand::ROTATE_OVER_EDGE:
+                selected->RotateOverEdge(2, 3, command.x);
+                break;
+            case SceneCommand::TRANSLATE_MODEL:
+                selected->translate(command.x, command.y, command.z);
+                break;
+            case SceneCommand::SCALE_MODEL:
+                selected->applyTransform(Matrix::identity(4));
+                center = selected->getPosition();
+                selected->translate(-center.getX(), -center.getY(), -center.getZ());
+                selected->scale(command.x, command.x, command.x);
+                selected->translate(center.getX(), center.getY(), center.getZ());
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Выбранная модель рисуется поверх кэша статического слоя сцены, остальные — из кэша
+    void select(std::shared_ptr<Model3D> model) {
+        if (selected == model) return;
+        if (selected) selected->setDynamic(false);
+        selected = std::move(model);
+        if (selected) selected->setDynamic(true);
+    }
+};
+
+#endif // _SCENE_CONTROLLER_HPP_
@@ -0,0 +1,185 @@
+#ifndef _SCENE_GRAPH_HPP_
+#define _SCENE_GRAPH_HPP_
+
+#include "Matrix.hpp"
+#include "Model3D.hpp"
+#include "JobSystem.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Иерархия узлов сцены с локальными и мировыми преобразованиями.
+//
+// Узлы хранятся в плоских массивах в порядке «родитель перед потомком»,
+// причём поддерево каждого узла занимает непрерывный диапазон
+// [index, index + subtreeSize). Это позволяет пересчитать мировые матрицы
+// одним линейным проходом. Отсечение по пирамиде видимости делает BVH сцены
+// (BoundingVolumeHierarchy.hpp): модели каждого поддерева верхнего уровня образуют в ней группу
+// со своим узлом, границы которого — границы всего поддерева (forEachModelGroup).
+//
+// Снаружи узлы адресуются стабильными идентификаторами (NodeId),
+// так как вставка в середину сдвигает индексы массивов.
+class SceneGraph {
+public:
+    typedef int NodeId;
+    enum : NodeId {
+        ROOT = 0,      // Корневой узел, существует всегда
+        INVALID = -1
+    };
+
+private:
+    enum NodeFlags : uint8_t {
+        LOCAL_DIRTY   = 1,  // Изменилась локальная матрица узла
+        WORLD_CHANGED = 2   // Мировая матрица пересчитана в текущем кадре
+    };
+
+    // Данные узлов по индексу в массиве
+    std::vector<int> parents;             // Индекс родителя (-1 у корня)
+    std::vector<int> subtreeSizes;        // Размер поддерева, включая сам узел
+    std::vector<Matrix> localMatrices;    // Преобразование относительно родителя
+    std::vector<Matrix> worldMatrices;    // Накопленное преобразование
+    std::vector<uint8_t> flags;
+    std::vector<std::shared_ptr<Model3D>> models;
+    std::vector<NodeId> indexToId;
+
+    std::vector<int> idToIndex;           // Индекс в массивах по идентификатору узла
+    bool anyDirty;
+
+    std::vector<int> changedModelNodes;   // Узлы с моделями, чья мировая матрица изменилась в этом кадре
+
+public:
+    SceneGraph() : anyDirty(false) {
+        parents.push_back(-1);
+        subtreeSizes.push_back(1);
+        localMatrices.push_back(Matrix::identity(4));
+        worldMatrices.push_back(Matrix::identity(4));
+        flags.push_back(0);
+        models.push_back(nullptr);
+        indexToId.push_back(ROOT);
+        idToIndex.push_back(0);
+    }
+
+    // Добавление узла последним потомком parent. Возвращает идентификатор узла.
+    NodeId addNode(NodeId parent = ROOT, std::shared_ptr<Model3D> model = nullptr) {
+        if (!isValid(parent)) return INVALID;
+
+        int parentIndex = idToIndex[parent];
+        int index = parentIndex + subtreeSizes[parentIndex];
+        NodeId id = (NodeId)idToIndex.size();
+
+        // Сдвигаем ссылки на родителей у узлов, которые окажутся правее вставки
+        for (size_t i = index; i < parents.size(); ++i) {
+            if (parents[i] >= index) parents[i]++;
+        }
+        for (size_t i = index; i < indexToId.size(); ++i) {
+            idToIndex[indexToId[i]]++;
+        }
+
+        parents.insert(parents.begin() + index, parentIndex);
+        subtreeSizes.insert(subtreeSizes.begin() + index, 1);
+        localMatrices.insert(localMatrices.begin() + index, Matrix::identity(4));
+        worldMatrices.insert(worldMatrices.begin() + index, worldMatrices[parentIndex]);
+        flags.insert(flags.begin() + index, LOCAL_DIRTY);
+        models.insert(models.begin() + index, model);
+        indexToId.insert(indexToId.begin() + index, id);
+        idToIndex.push_back(index);
+
+        // Все предки получают ещё одного потомка
+        for (int p = parentIndex; p >= 0; p = parents[p]) {
+            subtreeSizes[p]++;
+        }
+
+        anyDirty = true;
+        return id;
+    }
+
+    bool isValid(NodeId id) const {
+        return id >= 0 && id < (NodeId)idToIndex.size();
+    }
+
+    size_t getNodeCount() const {
+        return parents.size();
+    }
+
+    // Замена локального преобразования. Пересчёт откладывается до updateWorldTransforms.
+    void setLocalTransform(NodeId id, const Matrix& matrix) {
+        if (!isValid(id)) return;
+        int index = idToIndex[id];
+        localMatrices[index] = matrix;
+        flags[index] |= LOCAL_DIRTY;
+        anyDirty = true;
+    }
+
+    // Домножение локального преобразования слева (как Model3D::applyTransform)
+    void applyLocalTransform(NodeId id, const Matrix& transform) {
+        if (!isValid(id)) return;
+        int index = idToIndex[id];
+        setLocalTransform(id, transform * localMatrices[index]);
+    }
+
+    const Matrix& getLocalTransform(NodeId id) const {
+        return localMatrices[idToIndex[id]];
+    }
+
+    const Matrix& getWorldTransform(NodeId id) const {
+        return worldMatrices[idToIndex[id]];
+    }
+
+    std::shared_ptr<Model3D> getModel(NodeId id) const {
+        return models[idToIndex[id]];
+    }
+
+    // Группы моделей для BVH: visit(model, group), где group — индекс узла верхнего уровня
+    // (потомка корня), в поддереве которого лежит модель, или -1, если этот узел без потомков.
+    template <typename Visitor>
+    void forEachModelGroup(Visitor visit) const {
+        int top = -1;
+        for (size_t i = 1; i < parents.size(); ++i) {
+            if (parents[i] == ROOT) top = (int)i;
+            if (models[i]) visit(models[i], subtreeSizes[top] > 1 ? top : -1);
+        }
+    }
+
+    // Пересчёт мировых матриц помеченных поддеревьев. Вызывается раз в кадр.
+    // Матрицы считаются одним последовательным проходом, а вершины моделей
+    // пересчитываются параллельно, если передана система задач.
+    // Возвращает true, если хотя бы одна матрица изменилась.
+    bool updateWorldTransforms(JobSystem* jobs = nullptr) {
+        if (!anyDirty) return false;
+
+        changedModelNodes.clear();
+        for (size_t i = 0; i < parents.size(); ++i) {
+            int parent = parents[i];
+            bool parentChanged = parent >= 0 && (flags[parent] & WORLD_CHANGED);
+
+            if ((flags[i] & LOCAL_DIRTY) || parentChanged) {
+                worldMatrices[i] = parent >= 0 ? worldMatrices[parent] * localMatrices[i] : localMatrices[i];
+                flags[i] = WORLD_CHANGED;
+                if (models[i]) {
+                    changedModelNodes.push_back((int)i);
+                }
+            } else {
+                flags[i] = 0;
+            }
+        }
+
+        auto updateModels = [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                int index = changedModelNodes[i];
+                PROFILE_SCOPE_ARG("transform model", index);  // Номер узла графа
+                models[index]->setParentMatrix(worldMatrices[index]);
+            }
+        };
+        if (jobs) {
+            jobs->parallelFor("transform", 0, changedModelNodes.size(), 8, updateModels);
+        } else {
+            updateModels(0, changedModelNodes.size());
+        }
+
+        anyDirty = false;
+        return true;
+    }
+};
+
+#endif // _SCENE_GRAPH_HPP_
@@ -0,0 +1,592 @@
+#ifndef _SIMD_KERNELS_HPP_
+#define _SIMD_KERNELS_HPP_
+
+#include <SDL2/SDL.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Горячие циклы рендера в нескольких вариантах набора инструкций: scalar, SSE4.1, AVX2, AVX-512.
+//
+// Все варианты собираются в одном бинарнике (атрибут target у функции), при первом обращении
+// выбирается лучший из поддерживаемых процессором. ENGINE_SIMD=scalar|sse4.1|avx2|avx512
+// задаёт вариант явно; неподдерживаемый заменяется лучшим доступным.
+//
+// Варианты дают побитово одинаковый результат: операции выполняются в том же порядке, что и в
+// скалярном коде, без FMA и приближённых обратных величин. Хвосты короче вектора считает scalar.
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define SIMD_KERNELS_X86 1
+    #include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+    // GCC сливает умножение со сложением в FMA, если оно доступно варианту, — это меняет округление
+    #pragma GCC push_options
+    #pragma GCC optimize("fp-contract=off")
+#endif
+
+// Clang сливает операции внутри одного выражения; скалярные циклы встраиваются и в варианты с FMA
+#if defined(__clang__)
+    #define SIMD_NO_CONTRACT _Pragma("clang fp contract(off)")
+#else
+    #define SIMD_NO_CONTRACT
+#endif
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE41,
+    SIMD_AVX2,
+    SIMD_AVX512,
+    SIMD_LEVEL_COUNT
+};
+
+// Таблица ядер одного варианта
+struct SimdKernels {
+    SimdLevel level;
+    const char* name;
+
+    // out[i][j] = m[i][0] * in[0][j] + ... + m[i][3] * in[3][j]; матрица 4x4 построчно,
+    // in и out — по 4 строки из count значений (однородные координаты вершин)
+    void (*transformPoints)(const float* m, const float* const* in, float* const* out, size_t count);
+
+    // Проецирование как Camera3D::projectPoint: экранные x, y, 1 / w и w отсечения
+    void (*projectPoints)(const float* m, float halfWidth, float halfHeight,
+                          const float* x, const float* y, const float* z, size_t count,
+                          float* screenX, float* screenY, float* inverseW, float* clipW);
+
+    // visible[i] = нормаль полигона i смотрит на камеру (от точки полигона point[i])
+    void (*cullBackFaces)(const float* normalX, const float* normalY, const float* normalZ,
+                          const float* pointX, const float* pointY, const float* pointZ, size_t count,
+                          float cameraX, float cameraY, float cameraZ, uint8_t* visible);
+
+    // Непрозрачный отрезок строки с проверкой и записью глубины: пиксели x = xBegin .. xBegin + count - 1,
+    // pixels и depth указывают на x = xBegin; z = 1 / (leftW + (x - leftX) * wStep), пишется при z < depth
+    void (*fillSpan)(uint32_t* pixels, float* depth, int xBegin, int count,
+                     float leftX, float leftW, float wStep, uint32_t color);
+
+    // То же для DEPTH_REVERSE_Z: z = leftW + (x - leftX) * wStep без обращения, пишется при z > depth
+    void (*fillSpanReverse)(uint32_t* pixels, float* depth, int xBegin, int count,
+                            float leftX, float leftW, float wStep, uint32_t color);
+
+    // Заполнение буфера глубины значением
+    void (*fillDepth)(float* depth, size_t count, float value);
+
+    // Перепаковка 32-битных пикселей между форматами с 8-битными каналами
+    void (*repackPixels)(const uint32_t* source, uint32_t* target, size_t count,
+                         const SDL_PixelFormat* from, const SDL_PixelFormat* to);
+};
+
+// Скалярные версии. Работают с диапазоном [begin, end), чтобы векторные варианты досчитывали ими хвосты.
+
+inline void scalarTransformRange(const float* m, const float* const* in, float* const* out, size_t begin, size_t end) {
+    SIMD_NO_CONTRACT
+    for (size_t j = begin; j < end; ++j) {
+        float x = in[0][j], y = in[1][j], z = in[2][j], w = in[3][j];
+        for (int i = 0; i < 4; ++i) {
+            // Порядок сложения как в Matrix::operator*
+            float sum = 0.0f;
+            sum += m[i * 4 + 0] * x;
+            sum += m[i * 4 + 1] * y;
+            sum += m[i * 4 + 2] * z;
+            sum += m[i * 4 + 3] * w;
+            out[i][j] = sum;
+        }
+    }
+}
+
+inline void scalarProjectRange(const float* m, float halfWidth, float halfHeight,
+                               const float* x, const float* y, const float* z, size_t begin, size_t end,
+                               float* screenX, float* screenY, float* inverseW, float* clipW) {
+    SIMD_NO_CONTRACT
+    for (size_t i = begin; i < end; ++i) {
+        float cx = m[0]  * x[i] + m[1]  * y[i] + m[2]  * z[i] + m[3];
+        float cy = m[4]  * x[i] + m[5]  * y[i] + m[6]  * z[i] + m[7];
+        float w  = m[12] * x[i] + m[13] * y[i] + m[14] * z[i] + m[15];
+        if (w != 0) {
+            cx /= w;
+            cy /= w;
+        }
+        screenX[i] = halfWidth * cx + halfWidth;
+        screenY[i] = -halfHeight * cy + halfHeight;
+        inverseW[i] = 1.0f / w;
+        clipW[i] = w;
+    }
+}
+
+inline void scalarCullRange(const float* normalX, const float* normalY, const float* normalZ,
+                            const float* pointX, const float* pointY, const float* pointZ, size_t begin, size_t end,
+                            float cameraX, float cameraY, float cameraZ, uint8_t* visible) {
+    SIMD_NO_CONTRACT
+    for (size_t i = begin; i < end; ++i) {
+        float dot = normalX[i] * (cameraX - pointX[i]) + normalY[i] * (cameraY - pointY[i]) + normalZ[i] * (cameraZ - pointZ[i]);
+        visible[i] = dot > 0;
+    }
+}
+
+template <bool Reverse>
+inline void scalarFillSpanRange(uint32_t* pixels, float* depth, int xBegin, int begin, int end,
+                                float leftX, float leftW, float wStep, uint32_t color) {
+    SIMD_NO_CONTRACT
+    for (int i = begin; i < end; ++i) {
+        float xSteps = (xBegin + i) - leftX;
+        float inverseW = leftW + xSteps * wStep;
+        float z = Reverse ? inverseW : 1.0f / inverseW;
+        if (Reverse ? z > depth[i] : z < depth[i]) {
+            depth[i] = z;
+            pixels[i] = color;
+        }
+    }
+}
+
+inline void scalarRepackRange(const uint32_t* source, uint32_t* target, size_t begin, size_t end,
+                              const SDL_PixelFormat* from, const SDL_PixelFormat* to) {
+    for (size_t x = begin; x < end; ++x) {
+        uint32_t pixel = source[x];
+        uint32_t r = (pixel & from->Rmask) >> from->Rshift;
+        uint32_t g = (pixel & from->Gmask) >> from->Gshift;
+        uint32_t b = (pixel & from->Bmask) >> from->Bshift;
+        target[x] = (r << to->Rshift) | (g << to->Gshift) | (b << to->Bshift) | to->Amask;
+    }
+}
+
+inline void scalarTransformPoints(const float* m, const float* const* in, float* const* out, size_t count) {
+    scalarTransformRange(m, in, out, 0, count);
+}
+
+inline void scalarProjectPoints(const float* m, float halfWidth, float halfHeight,
+                                const float* x, const float* y, const float* z, size_t count,
+                                float* screenX, float* screenY, float* inverseW, float* clipW) {
+    scalarProjectRange(m, halfWidth, halfHeight, x, y, z, 0, count, screenX, screenY, inverseW, clipW);
+}
+
+inline void scalarCullBackFaces(const float* normalX, const float* normalY, const float* normalZ,
+                                const float* pointX, const float* pointY, const float* pointZ, size_t count,
+                                float cameraX, float cameraY, float cameraZ, uint8_t* visible) {
+    scalarCullRange(normalX, normalY, normalZ, pointX, pointY, pointZ, 0, count, cameraX, cameraY, cameraZ, visible);
+}
+
+template <bool Reverse>
+inline void scalarFillSpan(uint32_t* pixels, float* depth, int xBegin, int count,
+                           float leftX, float leftW, float wStep, uint32_t color) {
+    scalarFillSpanRange<Reverse>(pixels, depth, xBegin, 0, count, leftX, leftW, wStep, color);
+}
+
+inline void scalarFillDepth(float* depth, size_t count, float value) {
+    for (size_t i = 0; i < count; ++i) depth[i] = value;
+}
+
+inline void scalarRepackPixels(const uint32_t* source, uint32_t* target, size_t count,
+                               const SDL_PixelFormat* from, const SDL_PixelFormat* to) {
+    scalarRepackRange(source, target, 0, count, from, to);
+}
+
+#ifdef SIMD_KERNELS_X86
+
+// ---------------------------------------------------------------- SSE4.1, 4 значения
+
+__attribute__((target("sse4.1")))
+inline void sse41TransformPoints(const float* m, const float* const* in, float* const* out, size_t count) {
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m128 x = _mm_loadu_ps(in[0] + j), y = _mm_loadu_ps(in[1] + j);
+        __m128 z = _mm_loadu_ps(in[2] + j), w = _mm_loadu_ps(in[3] + j);
+        for (int i = 0; i < 4; ++i) {
+            __m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_set1_ps(m[i * 4 + 0]), x));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[i * 4 + 1]), y));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[i * 4 + 2]), z));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[i * 4 + 3]), w));
+            _mm_storeu_ps(out[i] + j, sum);
+        }
+    }
+    scalarTransformRange(m, in, out, j, count);
+}
+
+__attribute__((target("sse4.1")))
+inline void sse41ProjectPoints(const float* m, float halfWidth, float halfHeight,
+                               const float* x, const float* y, const float* z, size_t count,
+                               float* screenX, float* screenY, float* inverseW, float* clipW) {
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    __m128 hw = _mm_set1_ps(halfWidth), hh = _mm_set1_ps(halfHeight), nhh = _mm_set1_ps(-halfHeight);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+        __m128 cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), vx), _mm_mul_ps(_mm_set1_ps(m[1]), vy)),
+                                          _mm_mul_ps(_mm_set1_ps(m[2]), vz)), _mm_set1_ps(m[3]));
+        __m128 cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[4]), vx), _mm_mul_ps(_mm_set1_ps(m[5]), vy)),
+                                          _mm_mul_ps(_mm_set1_ps(m[6]), vz)), _mm_set1_ps(m[7]));
+        __m128 w  = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[12]), vx), _mm_mul_ps(_mm_set1_ps(m[13]), vy)),
+                                          _mm_mul_ps(_mm_set1_ps(m[14]), vz)), _mm_set1_ps(m[15]));
+        // Деление только там, где w != 0 (NaN тоже делится, как в скалярном коде)
+        __m128 divide = _mm_cmpneq_ps(w, zero);
+        cx = _mm_blendv_ps(cx, _mm_div_ps(cx, w), divide);
+        cy = _mm_blendv_ps(cy, _mm_div_ps(cy, w), divide);
+        _mm_storeu_ps(screenX + i, _mm_add_ps(_mm_mul_ps(hw, cx), hw));
+        _mm_storeu_ps(screenY + i, _mm_add_ps(_mm_mul_ps(nhh, cy), hh));
+        _mm_storeu_ps(inverseW + i, _mm_div_ps(one, w));
+        _mm_storeu_ps(clipW + i, w);
+    }
+    scalarProjectRange(m, halfWidth, halfHeight, x, y, z, i, count, screenX, screenY, inverseW, clipW);
+}
+
+__attribute__((target("sse4.1")))
+inline void sse41CullBackFaces(const float* normalX, const float* normalY, const float* normalZ,
+                               const float* pointX, const float* pointY, const float* pointZ, size_t count,
+                               float cameraX, float cameraY, float cameraZ, uint8_t* visible) {
+    __m128 cx = _mm_set1_ps(cameraX), cy = _mm_set1_ps(cameraY), cz = _mm_set1_ps(cameraZ), zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(normalX + i), _mm_sub_ps(cx, _mm_loadu_ps(pointX + i))),
+                                           _mm_mul_ps(_mm_loadu_ps(normalY + i), _mm_sub_ps(cy, _mm_loadu_ps(pointY + i)))),
+                                _mm_mul_ps(_mm_loadu_ps(normalZ + i), _mm_sub_ps(cz, _mm_loadu_ps(pointZ + i))));
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(dot, zero));
+        for (int k = 0; k < 4; ++k) visible[i + k] = (mask >> k) & 1;
+    }
+    scalarCullRange(normalX, normalY, normalZ, pointX, pointY, pointZ, i, count, cameraX, cameraY, cameraZ, visible);
+}
+
+template <bool Reverse>
+__attribute__((target("sse4.1")))
+inline void sse41FillSpan(uint32_t* pixels, float* depth, int xBegin, int count,
+                          float leftX, float leftW, float wStep, uint32_t color) {
+    __m128 vLeftX = _mm_set1_ps(leftX), vLeftW = _mm_set1_ps(leftW), vStep = _mm_set1_ps(wStep), one = _mm_set1_ps(1.0f);
+    __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    __m128 vColor = _mm_castsi128_ps(_mm_set1_epi32((int)color));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(xBegin + i), lanes));
+        __m128 inverseW = _mm_add_ps(vLeftW, _mm_mul_ps(_mm_sub_ps(x, vLeftX), vStep));
+        __m128 z = Reverse ? inverseW : _mm_div_ps(one, inverseW);
+        __m128 old = _mm_loadu_ps(depth + i);
+        __m128 closer = Reverse ? _mm_cmpgt_ps(z, old) : _mm_cmplt_ps(z, old);
+        _mm_storeu_ps(depth + i, _mm_blendv_ps(old, z, closer));
+        __m128 pixel = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(pixels + i)));
+        _mm_storeu_si128((__m128i*)(pixels + i), _mm_castps_si128(_mm_blendv_ps(pixel, vColor, closer)));
+    }
+    scalarFillSpanRange<Reverse>(pixels, depth, xBegin, i, count, leftX, leftW, wStep, color);
+}
+
+__attribute__((target("sse4.1")))
+inline void sse41FillDepth(float* depth, size_t count, float value) {
+    __m128 v = _mm_set1_ps(value);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) _mm_storeu_ps(depth + i, v);
+    for (; i < count; ++i) depth[i] = value;
+}
+
+__attribute__((target("sse4.1")))
+inline void sse41RepackPixels(const uint32_t* source, uint32_t* target, size_t count,
+                              const SDL_PixelFormat* from, const SDL_PixelFormat* to) {
+    __m128i rMask = _mm_set1_epi32((int)from->Rmask), gMask = _mm_set1_epi32((int)from->Gmask);
+    __m128i bMask = _mm_set1_epi32((int)from->Bmask), aMask = _mm_set1_epi32((int)to->Amask);
+    __m128i rFrom = _mm_cvtsi32_si128(from->Rshift), gFrom = _mm_cvtsi32_si128(from->Gshift), bFrom = _mm_cvtsi32_si128(from->Bshift);
+    __m128i rTo = _mm_cvtsi32_si128(to->Rshift), gTo = _mm_cvtsi32_si128(to->Gshift), bTo = _mm_cvtsi32_si128(to->Bshift);
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4) {
+        __m128i pixel = _mm_loadu_si128((const __m128i*)(source + x));
+        __m128i r = _mm_sll_epi32(_mm_srl_epi32(_mm_and_si128(pixel, rMask), rFrom), rTo);
+        __m128i g = _mm_sll_epi32(_mm_srl_epi32(_mm_and_si128(pixel, gMask), gFrom), gTo);
+        __m128i b = _mm_sll_epi32(_mm_srl_epi32(_mm_and_si128(pixel, bMask), bFrom), bTo);
+        _mm_storeu_si128((__m128i*)(target + x), _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, aMask)));
+    }
+    scalarRepackRange(source, target, x, count, from, to);
+}
+
+// ---------------------------------------------------------------- AVX2, 8 значений
+
+__attribute__((target("avx2")))
+inline void avx2TransformPoints(const float* m, const float* const* in, float* const* out, size_t count) {
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 x = _mm256_loadu_ps(in[0] + j), y = _mm256_loadu_ps(in[1] + j);
+        __m256 z = _mm256_loadu_ps(in[2] + j), w = _mm256_loadu_ps(in[3] + j);
+        for (int i = 0; i < 4; ++i) {
+            __m256 sum = _mm256_add_ps(_mm256_setzero_ps(), _mm256_mul_ps(_mm256_set1_ps(m[i * 4 + 0]), x));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(m[i * 4 + 1]), y));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(m[i * 4 + 2]), z));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(m[i * 4 + 3]), w));
+            _mm256_storeu_ps(out[i] + j, sum);
+        }
+    }
+    scalarTransformRange(m, in, out, j, count);
+}
+
+__attribute__((target("avx2")))
+inline void avx2ProjectPoints(const float* m, float halfWidth, float halfHeight,
+                              const float* x, const float* y, const float* z, size_t count,
+                              float* screenX, float* screenY, float* inverseW, float* clipW) {
+    __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    __m256 hw = _mm256_set1_ps(halfWidth), hh = _mm256_set1_ps(halfHeight), nhh = _mm256_set1_ps(-halfHeight);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        __m256 cx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[0]), vx), _mm256_mul_ps(_mm256_set1_ps(m[1]), vy)),
+                                                _mm256_mul_ps(_mm256_set1_ps(m[2]), vz)), _mm256_set1_ps(m[3]));
+        __m256 cy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[4]), vx), _mm256_mul_ps(_mm256_set1_ps(m[5]), vy)),
+                                                _mm256_mul_ps(_mm256_set1_ps(m[6]), vz)), _mm256_set1_ps(m[7]));
+        __m256 w  = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[12]), vx), _mm256_mul_ps(_mm256_set1_ps(m[13]), vy)),
+                                                _mm256_mul_ps(_mm256_set1_ps(m[14]), vz)), _mm256_set1_ps(m[15]));
+        __m256 divide = _mm256_cmp_ps(w, zero, _CMP_NEQ_UQ);
+        cx = _mm256_blendv_ps(cx, _mm256_div_ps(cx, w), divide);
+        cy = _mm256_blendv_ps(cy, _mm256_div_ps(cy, w), divide);
+        _mm256_storeu_ps(screenX + i, _mm256_add_ps(_mm256_mul_ps(hw, cx), hw));
+        _mm256_storeu_ps(screenY + i, _mm256_add_ps(_mm256_mul_ps(nhh, cy), hh));
+        _mm256_storeu_ps(inverseW + i, _mm256_div_ps(one, w));
+        _mm256_storeu_ps(clipW + i, w);
+    }
+    scalarProjectRange(m, halfWidth, halfHeight, x, y, z, i, count, screenX, screenY, inverseW, clipW);
+}
+
+__attribute__((target("avx2")))
+inline void avx2CullBackFaces(const float* normalX, const float* normalY, const float* normalZ,
+                              const float* pointX, const float* pointY, const float* pointZ, size_t count,
+                              float cameraX, float cameraY, float cameraZ, uint8_t* visible) {
+    __m256 cx = _mm256_set1_ps(cameraX), cy = _mm256_set1_ps(cameraY), cz = _mm256_set1_ps(cameraZ), zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(normalX + i), _mm256_sub_ps(cx, _mm256_loadu_ps(pointX + i))),
+                                                 _mm256_mul_ps(_mm256_loadu_ps(normalY + i), _mm256_sub_ps(cy, _mm256_loadu_ps(pointY + i)))),
+                                   _mm256_mul_ps(_mm256_loadu_ps(normalZ + i), _mm256_sub_ps(cz, _mm256_loadu_ps(pointZ + i))));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(dot, zero, _CMP_GT_OQ));
+        for (int k = 0; k < 8; ++k) visible[i + k] = (mask >> k) & 1;
+    }
+    scalarCullRange(normalX, normalY, normalZ, pointX, pointY, pointZ, i, count, cameraX, cameraY, cameraZ, visible);
+}
+
+template <bool Reverse>
+__attribute__((target("avx2")))
+inline void avx2FillSpan(uint32_t* pixels, float* depth, int xBegin, int count,
+                         float leftX, float leftW, float wStep, uint32_t color) {
+    __m256 vLeftX = _mm256_set1_ps(leftX), vLeftW = _mm256_set1_ps(leftW), vStep = _mm256_set1_ps(wStep), one = _mm256_set1_ps(1.0f);
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 vColor = _mm256_castsi256_ps(_mm256_set1_epi32((int)color));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(xBegin + i), lanes));
+        __m256 inverseW = _mm256_add_ps(vLeftW, _mm256_mul_ps(_mm256_sub_ps(x, vLeftX), vStep));
+        __m256 z = Reverse ? inverseW : _mm256_div_ps(one, inverseW);
+        __m256 old = _mm256_loadu_ps(depth + i);
+        __m256 closer = Reverse ? _mm256_cmp_ps(z, old, _CMP_GT_OQ) : _mm256_cmp_ps(z, old, _CMP_LT_OQ);
+        _mm256_storeu_ps(depth + i, _mm256_blendv_ps(old, z, closer));
+        __m256 pixel = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)(pixels + i)));
+        _mm256_storeu_si256((__m256i*)(pixels + i), _mm256_castps_si256(_mm256_blendv_ps(pixel, vColor, closer)));
+    }
+    scalarFillSpanRange<Reverse>(pixels, depth, xBegin, i, count, leftX, leftW, wStep, color);
+}
+
+__attribute__((target("avx2")))
+inline void avx2FillDepth(float* depth, size_t count, float value) {
+    __m256 v = _mm256_set1_ps(value);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) _mm256_storeu_ps(depth + i, v);
+    for (; i < count; ++i) depth[i] = value;
+}
+
+__attribute__((target("avx2")))
+inline void avx2RepackPixels(const uint32_t* source, uint32_t* target, size_t count,
+                             const SDL_PixelFormat* from, const SDL_PixelFormat* to) {
+    __m256i rMask = _mm256_set1_epi32((int)from->Rmask), gMask = _mm256_set1_epi32((int)from->Gmask);
+    __m256i bMask = _mm256_set1_epi32((int)from->Bmask), aMask = _mm256_set1_epi32((int)to->Amask);
+    __m128i rFrom = _mm_cvtsi32_si128(from->Rshift), gFrom = _mm_cvtsi32_si128(from->Gshift), bFrom = _mm_cvtsi32_si128(from->Bshift);
+    __m128i rTo = _mm_cvtsi32_si128(to->Rshift), gTo = _mm_cvtsi32_si128(to->Gshift), bTo = _mm_cvtsi32_si128(to->Bshift);
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i pixel = _mm256_loadu_si256((const __m256i*)(source + x));
+        __m256i r = _mm256_sll_epi32(_mm256_srl_epi32(_mm256_and_si256(pixel, rMask), rFrom), rTo);
+        __m256i g = _mm256_sll_epi32(_mm256_srl_epi32(_mm256_and_si256(pixel, gMask), gFrom), gTo);
+        __m256i b = _mm256_sll_epi32(_mm256_srl_epi32(_mm256_and_si256(pixel, bMask), bFrom), bTo);
+        _mm256_storeu_si256((__m256i*)(target + x), _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, aMask)));
+    }
+    scalarRepackRange(source, target, x, count, from, to);
+}
+
+// ---------------------------------------------------------------- AVX-512, 16 значений
+
+__attribute__((target("avx512f")))
+inline void avx512TransformPoints(const float* m, const float* const* in, float* const* out, size_t count) {
+    size_t j = 0;
+    for (; j + 16 <= count; j += 16) {
+        __m512 x = _mm512_loadu_ps(in[0] + j), y = _mm512_loadu_ps(in[1] + j);
+        __m512 z = _mm512_loadu_ps(in[2] + j), w = _mm512_loadu_ps(in[3] + j);
+        for (int i = 0; i < 4; ++i) {
+            __m512 sum = _mm512_add_ps(_mm512_setzero_ps(), _mm512_mul_ps(_mm512_set1_ps(m[i * 4 + 0]), x));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(m[i * 4 + 1]), y));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(m[i * 4 + 2]), z));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(m[i * 4 + 3]), w));
+            _mm512_storeu_ps(out[i] + j, sum);
+        }
+    }
+    scalarTransformRange(m, in, out, j, count);
+}
+
+__attribute__((target("avx512f")))
+inline void avx512ProjectPoints(const float* m, float halfWidth, float halfHeight,
+                                const float* x, const float* y, const float* z, size_t count,
+                                float* screenX, float* screenY, float* inverseW, float* clipW) {
+    __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1.0f);
+    __m512 hw = _mm512_set1_ps(halfWidth), hh = _mm512_set1_ps(halfHeight), nhh = _mm512_set1_ps(-halfHeight);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 vx = _mm512_loadu_ps(x + i), vy = _mm512_loadu_ps(y + i), vz = _mm512_loadu_ps(z + i);
+        __m512 cx = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(m[0]), vx), _mm512_mul_ps(_mm512_set1_ps(m[1]), vy)),
+                                                _mm512_mul_ps(_mm512_set1_ps(m[2]), vz)), _mm512_set1_ps(m[3]));
+        __m512 cy = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(m[4]), vx), _mm512_mul_ps(_mm512_set1_ps(m[5]), vy)),
+                                                _mm512_mul_ps(_mm512_set1_ps(m[6]), vz)), _mm512_set1_ps(m[7]));
+        __m512 w  = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(m[12]), vx), _mm512_mul_ps(_mm512_set1_ps(m[13]), vy)),
+                                                _mm512_mul_ps(_mm512_set1_ps(m[14]), vz)), _mm512_set1_ps(m[15]));
+        __mmask16 divide = _mm512_cmp_ps_mask(w, zero, _CMP_NEQ_UQ);
+        cx = _mm512_mask_div_ps(cx, divide, cx, w);
+        cy = _mm512_mask_div_ps(cy, divide, cy, w);
+        _mm512_storeu_ps(screenX + i, _mm512_add_ps(_mm512_mul_ps(hw, cx), hw));
+        _mm512_storeu_ps(screenY + i, _mm512_add_ps(_mm512_mul_ps(nhh, cy), hh));
+        _mm512_storeu_ps(inverseW + i, _mm512_div_ps(one, w));
+        _mm512_storeu_ps(clipW + i, w);
+    }
+    scalarProjectRange(m, halfWidth, halfHeight, x, y, z, i, count, screenX, screenY, inverseW, clipW);
+}
+
+__attribute__((target("avx512f")))
+inline void avx512CullBackFaces(const float* normalX, const float* normalY, const float* normalZ,
+                                const float* pointX, const float* pointY, const float* pointZ, size_t count,
+                                float cameraX, float cameraY, float cameraZ, uint8_t* visible) {
+    __m512 cx = _mm512_set1_ps(cameraX), cy = _mm512_set1_ps(cameraY), cz = _mm512_set1_ps(cameraZ), zero = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 dot = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(normalX + i), _mm512_sub_ps(cx, _mm512_loadu_ps(pointX + i))),
+                                                 _mm512_mul_ps(_mm512_loadu_ps(normalY + i), _mm512_sub_ps(cy, _mm512_loadu_ps(pointY + i)))),
+                                   _mm512_mul_ps(_mm512_loadu_ps(normalZ + i), _mm512_sub_ps(cz, _mm512_loadu_ps(pointZ + i))));
+        __mmask16 mask = _mm512_cmp_ps_mask(dot, zero, _CMP_GT_OQ);
+        for (int k = 0; k < 16; ++k) visible[i + k] = (mask >> k) & 1;
+    }
+    scalarCullRange(normalX, normalY, normalZ, pointX, pointY, pointZ, i, count, cameraX, cameraY, cameraZ, visible);
+}
+
+template <bool Reverse>
+__attribute__((target("avx512f")))
+inline void avx512FillSpan(uint32_t* pixels, float* depth, int xBegin, int count,
+                           float leftX, float leftW, float wStep, uint32_t color) {
+    __m512 vLeftX = _mm512_set1_ps(leftX), vLeftW = _mm512_set1_ps(leftW), vStep = _mm512_set1_ps(wStep), one = _mm512_set1_ps(1.0f);
+    __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i vColor = _mm512_set1_epi32((int)color);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 x = _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_set1_epi32(xBegin + i), lanes));
+        __m512 inverseW = _mm512_add_ps(vLeftW, _mm512_mul_ps(_mm512_sub_ps(x, vLeftX), vStep));
+        __m512 z = Reverse ? inverseW : _mm512_div_ps(one, inverseW);
+        __mmask16 closer = _mm512_cmp_ps_mask(z, _mm512_loadu_ps(depth + i), Reverse ? _CMP_GT_OQ : _CMP_LT_OQ);
+        _mm512_mask_storeu_ps(depth + i, closer, z);
+        _mm512_mask_storeu_epi32(pixels + i, closer, vColor);
+    }
+    // Хвост — маской, без скалярного цикла
+    if (i < count) {
+        __mmask16 tail = (__mmask16)((1u << (count - i)) - 1);
+        __m512 x = _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_set1_epi32(xBegin + i), lanes));
+        __m512 inverseW = _mm512_add_ps(vLeftW, _mm512_mul_ps(_mm512_sub_ps(x, vLeftX), vStep));
+        __m512 z = Reverse ? inverseW : _mm512_div_ps(one, inverseW);
+        __mmask16 closer = _mm512_mask_cmp_ps_mask(tail, z, _mm512_maskz_loadu_ps(tail, depth + i), Reverse ? _CMP_GT_OQ : _CMP_LT_OQ);
+        _mm512_mask_storeu_ps(depth + i, closer, z);
+        _mm512_mask_storeu_epi32(pixels + i, closer, vColor);
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void avx512FillDepth(float* depth, size_t count, float value) {
+    __m512 v = _mm512_set1_ps(value);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) _mm512_storeu_ps(depth + i, v);
+    if (i < count) _mm512_mask_storeu_ps(depth + i, (__mmask16)((1u << (count - i)) - 1), v);
+}
+
+__attribute__((target("avx512f")))
+inline void avx512RepackPixels(const uint32_t* source, uint32_t* target, size_t count,
+                               const SDL_PixelFormat* from, const SDL_PixelFormat* to) {
+    __m512i rMask = _mm512_set1_epi32((int)from->Rmask), gMask = _mm512_set1_epi32((int)from->Gmask);
+    __m512i bMask = _mm512_set1_epi32((int)from->Bmask), aMask = _mm512_set1_epi32((int)to->Amask);
+    __m128i rFrom = _mm_cvtsi32_si128(from->Rshift), gFrom = _mm_cvtsi32_si128(from->Gshift), bFrom = _mm_cvtsi32_si128(from->Bshift);
+    __m128i rTo = _mm_cvtsi32_si128(to->Rshift), gTo = _mm_cvtsi32_si128(to->Gshift), bTo = _mm_cvtsi32_si128(to->Bshift);
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m512i pixel = _mm512_loadu_si512(source + x);
+        __m512i r = _mm512_sll_epi32(_mm512_srl_epi32(_mm512_and_si512(pixel, rMask), rFrom), rTo);
+        __m512i g = _mm512_sll_epi32(_mm512_srl_epi32(_mm512_and_si512(pixel, gMask), gFrom), gTo);
+        __m512i b = _mm512_sll_epi32(_mm512_srl_epi32(_mm512_and_si512(pixel, bMask), bFrom), bTo);
+        _mm512_storeu_si512(target + x, _mm512_or_si512(_mm512_or_si512(r, g), _mm512_or_si512(b, aMask)));
+    }
+    scalarRepackRange(source, target, x, count, from, to);
+}
+
+#endif // SIMD_KERNELS_X86
+
+// Лучший вариант, который поддерживают процессор и ОС
+inline SimdLevel detectSimdLevel() {
+#ifdef SIMD_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SIMD_SSE41;
+#endif
+    return SIMD_SCALAR;
+}
+
+// Таблица ядер заданного варианта (без проверки поддержки — для сравнения вариантов в бенчмарках)
+inline const SimdKernels& simdKernelsFor(SimdLevel level) {
+    static const SimdKernels table[SIMD_LEVEL_COUNT] = {
+        { SIMD_SCALAR, "scalar", scalarTransformPoints, scalarProjectPoints, scalarCullBackFaces,
+          scalarFillSpan<false>, scalarFillSpan<true>, scalarFillDepth, scalarRepackPixels },
+#ifdef SIMD_KERNELS_X86
+        { SIMD_SSE41, "sse4.1", sse41TransformPoints, sse41ProjectPoints, sse41CullBackFaces,
+          sse41FillSpan<false>, sse41FillSpan<true>, sse41FillDepth, sse41RepackPixels },
+        { SIMD_AVX2, "avx2", avx2TransformPoints, avx2ProjectPoints, avx2CullBackFaces,
+          avx2FillSpan<false>, avx2FillSpan<true>, avx2FillDepth, avx2RepackPixels },
+        { SIMD_AVX512, "avx512", avx512TransformPoints, avx512ProjectPoints, avx512CullBackFaces,
+          avx512FillSpan<false>, avx512FillSpan<true>, avx512FillDepth, avx512RepackPixels },
+#else
+        { SIMD_SCALAR, "scalar", scalarTransformPoints, scalarProjectPoints, scalarCullBackFaces,
+          scalarFillSpan<false>, scalarFillSpan<true>, scalarFillDepth, scalarRepackPixels },
+        { SIMD_SCALAR, "scalar", scalarTransformPoints, scalarProjectPoints, scalarCullBackFaces,
+          scalarFillSpan<false>, scalarFillSpan<true>, scalarFillDepth, scalarRepackPixels },
+        { SIMD_SCALAR, "scalar", scalarTransformPoints, scalarProjectPoints, scalarCullBackFaces,
+          scalarFillSpan<false>, scalarFillSpan<true>, scalarFillDepth, scalarRepackPixels },
+#endif
+    };
+    return table[level < SIMD_LEVEL_COUNT ? level : SIMD_SCALAR];
+}
+
+// Вариант по имени из ENGINE_SIMD; false — имя неизвестно
+inline bool parseSimdLevel(const char* name, SimdLevel& level) {
+    if (!std::strcmp(name, "scalar")) level = SIMD_SCALAR;
+    else if (!std::strcmp(name, "sse4.1") || !std::strcmp(name, "sse41")) level = SIMD_SSE41;
+    else if (!std::strcmp(name, "avx2")) level = SIMD_AVX2;
+    else if (!std::strcmp(name, "avx512") || !std::strcmp(name, "avx512f")) level = SIMD_AVX512;
+    else return false;
+    return true;
+}
+
+inline const SimdKernels& selectSimdKernels() {
+    SimdLevel supported = detectSimdLevel();
+    SimdLevel level = supported;
+    if (const char* forced = SDL_getenv("ENGINE_SIMD")) {
+        SimdLevel requested;
+        if (!parseSimdLevel(forced, requested)) {
+            SDL_Log("ENGINE_SIMD=%s: unknown variant, using %s", forced, simdKernelsFor(supported).name);
+        } else if (requested > supported) {
+            SDL_Log("ENGINE_SIMD=%s: not supported by this CPU, using %s", forced, simdKernelsFor(supported).name);
+        } else {
+            level = requested;
+        }
+    }
+    return simdKernelsFor(level);
+}
+
+// Ядра, выбранные для этого процесса (определяются при первом вызове)
+inline const SimdKernels& simdKernels() {
+    static const SimdKernels& kernels = selectSimdKernels();
+    return kernels;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC pop_options
+#endif
+
+#endif // _SIMD_KERNELS_HPP_
@@ -0,0 +1,143 @@
+#ifndef _STRESS_SCENE_HPP_
+#define _STRESS_SCENE_HPP_
+
+#include "Scene3D.hpp"
+#include "Model3D.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Нагрузочные сцены для замеров масштабирования: число треугольников, площадь на экране и
+// глубина перекрытия задаются строкой вида "вид:параметры". Сцена умещается в куб со стороной 4
+// с центром в начале координат, то есть целиком видна камерой по умолчанию.
+//
+//   cubes:NxMxK                  решётка из N x M x K кубов, отдельная модель на каждый
+//   uvsphere:RINGSxSEGMENTS[:NxMxK]  сферы по широте и долготе (Model3D::createSphere)
+//   icosphere:LEVEL[:NxMxK]      сферы из икосаэдра, 20 * 4^LEVEL треугольников каждая
+//   soup:COUNT[:MIN-MAX]         COUNT отдельных треугольников со стороной от MIN до MAX (по умолчанию 0.05-0.2)
+//   stack:LAYERS[:SIZE]          LAYERS квадратов со стороной SIZE (по умолчанию 2) друг за другом по глубине
+enum StressKind {
+    STRESS_CUBES,
+    STRESS_UV_SPHERES,
+    STRESS_ICOSPHERES,
+    STRESS_SOUP,
+    STRESS_STACK
+};
+
+struct StressSceneSpec {
+    StressKind kind = STRESS_CUBES;
+    int gridX = 1, gridY = 1, gridZ = 1;   // Решётка моделей (кубы и сферы)
+    int rings = 16, segments = 32;         // uvsphere
+    int level = 2;                         // icosphere
+    int count = 1000;                      // soup: треугольников; stack: слоёв
+    float minSize = 0.05f, maxSize = 0.2f; // soup: сторона треугольника
+    float size = 2.0f;                     // stack: сторона квадрата
+};
+
+// Что получилось в сцене
+struct StressSceneInfo {
+    size_t models = 0;
+    size_t triangles = 0;
+};
+
+// Разбор строки вида "вид:параметры"; false и описание в error — строка не разобрана
+inline bool parseStressSceneSpec(const char* text, StressSceneSpec& spec, std::string& error) {
+    spec = StressSceneSpec();
+    std::string kind = text;
+    const char* params = "";
+    size_t colon = kind.find(':');
+    if (colon != std::string::npos) {
+        params = text + colon + 1;
+        kind.resize(colon);
+    }
+    // Необязательная решётка после второго двоеточия
+    auto parseGrid = [&](const char* grid) {
+        return !*grid || (sscanf(grid, ":%dx%dx%d", &spec.gridX, &spec.gridY, &spec.gridZ) == 3
+                          && spec.gridX > 0 && spec.gridY > 0 && spec.gridZ > 0);
+    };
+    int used = 0;
+    bool ok = false;
+    if (kind == "cubes") {
+        spec.kind = STRESS_CUBES;
+        ok = sscanf(params, "%dx%dx%d%n", &spec.gridX, &spec.gridY, &spec.gridZ, &used) == 3 && !params[used]
+             && spec.gridX > 0 && spec.gridY > 0 && spec.gridZ > 0;
+    } else if (kind == "uvsphere") {
+        spec.kind = STRESS_UV_SPHERES;
+        ok = sscanf(params, "%dx%d%n", &spec.rings, &spec.segments, &used) == 2 && parseGrid(params + used)
+             && spec.rings >= 2 && spec.segments >= 3;
+    } else if (kind == "icosphere") {
+        spec.kind = STRESS_ICOSPHERES;
+        ok = sscanf(params, "%d%n", &spec.level, &used) == 1 && parseGrid(params + used)
+             && spec.level >= 0 && spec.level <= 7;
+    } else if (kind == "soup") {
+        spec.kind = STRESS_SOUP;
+        ok = sscanf(params, "%d%n", &spec.count, &used) == 1 && spec.count > 0;
+        if (ok && params[used]) {
+            int sizeUsed = 0;
+            ok = sscanf(params + used, ":%f-%f%n", &spec.minSize, &spec.maxSize, &sizeUsed) == 2
+                 && !params[used + sizeUsed] && spec.minSize > 0.0f && spec.maxSize >= spec.minSize;
+        }
+    } else if (kind == "stack") {
+        spec.kind = STRESS_STACK;
+        ok = sscanf(params, "%d%n", &spec.count, &used) == 1 && spec.count > 0;
+        if (ok && params[used]) {
+            int sizeUsed = 0;
+            ok = sscanf(params + used, ":%f%n", &spec.size, &sizeUsed) == 1 && !params[used + sizeUsed] && spec.size > 0.0f;
+        }
+    } else {
+        error = std::string("unknown stress scene ") + text + " (cubes, uvsphere, icosphere, soup, stack)";
+        return false;
+    }
+    if (!ok) error = std::string("bad stress scene parameters ") + text;
+    return ok;
+}
+
+// Наполнение scene моделями нагрузочной сцены. Освещение, камера и режимы сцены не меняются.
+inline StressSceneInfo buildStressScene(Scene3D& scene, const StressSceneSpec& spec) {
+    StressSceneInfo info;
+    auto add = [&](std::shared_ptr<Model3D> model) {
+        info.models++;
+        info.triangles += model->getPolygonCount();
+        scene.addModel(model);
+    };
+    // Модели решётки в ячейках одинакового размера; create получает сторону ячейки
+    auto grid = [&](const std::function<std::shared_ptr<Model3D>(float)>& create) {
+        float cell = 4.0f / std::max(spec.gridX, std::max(spec.gridY, spec.gridZ));
+        for (int z = 0; z < spec.gridZ; ++z) {
+            for (int y = 0; y < spec.gridY; ++y) {
+                for (int x = 0; x < spec.gridX; ++x) {
+                    auto model = create(cell);
+                    model->translate((x - (spec.gridX - 1) * 0.5f) * cell, (y - (spec.gridY - 1) * 0.5f) * cell,
+                                     -(z - (spec.gridZ - 1) * 0.5f) * cell);
+                    add(model);
+                }
+            }
+        }
+    };
+
+    switch (spec.kind) {
+        case STRESS_CUBES:
+            grid([](float cell) { return Model3D::createCube(cell * 0.6f); });
+            break;
+        case STRESS_UV_SPHERES:
+            grid([&](float cell) { return Model3D::createSphere(cell * 0.4f, spec.rings, spec.segments); });
+            break;
+        case STRESS_ICOSPHERES:
+            grid([&](float cell) { return Model3D::createIcosphere(cell * 0.4f, spec.level); });
+            break;
+        case STRESS_SOUP:
+            add(Model3D::createTriangleSoup(spec.count, 4.0f, spec.minSize, spec.maxSize));
+            break;
+        case STRESS_STACK:
+            add(Model3D::createQuadStack(spec.count, spec.size, 2.0f));
+            break;
+    }
+    return info;
+}
+
+#endif // _STRESS_SCENE_HPP_
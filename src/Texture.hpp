@@ -0,0 +1,240 @@
+#ifndef _TEXTURE_HPP_
+#define _TEXTURE_HPP_
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Выборка текселя при наложении текстуры
+enum TextureFilter {
+    TEXTURE_NEAREST,   // Ближайший тексель
+    TEXTURE_BILINEAR   // Смесь четырёх соседних текселей
+};
+
+// Целая часть координаты текселя без вызова floor: сдвиг делает значение положительным,
+// а приведение к int отбрасывает дробь. Точно для value > -TEXEL_FLOOR_BIAS.
+static const int TEXEL_FLOOR_BIAS = 1024;
+
+inline int texelFloor(float value) {
+    return (int)(value + (float)TEXEL_FLOOR_BIAS) - TEXEL_FLOOR_BIAS;
+}
+
+// Один уровень mip-цепочки. Стороны — степени двойки, координаты за пределами повторяются (маской).
+//
+// Тексели лежат в порядке Мортона: биты x и y чередуются, поэтому соседи по обеим осям
+// почти всегда в одной или соседней кэш-линии, в каком бы направлении ни шла строка растеризации.
+// Индекс текселя (x, y) — columnOffsets[x] | rowOffsets[y]: у каждой координаты своя таблица разнесённых битов.
+// У вытянутого уровня чередуются только младшие биты, старшие биты длинной стороны идут выше них.
+struct TextureLevel {
+    int width, height;
+    int widthMask, heightMask;
+    std::vector<uint32_t> texels;          // 0xRRGGBB
+    std::vector<uint32_t> columnOffsets;   // Часть индекса от x
+    std::vector<uint32_t> rowOffsets;      // Часть индекса от y
+
+    // Биты value в чётные разряды (0, 2, 4, ...) для младших shared битов, остальные — подряд начиная с 2 * shared
+    static uint32_t spreadBits(uint32_t value, int shared) {
+        uint32_t result = 0;
+        for (int bit = 0; bit < shared; ++bit) {
+            result |= ((value >> bit) & 1u) << (2 * bit);
+        }
+        return result | ((value >> shared) << (2 * shared));
+    }
+
+    // Уровень из пикселей, лежащих по строкам
+    void assign(int levelWidth, int levelHeight, const std::vector<uint32_t>& rows) {
+        width = levelWidth;
+        height = levelHeight;
+        widthMask = width - 1;
+        heightMask = height - 1;
+
+        int shared = 0;
+        while ((1 << (shared + 1)) <= std::min(width, height)) shared++;
+        // x занимает чётные разряды (и старшие, если уровень шире), y — нечётные (и старшие, если выше)
+        columnOffsets.resize(width);
+        rowOffsets.resize(height);
+        for (int x = 0; x < width; ++x) columnOffsets[x] = spreadBits(x, shared);
+        for (int y = 0; y < height; ++y) {
+            uint32_t low = y & ((1 << shared) - 1);
+            rowOffsets[y] = (spreadBits(low, shared) << 1) | ((uint32_t)(y >> shared) << (2 * shared));
+        }
+
+        texels.resize((size_t)width * height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                texels[columnOffsets[x] | rowOffsets[y]] = rows[(size_t)y * width + x];
+            }
+        }
+    }
+
+    uint32_t fetch(int x, int y) const {
+        return texels[columnOffsets[x & widthMask] | rowOffsets[y & heightMask]];
+    }
+
+    // Координаты в текселях этого уровня; центр текселя (x, y) — точка (x + 0.5, y + 0.5)
+    template <TextureFilter Filter>
+    uint32_t sample(float u, float v) const {
+        if (Filter == TEXTURE_NEAREST) {
+            return fetch(texelFloor(u), texelFloor(v));
+        }
+        // Координаты с 8 битами дроби одним преобразованием: целая часть — номер текселя, дробь — вес соседа
+        int fixedU = (int)((u - 0.5f + TEXEL_FLOOR_BIAS) * 256.0f) - TEXEL_FLOOR_BIAS * 256;
+        int fixedV = (int)((v - 0.5f + TEXEL_FLOOR_BIAS) * 256.0f) - TEXEL_FLOOR_BIAS * 256;
+        int x = fixedU >> 8, y = fixedV >> 8;
+        uint32_t fx = fixedU & 0xFF, fy = fixedV & 0xFF;
+        // Части индексов двух столбцов и двух строк берутся из таблиц один раз на четыре текселя
+        uint32_t column0 = columnOffsets[x & widthMask], column1 = columnOffsets[(x + 1) & widthMask];
+        uint32_t row0 = rowOffsets[y & heightMask], row1 = rowOffsets[(y + 1) & heightMask];
+        uint32_t t00 = texels[column0 | row0], t10 = texels[column1 | row0];
+        uint32_t t01 = texels[column0 | row1], t11 = texels[column1 | row1];
+
+        // Веса четырёх текселей в 1/256, в сумме 256. Каналы R и B смешиваются вместе в одном слове:
+        // между ними 8 свободных битов, которых хватает на множитель до 256.
+        uint32_t w11 = (fx * fy) >> 8, w10 = fx - w11, w01 = fy - w11, w00 = 256 - fx - fy + w11;
+        uint32_t redBlue = ((t00 & 0xFF00FF) * w00 + (t10 & 0xFF00FF) * w10 + (t01 & 0xFF00FF) * w01 + (t11 & 0xFF00FF) * w11) >> 8;
+        uint32_t green = ((t00 & 0x00FF00) * w00 + (t10 & 0x00FF00) * w10 + (t01 & 0x00FF00) * w01 + (t11 & 0x00FF00) * w11) >> 8;
+        return (redBlue & 0xFF00FF) | (green & 0x00FF00);
+    }
+};
+
+// Текстура с полной mip-цепочкой до уровня 1×1.
+// Размер приводится к степеням двойки, уровни строятся усреднением блоков 2×2 предыдущего.
+class Texture {
+private:
+    std::vector<TextureLevel> levels;
+
+    static int powerOfTwoAtLeast(int value) {
+        int result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+    // Среднее по каналам четырёх пикселей
+    static uint32_t average(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+        uint32_t red = ((a >> 16 & 0xFF) + (b >> 16 & 0xFF) + (c >> 16 & 0xFF) + (d >> 16 & 0xFF) + 2) >> 2;
+        uint32_t green = ((a >> 8 & 0xFF) + (b >> 8 & 0xFF) + (c >> 8 & 0xFF) + (d >> 8 & 0xFF) + 2) >> 2;
+        uint32_t blue = ((a & 0xFF) + (b & 0xFF) + (c & 0xFF) + (d & 0xFF) + 2) >> 2;
+        return (red << 16) | (green << 8) | blue;
+    }
+
+public:
+    // pixels — width × height значений 0xRRGGBB по строкам. Стороны, не равные степени двойки,
+    // растягиваются до ближайшей большей степени выборкой ближайшего пикселя.
+    Texture(int width, int height, const uint32_t* pixels) {
+        int levelWidth = powerOfTwoAtLeast(std::max(width, 1));
+        int levelHeight = powerOfTwoAtLeast(std::max(height, 1));
+        std::vector<uint32_t> rows((size_t)levelWidth * levelHeight);
+        for (int y = 0; y < levelHeight; ++y) {
+            int sourceY = (int)((int64_t)y * height / levelHeight);
+            for (int x = 0; x < levelWidth; ++x) {
+                int sourceX = (int)((int64_t)x * width / levelWidth);
+                rows[(size_t)y * levelWidth + x] = pixels[(size_t)sourceY * width + sourceX];
+            }
+        }
+
+        while (true) {
+            levels.emplace_back();
+            levels.back().assign(levelWidth, levelHeight, rows);
+            if (levelWidth == 1 && levelHeight == 1) break;
+
+            int nextWidth = std::max(levelWidth / 2, 1), nextHeight = std::max(levelHeight / 2, 1);
+            std::vector<uint32_t> next((size_t)nextWidth * nextHeight);
+            for (int y = 0; y < nextHeight; ++y) {
+                int y0 = std::min(2 * y, levelHeight - 1), y1 = std::min(2 * y + 1, levelHeight - 1);
+                for (int x = 0; x < nextWidth; ++x) {
+                    int x0 = std::min(2 * x, levelWidth - 1), x1 = std::min(2 * x + 1, levelWidth - 1);
+                    next[(size_t)y * nextWidth + x] = average(rows[(size_t)y0 * levelWidth + x0], rows[(size_t)y0 * levelWidth + x1],
+                                                              rows[(size_t)y1 * levelWidth + x0], rows[(size_t)y1 * levelWidth + x1]);
+                }
+            }
+            rows.swap(next);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+        }
+    }
+
+    // Текстура из поверхности SDL любого формата; nullptr, если преобразовать не удалось
+    static std::shared_ptr<Texture> fromSurface(SDL_Surface* surface) {
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB888, 0);
+        if (!converted) {
+            SDL_Log("Texture: %s", SDL_GetError());
+            return nullptr;
+        }
+        std::vector<uint32_t> pixels((size_t)converted->w * converted->h);
+        for (int y = 0; y < converted->h; ++y) {
+            const uint32_t* row = (const uint32_t*)((const uint8_t*)converted->pixels + y * converted->pitch);
+            for (int x = 0; x < converted->w; ++x) {
+                pixels[(size_t)y * converted->w + x] = row[x] & 0xFFFFFF;
+            }
+        }
+        auto texture = std::make_shared<Texture>(converted->w, converted->h, pixels.data());
+        SDL_FreeSurface(converted);
+        return texture;
+    }
+
+    // Текстура из файла BMP; nullptr, если файл не прочитан
+    static std::shared_ptr<Texture> loadBMP(const char* path) {
+        SDL_Surface* surface = SDL_LoadBMP(path);
+        if (!surface) {
+            SDL_Log("Texture %s: %s", path, SDL_GetError());
+            return nullptr;
+        }
+        auto texture = fromSurface(surface);
+        SDL_FreeSurface(surface);
+        return texture;
+    }
+
+    // Шахматная доска size × size из cells × cells клеток цветов first и second
+    static std::shared_ptr<Texture> checkerboard(int size, int cells, uint32_t first, uint32_t second) {
+        std::vector<uint32_t> pixels((size_t)size * size);
+        int cell = std::max(size / cells, 1);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                pixels[(size_t)y * size + x] = ((x / cell + y / cell) & 1) ? second : first;
+            }
+        }
+        return std::make_shared<Texture>(size, size, pixels.data());
+    }
+
+    int getWidth() const { return levels[0].width; }
+    int getHeight() const { return levels[0].height; }
+    size_t getLevelCount() const { return levels.size(); }
+    const TextureLevel& getLevel(size_t index) const { return levels[index]; }
+
+    // Уровень для треугольника: uvArea — площадь в текстурных координатах (0..1 на всю текстуру),
+    // screenArea — площадь на экране в пикселях. На уровне L на пиксель приходится около одного текселя.
+    size_t selectLevel(float uvArea, float screenArea) const {
+        float texelArea = uvArea * levels[0].width * levels[0].height;
+        if (!(texelArea > screenArea) || !(screenArea > 0.0f)) return 0;
+        float level = 0.5f * std::log2(texelArea / screenArea);
+        return std::min((size_t)(level + 0.5f), levels.size() - 1);
+    }
+};
+
+// Цвет пикселя текстурированного треугольника: values[0], values[1] — интерполированные u / w, v / w
+// в текселях уровня level, w — глубина пикселя. При Lit values[2..4] — освещённость каналов 0..255 (как у
+// GouraudShader), на неё умножается цвет текселя.
+template <TextureFilter Filter, bool Lit>
+struct TextureShader {
+    const TextureLevel* level;
+
+    uint32_t operator()(const float* values, float w) const {
+        uint32_t texel = level->sample<Filter>(values[0] * w, values[1] * w);
+        if (!Lit) return texel;
+        uint32_t red = modulate(texel >> 16 & 0xFF, values[2] * w);
+        uint32_t green = modulate(texel >> 8 & 0xFF, values[3] * w);
+        uint32_t blue = modulate(texel & 0xFF, values[4] * w);
+        return (red << 16) | (green << 8) | blue;
+    }
+
+    static uint32_t modulate(uint32_t channel, float light) {
+        uint32_t scale = (uint32_t)std::min(256.0f, std::max(0.0f, light + 1.0f));
+        return (channel * scale) >> 8;
+    }
+};
+
+#endif // _TEXTURE_HPP_
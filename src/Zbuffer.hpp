@@ -7,32 +7,51 @@
 #include <iostream>
 
 #include <vector>
+#include <algorithm>
+
+#include "SimdKernels.hpp"
+
+// Что хранится в буфере глубины
+enum DepthEncoding {
+    DEPTH_VIEW_W,     // w отсечения (глубина вдоль взгляда): ближе — меньше, пустой пиксель — FLT_MAX.
+                      // Растеризатор интерполирует 1 / w и обращает его на каждом пикселе.
+    DEPTH_REVERSE_Z   // Само интерполированное 1 / w: ближе — больше, пустой пиксель — 0 (бесконечность).
+                      // Деления на пиксель нет, дальней плоскости отсечения нет.
+};
 
 class Zbuffer {
     size_t width;
     size_t heigth;
-    std::vector<std::vector<float>> buffer;
+    DepthEncoding encoding;
+    // Значения хранятся построчно одним блоком: buffer[y * width + x]
+    std::vector<float> buffer;
 
     public:
 
-    Zbuffer(size_t _width, size_t _heigth) {
-        width = _width;
-        heigth = _heigth;
-        std::vector<float> buf_row(heigth, std::numeric_limits<float>::max());
-        for(size_t i = 0; i < width; i++) {
-            buffer.push_back(buf_row);
-        }
+    Zbuffer(size_t _width, size_t _heigth) : encoding(DEPTH_VIEW_W) {
+        make_matrix(_width, _heigth);
     };
 
+    // Значение пустого пикселя: дальше любой глубины
+    static float farValue(DepthEncoding encoding) {
+        return encoding == DEPTH_REVERSE_Z ? 0.0f : std::numeric_limits<float>::max();
+    }
+
+    // Изменение размера с очисткой
     void make_matrix(size_t _w, size_t _h) {
         width = _w;
         heigth = _h;
-        std::vector<std::vector<float>> tmp_buffer;
-        std::vector<float> buf_row(width, std::numeric_limits<float>::max());
-        for(size_t i = 0; i < heigth; i++) {
-            buffer.push_back(buf_row);
-        }
-        buffer = tmp_buffer;
+        buffer.assign(width * heigth, farValue(encoding));
+    }
+
+    DepthEncoding getEncoding() const {
+        return encoding;
+    }
+
+    // Смена хранимой величины с очисткой: старые значения в новой кодировке не имеют смысла
+    void setEncoding(DepthEncoding value) {
+        encoding = value;
+        clear();
     }
 
     size_t getWidth() {
@@ -44,19 +63,34 @@ class Zbuffer {
     }
 
     void clear() {
-        for(size_t x = 0; x < width; x++) {
-            for(size_t y = 0; y < heigth; y++) {
-                buffer[x][y] = std::numeric_limits<float>::max();
-            }
+        simdKernels().fillDepth(buffer.data(), buffer.size(), farValue(encoding));
+    }
+
+    // Очистка строк [yBegin, yEnd)
+    void clearRows(size_t yBegin, size_t yEnd) {
+        simdKernels().fillDepth(buffer.data() + yBegin * width, (yEnd - yBegin) * width, farValue(encoding));
+    }
+
+    // Очистка прямоугольника [x, x + w) x [y, y + h)
+    void clearRect(size_t x, size_t y, size_t w, size_t h) {
+        const SimdKernels& kernels = simdKernels();
+        float value = farValue(encoding);
+        for (size_t row = y; row < y + h; ++row) {
+            kernels.fillDepth(buffer.data() + row * width + x, w, value);
         }
     }
 
+    // Начало строки y для построчного копирования
+    float* getRow(size_t y) {
+        return &buffer[y * width];
+    }
+
     void setValue(size_t x, size_t y, float value) {
-        buffer[x][y] = value;
+        buffer[y * width + x] = value;
     }
 
     float getValue(size_t x, size_t y) {
-        return buffer[x][y];
+        return buffer[y * width + x];
     }
 
 };
@@ -1,8 +1,21 @@
 #include <SDL2/SDL.h>
 #include "Scene3D.hpp"
+#include "RenderThread.hpp"
+#include "Headless.hpp"
+#include "InputMapper.hpp"
+#include "InputRecording.hpp"
+#include "StressScene.hpp"
+#include "AllocationHooks.hpp"
 #include <cmath>
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
 
 #include "RotationAngle.hpp"
 
@@ -11,7 +24,172 @@ bool debug = false;
 const int SCREEN_WIDTH = 1920;
 const int SCREEN_HEIGHT = 1024;
 
+// Настройки сцены из переменных окружения и освещение; общие для всех сцен
+static void configureScene(Scene3D& scene) {
+    // Число рабочих потоков рендера (по умолчанию — ядра минус один)
+    if (const char* workers = SDL_getenv("ENGINE_WORKERS")) {
+        scene.setWorkerCount((unsigned)std::max(0, atoi(workers)));
+    }
+    // ENGINE_DIRECT=0 — рисовать в собственный буфер сцены и копировать кадр, даже если формат окна подходит
+    if (const char* direct = SDL_getenv("ENGINE_DIRECT")) {
+        scene.setDirectRendering(atoi(direct) != 0);
+    }
+    // ENGINE_REVERSE_Z=1 — обратная глубина 1 / w без деления на пиксель вместо w
+    if (const char* reverseZ = SDL_getenv("ENGINE_REVERSE_Z")) {
+        scene.setDepthEncoding(atoi(reverseZ) != 0 ? DEPTH_REVERSE_Z : DEPTH_VIEW_W);
+    }
+    // Счётчики пикселей для панели производительности; растеризация с ними медленнее
+    if (const char* rasterStats = SDL_getenv("ENGINE_RASTER_STATS")) {
+        scene.setRasterStatsEnabled(atoi(rasterStats) != 0);
+    }
+
+    // Освещение: направленный свет сверху-спереди и тёплый точечный справа. По умолчанию сцена
+    // не освещена; L переключает режим, ENGINE_SHADING=flat|gouraud включает его с первого кадра.
+    scene.getLighting().addLight(Light::directional(Position3D(-0.3f, -1.0f, -0.6f), { 0.8f, 0.8f, 0.75f }));
+    scene.getLighting().addLight(Light::point(Position3D(2.0f, 1.5f, 2.0f), { 0.9f, 0.6f, 0.3f }, 0.1f));
+    if (const char* shading = SDL_getenv("ENGINE_SHADING")) {
+        if (strcmp(shading, "flat") == 0) {
+            scene.setShadingMode(SHADING_FLAT);
+        } else if (strcmp(shading, "gouraud") == 0) {
+            scene.setShadingMode(SHADING_GOURAUD);
+        } else if (strcmp(shading, "none") != 0) {
+            SDL_Log("ENGINE_SHADING=%s: unknown mode, using none", shading);
+        }
+    }
+}
+
+// Демонстрационные модели. Общие для окна и пакетного режима; возвращает куб, которым управляет пользователь.
+static std::shared_ptr<Model3D> setupScene(Scene3D& scene) {
+    configureScene(scene);
+
+    // Создаем куб
+    auto cube = Model3D::createCube(0.5f);
+    auto triangle = Model3D::createTriangle(0.5f);
+    
+    triangle->translate(1.0f, 0.0f, 0.0f);
+    cube->translate(0.0f, 0.0f, 0.0f);  // Отодвигаем куб от камеры
+
+    // Текстура куба: файл BMP из ENGINE_TEXTURE или шахматная доска; F переключает фильтрацию
+    std::shared_ptr<Texture> cubeTexture;
+    if (const char* texturePath = SDL_getenv("ENGINE_TEXTURE")) {
+        cubeTexture = Texture::loadBMP(texturePath);
+    }
+    if (!cubeTexture) {
+        cubeTexture = Texture::checkerboard(256, 8, 0xE0E0E0, 0x3060C0);
+    }
+    cube->setTexture(cubeTexture);
+    scene.addModel(cube);
+    scene.addModel(triangle);
+    return cube;
+}
+
+// Трасса этапов кадров для chrome://tracing: ENGINE_TRACE=trace.json в сборке с PROFILE=1
+static void writeTrace() {
+    const char* path = SDL_getenv("ENGINE_TRACE");
+    if (!path) return;
+    if (!Profiler::compiledIn()) {
+        fprintf(stderr, "ENGINE_TRACE: profiling is compiled out, build with PROFILE=1\n");
+    } else if (!Profiler::instance().writeChromeTrace(path)) {
+        fprintf(stderr, "ENGINE_TRACE: cannot write %s\n", path);
+    }
+}
+
+// Пакетный режим: куб вращается вокруг своего центра, как при перетаскивании мышью
+static int runBatch(const HeadlessOptions& options) {
+    Scene3D scene(options.width, options.height);
+    std::shared_ptr<Model3D> cube = setupScene(scene);
+    int status = runHeadless(scene, options, [&](int frame) {
+        if (frame == 0) return;
+        Position3D center = cube->getPosition();
+        cube->translate(-center.getX(), -center.getY(), -center.getZ());
+        cube->rotateY(0.05f);
+        cube->rotateX(0.03f);
+        cube->translate(center.getX(), center.getY(), center.getZ());
+    });
+    writeTrace();
+    return status;
+}
+
+// Нагрузочная сцена (--scene): камера каждый кадр слегка поворачивается туда и обратно,
+// поэтому кадр перерисовывается целиком, а изображение почти не меняется
+static int runStress(const HeadlessOptions& options) {
+    StressSceneSpec spec;
+    std::string error;
+    if (!parseStressSceneSpec(options.scene.c_str(), spec, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    Scene3D scene(options.width, options.height);
+    configureScene(scene);
+    uint64_t buildStart = JobSystem::nowNs();
+    StressSceneInfo info = buildStressScene(scene, spec);
+    fprintf(stderr, "scene %s: %zu models, %zu triangles, built in %.1f ms\n", options.scene.c_str(), info.models,
+            info.triangles, (JobSystem::nowNs() - buildStart) / 1e6);
+
+    float angle = 0.002f;
+    int status = runHeadless(scene, options, [&](int frame) {
+        if (frame == 0) return;
+        angle = -angle;
+        scene.getCamera().rotate(angle, 0.0f);
+    });
+    writeTrace();
+    return status;
+}
+
+// Воспроизведение записи ввода окна (--replay): та же сцена, размер окна из записи,
+// кадр на каждые 1/60 секунды записи. С --realtime кадры идут в темпе записи.
+static int runReplay(HeadlessOptions options) {
+    InputRecording recording;
+    std::string error;
+    if (!recording.load(options.replay.c_str(), error)) {
+        fprintf(stderr, "replay: %s\n", error.c_str());
+        return 1;
+    }
+    options.width = recording.width;
+    options.height = recording.height;
+
+    Scene3D scene(options.width, options.height);
+    std::shared_ptr<Model3D> cube = setupScene(scene);
+    InputReplay replay(scene, recording);
+    replay.select(cube);
+    options.frames = replay.getFrameCount();
+    fprintf(stderr, "replay: %zu events, %.2f s, %d frames\n", recording.events.size(),
+            recording.getDurationNs() / 1e9, options.frames);
+
+    uint64_t startNs = JobSystem::nowNs();
+    int status = runHeadless(scene, options, [&](int frame) {
+        if (options.realtime) {
+            uint64_t frameStart = startNs + (uint64_t)frame * replay.getFrameNs();
+            uint64_t now = JobSystem::nowNs();
+            if (frameStart > now) std::this_thread::sleep_for(std::chrono::nanoseconds(frameStart - now));
+        }
+        replay.advance(frame);
+    });
+    writeTrace();
+    return status;
+}
+
 int main(int argc, char** args) {
+    PROFILE_THREAD("main", -1);
+
+    // --headless: отрисовка кадров без окна (см. Headless.hpp); прочие аргументы окну не нужны
+    HeadlessOptions headless;
+    std::string optionsError;
+    if (parseHeadlessOptions(argc, args, headless, optionsError)) {
+        if (!optionsError.empty()) {
+            fprintf(stderr, "%s\n", optionsError.c_str());
+            return 2;
+        }
+        if (!headless.replay.empty()) return runReplay(headless);
+        return headless.scene.empty() ? runBatch(headless) : runStress(headless);
+    }
+
+    // --record PATH: запись событий ввода окна для воспроизведения (--headless --replay PATH)
+    const char* recordPath = nullptr;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(args[i], "--record") == 0) recordPath = args[i + 1];
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         return 1;
     }
@@ -37,194 +215,94 @@ int main(int argc, char** args) {
 
     // Создаем и инициализируем сцену
     Scene3D scene(SCREEN_WIDTH, SCREEN_HEIGHT);
+    std::shared_ptr<Model3D> cube = setupScene(scene);
 
-    // Создаем куб
-    auto cube = Model3D::createCube(0.5f);
-    auto triangle = Model3D::createTriangle(0.5f);
-    
-    triangle->translate(1.0f, 0.0f, 0.0f);
-    cube->translate(0.0f, 0.0f, 0.0f);  // Отодвигаем куб от камеры
-    scene.addModel(cube);
-    scene.addModel(triangle);
+    // Сценой владеет поток отрисовки; цикл событий только передаёт ему команды
+    RenderThread renderer(scene, surface->format->format);
+    // Модель, которой управляет пользователь; выбирается щелчком ЛКМ
+    renderer.setSelected(cube);
 
-    // Initial draw
-    scene.render(surface);
-    SDL_UpdateWindowSurface(window);
+    // Период кадра: частота обновления дисплея, ограниченная ENGINE_MAX_FPS
+    SDL_DisplayMode displayMode;
+    double displayRate = 0.0;
+    if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &displayMode) == 0) {
+        displayRate = displayMode.refresh_rate;
+    }
+    double maxFps = 0.0;
+    if (const char* fps = SDL_getenv("ENGINE_MAX_FPS")) {
+        maxFps = atof(fps);
+    }
+    renderer.getScheduler().setRate(displayRate, maxFps);
+    renderer.start();
+
+    InputMapper input;
+    InputRecorder recorder;
+    if (recordPath) {
+        int windowWidth, windowHeight;
+        SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+        if (!recorder.open(recordPath, windowWidth, windowHeight, JobSystem::nowNs())) {
+            fprintf(stderr, "record: cannot write %s\n", recordPath);
+        }
+    }
 
     SDL_Event e;
     bool quit = false;
-    bool isLeftDragging = false;   // Для вращения куба
-    bool isRightDragging = false;  // Для управления камерой
-    bool isShiftPressed = false;
-    int lastMouseX = 0, lastMouseY = 0;
+    const Uint32 STATS_INTERVAL_MS = 1000;
+    Uint64 statsStart = SDL_GetPerformanceCounter();
+    Uint64 waitTicks = 0;  // Время, проведённое основным потоком в ожидании событий
 
     while (!quit) {
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) {
-                quit = true;
-            }
-            else if (e.type == SDL_WINDOWEVENT) {
-                if (e.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    surface = SDL_GetWindowSurface(window);
-                    int newWidth, newHeight;
-                    SDL_GetWindowSize(window, &newWidth, &newHeight);
-                    scene.resize(newWidth, newHeight);
-                    scene.render(surface);
-                    SDL_UpdateWindowSurface(window);
-                }
-            }
-            else if (e.type == SDL_MOUSEBUTTONDOWN) {
-                if (e.button.button == SDL_BUTTON_LEFT) {
-                    isLeftDragging = true;
-                    lastMouseX = e.button.x;
-                    lastMouseY = e.button.y;
-                }
-                else if (e.button.button == SDL_BUTTON_RIGHT) {
-                    isRightDragging = true;
-                    lastMouseX = e.button.x;
-                    lastMouseY = e.button.y;
-                }
-            }
-            else if (e.type == SDL_MOUSEBUTTONUP) {
-                if (e.button.button == SDL_BUTTON_LEFT) {
-                    isLeftDragging = false;
-                }
-                else if (e.button.button == SDL_BUTTON_RIGHT) {
-                    isRightDragging = false;
-                }
-            }
-            else if (e.type == SDL_MOUSEMOTION) {
-                int deltaX = e.motion.x - lastMouseX;
-                int deltaY = e.motion.y - lastMouseY;
-
-                if (isLeftDragging) {
-                    if(isShiftPressed) {
-                        if(!debug) { 
-                            cube->RotateOverEdge(2, 3, deltaX);
-
-                            debug = false;
-                        }
-                        
-                        lastMouseX = e.motion.x;
-                        lastMouseY = e.motion.y;
-
-                        
-                        scene.render(surface);
-                        SDL_UpdateWindowSurface(window);
-                    } else {
-                        // cube->applyTransform(Matrix::identity(4));  // Сбрасываем трансформации
-                        Position3D tmp_pos = cube->getPosition();
-                        // Центрируем модель
-                        cube->translate(-tmp_pos.getX(), -tmp_pos.getY(), -tmp_pos.getZ());
-                        // Вращаем модель
-                        cube->rotateY(deltaX * 0.0025f);
-                        cube->rotateX(deltaY * 0.0025f);
-                        // Возвращаем модель
-                        cube->translate(tmp_pos.getX(), tmp_pos.getY(), tmp_pos.getZ());
-                        
-                        // std::cout << "X:" << cube->getRotationX() << " Y:" << cube->getRotationY() << " Z:" << cube->getRotationZ() << "\n";
-                        
-                        lastMouseX = e.motion.x;
-                        lastMouseY = e.motion.y;
-                        
-                        scene.render(surface);
-                        SDL_UpdateWindowSurface(window);
-                    }
-                }
-                else if (isRightDragging) {
-                    // Вращение камеры
-                    scene.getCamera().rotate(deltaX * 0.01f, deltaY * 0.01f);
-                    
-                    lastMouseX = e.motion.x;
-                    lastMouseY = e.motion.y;
-                    
-                    scene.render(surface);
-                    SDL_UpdateWindowSurface(window);
-                }
+        // В простое спим до события; тайм-аут нужен только для вывода статистики
+        Uint64 waitStart = SDL_GetPerformanceCounter();
+        bool hasEvent = SDL_WaitEventTimeout(&e, STATS_INTERVAL_MS) != 0;
+        waitTicks += SDL_GetPerformanceCounter() - waitStart;
+
+        // Разбираем все накопившиеся события; однотипные изменения подряд сливаются в одну команду
+        while (hasEvent) {
+            recorder.record(e, JobSystem::nowNs());
+            if (e.type == renderer.getFrameEvent()) {
+                renderer.present(window);
             }
-            else if (e.type == SDL_MOUSEWHEEL) {
-                float scale_factor = (e.wheel.y > 0) ? 1.1f : 0.9f;
-                cube->applyTransform(Matrix::identity(4));
-                Position3D tmp_pos = cube->getPosition();
-
-                cube->translate(-tmp_pos.getX(), -tmp_pos.getY(), -tmp_pos.getZ());
-                cube->scale(scale_factor, scale_factor, scale_factor);
-                cube->translate(tmp_pos.getX(), tmp_pos.getY(), tmp_pos.getZ());
-                
-                scene.render(surface);
-                SDL_UpdateWindowSurface(window);
+            else if (e.type == SDL_QUIT) {
+                quit = true;
             }
-            else if (e.type == SDL_KEYDOWN) {
-                if (e.key.keysym.sym == SDLK_LSHIFT) {
-                    isShiftPressed = true;
-                }
-                float moveSpeed = 0.25f;
-                bool moved = false;
-                float forward = 0.0f, right = 0.0f, up = 0.0f;
-
-                switch (e.key.keysym.sym) {
-                    case SDLK_UP:
-                        forward = moveSpeed;
-                        moved = true;
-                        break;
-                    case SDLK_DOWN:
-                        forward = -moveSpeed;
-                        moved = true;
-                        break;
-                    case SDLK_LEFT:
-                        right = -moveSpeed;
-                        moved = true;
-                        break;
-                    case SDLK_RIGHT:
-                        right = moveSpeed;
-                        moved = true;
-                        break;
-                    case SDLK_PAGEUP:
-                        up = moveSpeed;
-                        moved = true;
-                        break;
-                    case SDLK_PAGEDOWN:
-                        up = -moveSpeed;
-                        moved = true;
-                        break;
-                    case SDLK_w:
-                        cube->translate(0.0f, -0.1f, 0.0f);
-                        break;
-                    case SDLK_s:
-                        cube->translate(0.0f, 0.1f, 0.0f);
-                        break;
-                    case SDLK_a:
-                        cube->translate(-0.1f, 0.0f, 0.0f);
-                        break;
-                    case SDLK_d:
-                        cube->translate(0.1f, 0.0f, 0.0f);
-                        break;
-                    case SDLK_q:
-                        cube->translate(0.0f, 0.0f, 0.1f);
-                        break;
-                    case SDLK_e:
-                        cube->translate(0.0f, 0.0f, -0.1f);
-                        break;
-                }
-
-                if (moved) {
-                    scene.getCamera().move(forward, right, up);
-                    scene.render(surface);
-                    SDL_UpdateWindowSurface(window);
-                }
-                else {
-                    scene.render(surface);
-                    SDL_UpdateWindowSurface(window);
-                }
+            else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                renderer.refresh(window);
             }
-            else if (e.type == SDL_KEYUP) {
-                if (e.key.keysym.sym == SDLK_LSHIFT) {
-                    isShiftPressed = false;
-                }
+            else {
+                input.handle(e, renderer);
             }
+
+            hasEvent = SDL_PollEvent(&e) != 0;
+        }
+        renderer.submit();
+
+        // Раз в секунду выводим статистику кадров и задержку ввода в заголовок окна
+        Uint64 now = SDL_GetPerformanceCounter();
+        if ((now - statsStart) * 1000 >= STATS_INTERVAL_MS * SDL_GetPerformanceFrequency()) {
+            FrameStats frames = renderer.getScheduler().takeStats(JobSystem::nowNs());
+            LatencyStats& latency = renderer.getLatency();
+            double inputIdle = 100.0 * waitTicks / (now - statsStart);
+
+            char title[224];
+            snprintf(title, sizeof(title),
+                     "3D Graphics | %.0f fps, frame %.1f ms (max %.1f) | idle: input %.0f%%, render %.0f%% | latency %.1f ms | %s",
+                     frames.fps(), frames.averageFrameMs(), frames.maxFrameMs(), inputIdle, frames.idlePercent(),
+                     latency.averageMs(), simdKernels().name);
+            SDL_SetWindowTitle(window, title);
+
+            latency.reset();
+            waitTicks = 0;
+            statsStart = now;
         }
     }
 
+    renderer.stop();
+    writeTrace();
+    if (recordPath && !recorder.close()) {
+        fprintf(stderr, "record: %s is incomplete\n", recordPath);
+    }
+
     // Очистка ресурсов
     SDL_FreeSurface(surface);
     SDL_DestroyWindow(window);
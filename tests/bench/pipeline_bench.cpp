@@ -0,0 +1,396 @@
+// Бенчмарки этапов конвейера и целых сцен с результатом в JSON.
+// Каждый случай повторяется --repeat раз (по умолчанию 10) после прогрева; в JSON попадают все замеры
+// и их статистика, чтобы сравнивать прогоны между собой. Таблица для чтения печатается в stderr.
+// В сборке с учётом выделений (make ALLOCS=1) для каждого случая записывается наибольшее число выделений
+// за повторение, а --no-alloc завершает бенчмарк с ошибкой, если выделяет установившийся кадр сцены.
+//
+// Нагрузочные сцены (StressScene.hpp) замеряются рядами при 1280x720; --scene заменяет ряды одной сценой
+// при всех разрешениях.
+//
+//   pipeline_bench [--repeat N] [--out file.json] [--filter подстрока] [--no-alloc] [--scene описание]
+#include "Scene3D.hpp"
+#include "Model3D.hpp"
+#include "HiddenSurfaceRemoval.hpp"
+#include "Camera3D.hpp"
+#include "Zbuffer.hpp"
+#include "Matrix.hpp"
+#include "JobSystem.hpp"
+#include "StressScene.hpp"
+#include "AllocationHooks.hpp"
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct Resolution {
+    int width, height;
+};
+
+static const Resolution RESOLUTIONS[] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+
+// Результат одного случая: время каждого повторения, мс
+struct BenchResult {
+    std::string name;
+    std::string params;   // Готовый JSON-объект параметров
+    std::vector<double> samples;
+    AllocationSnapshot allocations;   // Повторение с наибольшим числом выделений
+
+    double mean() const {
+        double sum = 0.0;
+        for (double sample : samples) sum += sample;
+        return sum / samples.size();
+    }
+
+    double stddev() const {
+        if (samples.size() < 2) return 0.0;
+        double average = mean(), sum = 0.0;
+        for (double sample : samples) sum += (sample - average) * (sample - average);
+        return std::sqrt(sum / (samples.size() - 1));
+    }
+
+    double median() const {
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        size_t middle = sorted.size() / 2;
+        return sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2.0;
+    }
+
+    double min() const {
+        return *std::min_element(samples.begin(), samples.end());
+    }
+
+    double max() const {
+        return *std::max_element(samples.begin(), samples.end());
+    }
+};
+
+static int repeats = 10;
+static const char* filter = nullptr;
+static bool noAllocations = false;   // --no-alloc
+static int allocationFailures = 0;
+static std::vector<BenchResult> results;
+
+// Замер run() repeats раз после одного прогона вхолостую; prepare() перед каждым прогоном не входит во время
+static void bench(const std::string& name, const std::string& params, const std::function<void()>& run,
+                  const std::function<void()>& prepare = nullptr) {
+    if (filter && name.find(filter) == std::string::npos) return;
+    BenchResult result = { name, params, {}, {} };
+    for (int i = -1; i < repeats; ++i) {
+        if (prepare) prepare();
+        AllocationSnapshot before = AllocationTracker::instance().snapshot();
+        uint64_t start = JobSystem::nowNs();
+        run();
+        double ms = (JobSystem::nowNs() - start) / 1e6;
+        AllocationSnapshot used = AllocationTracker::instance().snapshot().since(before);
+        if (i < 0) continue;
+        result.samples.push_back(ms);
+        if (used.total.allocations >= result.allocations.total.allocations) result.allocations = used;
+    }
+    fprintf(stderr, "%-34s %-66s %10.3f %10.3f %8.3f", name.c_str(), params.c_str(), result.median(), result.min(), result.stddev());
+    if (AllocationTracker::compiledIn()) fprintf(stderr, " %8llu", (unsigned long long)result.allocations.total.allocations);
+    fprintf(stderr, "\n");
+    results.push_back(result);
+}
+
+// Строка JSON в кавычках с экранированием
+static std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        } else if ((unsigned char)c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", (unsigned)c);
+            quoted += escape;
+            continue;
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static std::string resolutionParams(const Resolution& resolution, const std::string& extra = "") {
+    return "{\"width\": " + std::to_string(resolution.width) + ", \"height\": " + std::to_string(resolution.height) + extra + "}";
+}
+
+static float randomFloat(float low, float high) {
+    return low + (high - low) * (float)rand() / RAND_MAX;
+}
+
+static Matrix worldPoint(float x, float y, float z) {
+    Matrix point(4, 1);
+    point.at(0, 0) = x;
+    point.at(1, 0) = y;
+    point.at(2, 0) = z;
+    point.at(3, 0) = 1.0f;
+    return point;
+}
+
+static void matrixBenches() {
+    Matrix rotation = Matrix::rotationY(0.01f) * Matrix::rotationX(0.02f);
+    bench("matrix_multiply", "{\"shape\": \"4x4*4x4\", \"count\": 10000}", [&] {
+        Matrix accumulated = Matrix::identity(4);
+        for (int i = 0; i < 10000; ++i) accumulated = rotation * accumulated;
+        if (accumulated.at(0, 0) == 42.0f) fprintf(stderr, " ");
+    });
+
+    const int COLUMNS = 10000;
+    Matrix points(4, COLUMNS);
+    for (int i = 0; i < COLUMNS; ++i) {
+        for (int row = 0; row < 4; ++row) points.at(row, i) = row == 3 ? 1.0f : randomFloat(-1.0f, 1.0f);
+    }
+    bench("matrix_multiply", "{\"shape\": \"4x4*4x10000\", \"count\": 1}", [&] {
+        Matrix transformed = rotation * points;
+        if (transformed.at(0, 0) == 42.0f) fprintf(stderr, " ");
+    });
+}
+
+static void modelBenches() {
+    for (int rings : { 16, 64 }) {
+        auto sphere = Model3D::createSphere(1.0f, rings, rings * 2);
+        char params[96];
+        snprintf(params, sizeof(params), "{\"model\": \"sphere\", \"vertices\": %zu, \"count\": 100}",
+                 sphere->getTransformedVertices().getCols());
+        bench("model_update_transformed_vertices", params, [&] {
+            for (int i = 0; i < 100; ++i) sphere->updateTransformedVertices();
+        });
+    }
+}
+
+static void sortBenches() {
+    for (int rings : { 16, 64 }) {
+        auto sphere = Model3D::createSphere(1.0f, rings, rings * 2);
+        sphere->rotateX(0.3f);
+        HiddenSurfaceRemoval hsr;
+        std::vector<Position3D> vertices;
+        for (size_t i = 0; i < sphere->getTransformedVertices().getCols(); ++i) vertices.push_back(sphere->getTransformedVertexPos((int)i));
+        hsr.setVertices(vertices);
+        std::vector<std::vector<int>> polygons = sphere->getPolygons();
+        for (const auto& polygon : polygons) hsr.addPolygon(polygon);
+        hsr.updatePolygons();
+        char params[96];
+        snprintf(params, sizeof(params), "{\"model\": \"sphere\", \"polygons\": %zu, \"count\": 10}", polygons.size());
+        bench("hsr_sort_polygons", params, [&] {
+            for (int i = 0; i < 10; ++i) {
+                std::vector<Polygon3D> sorted = hsr.sortPolygons();
+                if (sorted.empty()) fprintf(stderr, " ");
+            }
+        });
+    }
+}
+
+// Треугольники и линии в мировых координатах перед камерой: полный путь проецирования и растеризации
+static void rasterBenches() {
+    const int TRIANGLES = 2000;
+    const int LINES = 5000;
+    std::vector<Matrix> triangles, lines;
+    for (int i = 0; i < TRIANGLES; ++i) {
+        float x = randomFloat(-2.0f, 2.0f), y = randomFloat(-1.2f, 1.2f), z = randomFloat(-3.0f, 1.0f);
+        for (int corner = 0; corner < 3; ++corner) {
+            triangles.push_back(worldPoint(x + randomFloat(-0.3f, 0.3f), y + randomFloat(-0.3f, 0.3f), z + randomFloat(-0.3f, 0.3f)));
+        }
+    }
+    for (int i = 0; i < LINES; ++i) {
+        for (int end = 0; end < 2; ++end) {
+            lines.push_back(worldPoint(randomFloat(-2.0f, 2.0f), randomFloat(-1.2f, 1.2f), randomFloat(-3.0f, 1.0f)));
+        }
+    }
+
+    for (const Resolution& resolution : RESOLUTIONS) {
+        SDL_Surface* surface = SDL_CreateRGBSurface(0, resolution.width, resolution.height, 32, 0, 0, 0, 0);
+        Zbuffer zbuffer(resolution.width, resolution.height);
+        Camera3D camera(resolution.width, resolution.height);
+        auto reset = [&] {
+            SDL_FillRect(surface, nullptr, 0);
+            zbuffer.clear();
+        };
+
+        char extra[64];
+        snprintf(extra, sizeof(extra), ", \"triangles\": %d", TRIANGLES);
+        bench("camera_fill_triangle_alt", resolutionParams(resolution, extra), [&] {
+            for (size_t i = 0; i < triangles.size(); i += 3) {
+                camera.fillTriangleAlt(surface, triangles[i], triangles[i + 1], triangles[i + 2], 0x808080, zbuffer);
+            }
+        }, reset);
+
+        snprintf(extra, sizeof(extra), ", \"lines\": %d", LINES);
+        bench("camera_draw_line", resolutionParams(resolution, extra), [&] {
+            for (size_t i = 0; i < lines.size(); i += 2) {
+                camera.drawLine(surface, lines[i], lines[i + 1], 0xFFFFFF, zbuffer);
+            }
+        }, reset);
+
+        bench("zbuffer_clear", resolutionParams(resolution, ", \"count\": 10"), [&] {
+            for (int i = 0; i < 10; ++i) zbuffer.clear();
+        });
+
+        SDL_FreeSurface(surface);
+    }
+}
+
+// Кадры готовой сцены: каждый замер — кадр после небольшого поворота камеры, то есть полная перерисовка
+static void sceneFrames(const std::string& name, const std::string& params, Scene3D& scene, const Resolution& resolution) {
+    SDL_Surface* surface = SDL_CreateRGBSurface(0, resolution.width, resolution.height, 32, 0, 0, 0, 0);
+    scene.render(surface);
+
+    // Разогрев: история изменений кадров и пул задач заполняются за первые несколько кадров
+    float angle = 0.002f;
+    for (int i = 0; i < 8; ++i) {
+        angle = -angle;
+        scene.getCamera().rotate(angle, 0.0f);
+        scene.render(surface);
+    }
+    bench(name, params, [&] {
+        scene.render(surface);
+    }, [&] {
+        angle = -angle;
+        scene.getCamera().rotate(angle, 0.0f);
+    });
+    SDL_FreeSurface(surface);
+
+    // Кадры после разогрева — установившийся режим: вся память уже должна быть выделена
+    if (noAllocations && !results.empty() && results.back().name == name && results.back().allocations.total.allocations) {
+        fprintf(stderr, "FAIL %s %s: steady-state frame allocates: ", name.c_str(), results.back().params.c_str());
+        results.back().allocations.print(stderr);
+        allocationFailures++;
+    }
+}
+
+static void sceneBench(const char* kind, int count, const Resolution& resolution,
+                       const std::function<std::shared_ptr<Model3D>(int)>& create) {
+    Scene3D scene(resolution.width, resolution.height);
+    scene.getLighting().addLight(Light::directional(Position3D(-0.3f, -1.0f, -0.6f), { 0.8f, 0.8f, 0.75f }));
+    scene.setShadingMode(SHADING_GOURAUD);
+    int side = (int)std::ceil(std::sqrt((double)count));
+    float spacing = 4.0f / side;
+    size_t polygons = 0;
+    for (int i = 0; i < count; ++i) {
+        auto model = create(i);
+        polygons += model->getPolygons().size();
+        model->translate((i % side + 0.5f) * spacing - 2.0f, (i / side + 0.5f) * spacing - 2.0f, -(float)(i % 3));
+        scene.addModel(model);
+    }
+
+    char extra[96];
+    snprintf(extra, sizeof(extra), ", \"models\": %d, \"polygons\": %zu", count, polygons);
+    sceneFrames(std::string("scene_") + kind, resolutionParams(resolution, extra), scene, resolution);
+}
+
+static void sceneBenches() {
+    for (const Resolution& resolution : RESOLUTIONS) {
+        for (int count : { 100, 1000 }) {
+            sceneBench("cubes", count, resolution, [&](int) {
+                return Model3D::createCube(2.0f / std::sqrt((float)count));
+            });
+        }
+        sceneBench("spheres", 16, resolution, [](int) {
+            return Model3D::createSphere(0.4f, 32, 64);
+        });
+    }
+}
+
+// Нагрузочная сцена по описанию из StressScene.hpp. Сцена строится, только если случай не отсеян --filter.
+static void stressBench(const char* description, const Resolution& resolution) {
+    if (filter && !strstr("scene_stress", filter)) return;
+    StressSceneSpec spec;
+    std::string error;
+    if (!parseStressSceneSpec(description, spec, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return;
+    }
+    Scene3D scene(resolution.width, resolution.height);
+    scene.getLighting().addLight(Light::directional(Position3D(-0.3f, -1.0f, -0.6f), { 0.8f, 0.8f, 0.75f }));
+    scene.setShadingMode(SHADING_GOURAUD);
+    StressSceneInfo info = buildStressScene(scene, spec);
+
+    std::string extra = ", \"scene\": " + jsonString(description) + ", \"models\": " + std::to_string(info.models)
+                        + ", \"triangles\": " + std::to_string(info.triangles);
+    sceneFrames("scene_stress", resolutionParams(resolution, extra), scene, resolution);
+}
+
+// Ряды нагрузочных сцен, в каждом растёт одна величина: число треугольников при почти той же площади,
+// число моделей, размер треугольников при том же их числе и глубина перекрытия
+static const char* const STRESS_SCENES[] = {
+    "icosphere:2", "icosphere:4", "icosphere:6",
+    "cubes:4x4x4", "cubes:8x8x8", "cubes:16x16x16",
+    "soup:20000:0.01-0.03", "soup:20000:0.05-0.15", "soup:20000:0.2-0.6",
+    "stack:4", "stack:16", "stack:64"
+};
+
+static void stressBenches(const char* custom) {
+    if (custom) {
+        for (const Resolution& resolution : RESOLUTIONS) stressBench(custom, resolution);
+        return;
+    }
+    for (const char* description : STRESS_SCENES) stressBench(description, RESOLUTIONS[1]);
+}
+
+static void printString(FILE* file, const std::string& text) {
+    fputs(jsonString(text).c_str(), file);
+}
+
+static void writeJson(FILE* file) {
+    fprintf(file, "{\n  \"suite\": \"pipeline\",\n  \"simd\": ");
+    printString(file, simdKernels().name);
+    fprintf(file, ",\n  \"workers\": %u,\n  \"repetitions\": %d,\n  \"unit\": \"ms\",\n  \"results\": [\n",
+            JobSystem::defaultWorkerCount(), repeats);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        fprintf(file, "    {\"name\": ");
+        printString(file, result.name);
+        fprintf(file, ", \"params\": %s,\n     \"min\": %.6f, \"median\": %.6f, \"mean\": %.6f, \"stddev\": %.6f, \"max\": %.6f,\n     ",
+                result.params.c_str(), result.min(), result.median(), result.mean(), result.stddev(), result.max());
+        if (AllocationTracker::compiledIn()) {
+            fprintf(file, "\"allocations\": %llu, \"allocated_bytes\": %llu, ",
+                    (unsigned long long)result.allocations.total.allocations, (unsigned long long)result.allocations.total.bytes);
+        }
+        fprintf(file, "\"samples\": [");
+        for (size_t j = 0; j < result.samples.size(); ++j) {
+            fprintf(file, "%s%.6f", j ? ", " : "", result.samples[j]);
+        }
+        fprintf(file, "]}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    const char* out = nullptr;
+    const char* stressScene = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--no-alloc") == 0) noAllocations = true;
+        else if (i + 1 >= argc) break;
+        else if (strcmp(argv[i], "--repeat") == 0) repeats = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--out") == 0) out = argv[++i];
+        else if (strcmp(argv[i], "--filter") == 0) filter = argv[++i];
+        else if (strcmp(argv[i], "--scene") == 0) stressScene = argv[++i];
+    }
+    if (noAllocations && !AllocationTracker::compiledIn()) {
+        fprintf(stderr, "--no-alloc needs a build with allocation tracking (make ALLOCS=1)\n");
+        return 2;
+    }
+    srand(1);
+
+    fprintf(stderr, "%-34s %-66s %10s %10s %8s%s\n", "case", "params", "median ms", "min ms", "stddev",
+            AllocationTracker::compiledIn() ? "   allocs" : "");
+    matrixBenches();
+    modelBenches();
+    sortBenches();
+    rasterBenches();
+    sceneBenches();
+    stressBenches(stressScene);
+
+    FILE* file = out ? fopen(out, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", out);
+        return 1;
+    }
+    writeJson(file);
+    if (out) fclose(file);
+    return allocationFailures ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+// Сравнение специализированных вариантов растеризатора (RasterPermutation) с общим путём (RasterState).
+// Оба пути рисуют одинаковые треугольники и линии; сверяется и время, и результат.
+#include "Camera3D.hpp"
+#include "Zbuffer.hpp"
+#include "JobSystem.hpp"
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const int WIDTH = 1920;
+static const int HEIGHT = 1080;
+static const int TRIANGLES = 20000;
+static const int LINES = 20000;
+static const int REPEATS = 5;
+
+struct Primitive {
+    Camera3D::Point2D a, b, c;
+    uint32_t color;
+};
+
+static float randomFloat(float low, float high) {
+    return low + (high - low) * (float)rand() / RAND_MAX;
+}
+
+// Треугольники размером до 200 пикселей со случайной глубиной
+static std::vector<Primitive> makePrimitives(int count) {
+    std::vector<Primitive> primitives(count);
+    for (Primitive& p : primitives) {
+        float x = randomFloat(-50.0f, WIDTH + 50.0f);
+        float y = randomFloat(-50.0f, HEIGHT + 50.0f);
+        p.a = { x, y, 1.0f / randomFloat(1.0f, 50.0f) };
+        p.b = { x + randomFloat(-100.0f, 100.0f), y + randomFloat(-100.0f, 100.0f), 1.0f / randomFloat(1.0f, 50.0f) };
+        p.c = { x + randomFloat(-100.0f, 100.0f), y + randomFloat(-100.0f, 100.0f), 1.0f / randomFloat(1.0f, 50.0f) };
+        p.color = (uint32_t)rand() & 0xFFFFFF;
+    }
+    return primitives;
+}
+
+static uint64_t checksum(SDL_Surface* surface, Zbuffer& zbuffer) {
+    uint64_t sum = 0;
+    for (int y = 0; y < surface->h; ++y) {
+        const uint32_t* row = (const uint32_t*)((const uint8_t*)surface->pixels + y * surface->pitch);
+        for (int x = 0; x < surface->w; ++x) {
+            float depth = zbuffer.getValue(x, y);
+            uint32_t bits;
+            memcpy(&bits, &depth, sizeof(bits));
+            sum = sum * 31 + row[x] + bits;
+        }
+    }
+    return sum;
+}
+
+// Лучшее время из REPEATS прогонов draw(), мс; checksum — результат последнего прогона
+template <typename Draw>
+static double measure(SDL_Surface* surface, Zbuffer& zbuffer, uint64_t& sum, Draw draw) {
+    double best = 1e30;
+    for (int i = 0; i < REPEATS; ++i) {
+        SDL_FillRect(surface, nullptr, 0);
+        zbuffer.clear();
+        uint64_t start = JobSystem::nowNs();
+        draw();
+        best = std::min(best, (JobSystem::nowNs() - start) / 1e6);
+    }
+    sum = checksum(surface, zbuffer);
+    return best;
+}
+
+static const char* depthName(DepthMode mode) {
+    return mode == DEPTH_OFF ? "off" : mode == DEPTH_TEST ? "test" : "test+write";
+}
+
+int main(int argc, char** argv) {
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    SDL_Surface* surface = SDL_CreateRGBSurface(0, WIDTH, HEIGHT, 32, 0, 0, 0, 0);
+    Zbuffer zbuffer(WIDTH, HEIGHT);
+    Camera3D camera(WIDTH, HEIGHT);
+    std::vector<Primitive> triangles = makePrimitives(TRIANGLES);
+    std::vector<Primitive> lines = makePrimitives(LINES);
+
+    static const RasterState states[] = {
+        { DEPTH_TEST_WRITE, BLEND_REPLACE,  PIXELS_32  },
+        { DEPTH_TEST,       BLEND_REPLACE,  PIXELS_32  },
+        { DEPTH_OFF,        BLEND_REPLACE,  PIXELS_32  },
+        { DEPTH_TEST_WRITE, BLEND_DISABLED, PIXELS_32  },
+        { DEPTH_TEST_WRITE, BLEND_REPLACE,  PIXELS_ANY },
+        { DEPTH_TEST_WRITE, BLEND_REPLACE,  PIXELS_32,  DEPTH_REVERSE_Z },
+        { DEPTH_TEST,       BLEND_REPLACE,  PIXELS_32,  DEPTH_REVERSE_Z },
+    };
+
+    printf("%-11s %-7s %-8s %-6s %-9s %12s %12s %8s %s\n", "depth", "stores", "color", "pixels", "primitive", "generic ms", "special ms", "speedup", "match");
+    bool allMatch = true;
+    for (const RasterState& constant : states) {
+        // Состояние читается через volatile, чтобы компилятор не специализировал общий путь сам
+        volatile int depth = constant.depth, blend = constant.blend, pixels = constant.pixels, encoding = constant.encoding;
+        RasterState state = { (DepthMode)depth, (BlendMode)blend, (PixelLayout)pixels, (DepthEncoding)encoding };
+        zbuffer.setEncoding(state.encoding);
+
+        for (int kind = 0; kind < 2; ++kind) {
+            const std::vector<Primitive>& primitives = kind == 0 ? triangles : lines;
+            auto drawWith = [&](const auto& rasterState) {
+                for (const Primitive& p : primitives) {
+                    if (kind == 0) {
+                        camera.fillTriangle(surface, p.a, p.b, p.c, p.color, zbuffer, nullptr, rasterState);
+                    } else {
+                        camera.drawLine(surface, p.a, p.b, p.color, zbuffer, nullptr, rasterState);
+                    }
+                }
+            };
+
+            uint64_t genericSum, specialSum;
+            double generic = measure(surface, zbuffer, genericSum, [&] { drawWith(state); });
+            double special = measure(surface, zbuffer, specialSum, [&] {
+                withRasterPermutation(state, [&](auto permutation) { drawWith(permutation); });
+            });
+            bool match = genericSum == specialSum;
+            allMatch &= match;
+            printf("%-11s %-7s %-8s %-6s %-9s %12.2f %12.2f %7.2fx %s\n", depthName(state.depth),
+                   state.encoding == DEPTH_REVERSE_Z ? "1/w" : "w",
+                   state.blend == BLEND_REPLACE ? "replace" : "off", state.pixels == PIXELS_32 ? "32" : "any",
+                   kind == 0 ? "triangles" : "lines", generic, special, generic / special, match ? "yes" : "NO");
+        }
+    }
+
+    SDL_FreeSurface(surface);
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+// Сравнение вариантов SIMD-ядер (SimdKernels.hpp) со скалярным: время и побитовое совпадение результата.
+// Варианты, которые процессор не поддерживает, пропускаются.
+#include "SimdKernels.hpp"
+#include "JobSystem.hpp"
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const int WIDTH = 1920;
+static const int HEIGHT = 1080;
+static const size_t POINTS = 1 << 20;
+static const int REPEATS = 5;
+
+static float randomFloat(float low, float high) {
+    return low + (high - low) * (float)rand() / RAND_MAX;
+}
+
+static std::vector<float> randomFloats(size_t count, float low, float high) {
+    std::vector<float> values(count);
+    for (float& value : values) value = randomFloat(low, high);
+    return values;
+}
+
+// Хеш байтов результата
+static uint64_t hashBytes(const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+// Исходные данные всех ядер
+struct Inputs {
+    float matrix[16];
+    std::vector<float> x, y, z, w;
+    std::vector<float> normalX, normalY, normalZ;
+    std::vector<uint32_t> pixels;
+    std::vector<float> depth;
+    std::vector<float> spanLeftX, spanLeftW, spanStep;
+    SDL_PixelFormat* from;
+    SDL_PixelFormat* to;
+};
+
+// Один прогон ядра: prepare восстанавливает выходные данные, run — замеряемая часть, result — хеш выхода
+struct KernelCase {
+    const char* name;
+    void (*prepare)(Inputs& in);
+    void (*run)(const SimdKernels& kernels, Inputs& in);
+    uint64_t (*result)(Inputs& in);
+};
+
+static std::vector<float> outX, outY, outZ, outW;
+static std::vector<uint8_t> visible;
+static std::vector<uint32_t> targetPixels;
+static std::vector<uint32_t> spanPixels;
+static std::vector<float> spanDepth;
+
+static void noPrepare(Inputs&) {}
+
+static void runTransform(const SimdKernels& kernels, Inputs& in) {
+    const float* source[4] = { in.x.data(), in.y.data(), in.z.data(), in.w.data() };
+    float* target[4] = { outX.data(), outY.data(), outZ.data(), outW.data() };
+    kernels.transformPoints(in.matrix, source, target, POINTS);
+}
+
+static uint64_t transformResult(Inputs&) {
+    return hashBytes(outX.data(), POINTS * 4) ^ hashBytes(outY.data(), POINTS * 4) * 3
+         ^ hashBytes(outZ.data(), POINTS * 4) * 5 ^ hashBytes(outW.data(), POINTS * 4) * 7;
+}
+
+static void runProject(const SimdKernels& kernels, Inputs& in) {
+    kernels.projectPoints(in.matrix, WIDTH / 2.0f, HEIGHT / 2.0f, in.x.data(), in.y.data(), in.z.data(), POINTS,
+                          outX.data(), outY.data(), outZ.data(), outW.data());
+}
+
+static void runCull(const SimdKernels& kernels, Inputs& in) {
+    kernels.cullBackFaces(in.normalX.data(), in.normalY.data(), in.normalZ.data(), in.x.data(), in.y.data(), in.z.data(),
+                          POINTS, 0.5f, -0.25f, 3.0f, visible.data());
+}
+
+static uint64_t cullResult(Inputs&) {
+    return hashBytes(visible.data(), visible.size());
+}
+
+static void prepareSpans(Inputs& in) {
+    spanPixels.assign(in.pixels.begin(), in.pixels.end());
+    spanDepth.assign(in.depth.begin(), in.depth.end());
+}
+
+// Одна строка на каждую строку экрана, с разным началом и длиной
+static void runSpans(const SimdKernels& kernels, Inputs& in) {
+    for (int y = 0; y < HEIGHT; ++y) {
+        int xBegin = y % 37;
+        int count = WIDTH - xBegin - y % 23;
+        kernels.fillSpan(spanPixels.data() + y * WIDTH + xBegin, spanDepth.data() + y * WIDTH + xBegin, xBegin, count,
+                         in.spanLeftX[y], in.spanLeftW[y], in.spanStep[y], 0x00FF8040u + y);
+    }
+}
+
+// Те же строки с обратной глубиной: буфер глубины хранит 1 / w
+static void prepareReverseSpans(Inputs& in) {
+    spanPixels.assign(in.pixels.begin(), in.pixels.end());
+    spanDepth.resize(in.depth.size());
+    for (size_t i = 0; i < spanDepth.size(); ++i) spanDepth[i] = 1.0f - in.depth[i];
+}
+
+static void runReverseSpans(const SimdKernels& kernels, Inputs& in) {
+    for (int y = 0; y < HEIGHT; ++y) {
+        int xBegin = y % 37;
+        int count = WIDTH - xBegin - y % 23;
+        kernels.fillSpanReverse(spanPixels.data() + y * WIDTH + xBegin, spanDepth.data() + y * WIDTH + xBegin, xBegin, count,
+                                in.spanLeftX[y], 1.0f / in.spanLeftW[y], in.spanStep[y], 0x00FF8040u + y);
+    }
+}
+
+static uint64_t spansResult(Inputs&) {
+    return hashBytes(spanPixels.data(), spanPixels.size() * 4) ^ hashBytes(spanDepth.data(), spanDepth.size() * 4) * 3;
+}
+
+static void runFillDepth(const SimdKernels& kernels, Inputs&) {
+    kernels.fillDepth(spanDepth.data(), spanDepth.size() - 3, 1e30f);
+}
+
+static uint64_t depthResult(Inputs&) {
+    return hashBytes(spanDepth.data(), spanDepth.size() * 4);
+}
+
+static void runRepack(const SimdKernels& kernels, Inputs& in) {
+    kernels.repackPixels(in.pixels.data(), targetPixels.data(), in.pixels.size() - 5, in.from, in.to);
+}
+
+static uint64_t repackResult(Inputs&) {
+    return hashBytes(targetPixels.data(), targetPixels.size() * 4);
+}
+
+int main(int argc, char** argv) {
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    Inputs in;
+    for (float& value : in.matrix) value = randomFloat(-2.0f, 2.0f);
+    in.x = randomFloats(POINTS, -10.0f, 10.0f);
+    in.y = randomFloats(POINTS, -10.0f, 10.0f);
+    in.z = randomFloats(POINTS, -10.0f, 10.0f);
+    in.w.assign(POINTS, 1.0f);
+    // Вершины, у которых w отсечения равно нулю: проверка ветви без деления
+    in.matrix[12] = in.matrix[13] = 0.0f;
+    in.matrix[14] = 1.0f;
+    in.matrix[15] = 0.0f;
+    for (size_t i = 0; i < POINTS; i += 97) in.z[i] = 0.0f;
+    in.normalX = randomFloats(POINTS, -1.0f, 1.0f);
+    in.normalY = randomFloats(POINTS, -1.0f, 1.0f);
+    in.normalZ = randomFloats(POINTS, -1.0f, 1.0f);
+    in.pixels.resize(WIDTH * HEIGHT);
+    for (uint32_t& pixel : in.pixels) pixel = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    in.depth = randomFloats(WIDTH * HEIGHT, 0.0f, 1.0f);
+    in.spanLeftX = randomFloats(HEIGHT, -5.0f, 5.0f);
+    in.spanLeftW = randomFloats(HEIGHT, 0.5f, 4.0f);
+    in.spanStep = randomFloats(HEIGHT, -0.001f, 0.001f);
+    in.from = SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888);
+    in.to = SDL_AllocFormat(SDL_PIXELFORMAT_ABGR8888);
+
+    outX.resize(POINTS);
+    outY.resize(POINTS);
+    outZ.resize(POINTS);
+    outW.resize(POINTS);
+    visible.resize(POINTS);
+    targetPixels.assign(in.pixels.size(), 0);
+    prepareSpans(in);
+
+    static const KernelCase cases[] = {
+        { "transformPoints", noPrepare, runTransform, transformResult },
+        { "projectPoints", noPrepare, runProject, transformResult },
+        { "cullBackFaces", noPrepare, runCull, cullResult },
+        { "fillSpan", prepareSpans, runSpans, spansResult },
+        { "fillSpanReverse", prepareReverseSpans, runReverseSpans, spansResult },
+        { "fillDepth", prepareSpans, runFillDepth, depthResult },
+        { "repackPixels", noPrepare, runRepack, repackResult },
+    };
+
+    SimdLevel supported = detectSimdLevel();
+    printf("cpu: %s, selected: %s\n", simdKernelsFor(supported).name, simdKernels().name);
+    printf("%-16s %-8s %10s %8s %s\n", "kernel", "variant", "ms", "speedup", "match");
+
+    bool allMatch = true;
+    for (const KernelCase& kernel : cases) {
+        double scalarMs = 0.0;
+        uint64_t scalarHash = 0;
+        for (int level = SIMD_SCALAR; level <= supported; ++level) {
+            const SimdKernels& kernels = simdKernelsFor((SimdLevel)level);
+            double best = 1e30;
+            for (int i = 0; i < REPEATS; ++i) {
+                kernel.prepare(in);
+                uint64_t start = JobSystem::nowNs();
+                kernel.run(kernels, in);
+                best = std::min(best, (JobSystem::nowNs() - start) / 1e6);
+            }
+            uint64_t hash = kernel.result(in);
+            if (level == SIMD_SCALAR) {
+                scalarMs = best;
+                scalarHash = hash;
+            }
+            bool match = hash == scalarHash;
+            allMatch &= match;
+            printf("%-16s %-8s %10.3f %7.2fx %s\n", kernel.name, kernels.name, best, scalarMs / best, match ? "yes" : "NO");
+        }
+    }
+
+    SDL_FreeFormat(in.from);
+    SDL_FreeFormat(in.to);
+    return allMatch ? 0 : 1;
+}
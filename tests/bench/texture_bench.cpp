@@ -0,0 +1,143 @@
+// Скорость заливки текстурированных треугольников по сравнению с заливкой цветом.
+// Экран закрывается прямоугольником из двух треугольников; меняются фильтрация, масштаб текстуры,
+// уровень mip-цепочки, направление обхода текстуры и раскладка текселей (Мортон или по строкам).
+#include "Camera3D.hpp"
+#include "Texture.hpp"
+#include "Zbuffer.hpp"
+#include "JobSystem.hpp"
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const int WIDTH = 1920;
+static const int HEIGHT = 1080;
+static const int LAYERS = 10;
+static const int REPEATS = 5;
+
+// Без глубины: слои ложатся друг на друга, и каждый пиксель каждого слоя доходит до выборки текселя
+typedef RasterPermutation<DEPTH_OFF, BLEND_REPLACE, PIXELS_32> FillRaster;
+
+// Тот же уровень с текселями по строкам: для сравнения раскладок
+static TextureLevel rowMajorCopy(const TextureLevel& level) {
+    TextureLevel copy = level;
+    for (int x = 0; x < level.width; ++x) copy.columnOffsets[x] = x;
+    for (int y = 0; y < level.height; ++y) copy.rowOffsets[y] = (uint32_t)y * level.width;
+    for (int y = 0; y < level.height; ++y) {
+        for (int x = 0; x < level.width; ++x) {
+            copy.texels[copy.columnOffsets[x] | copy.rowOffsets[y]] = level.fetch(x, y);
+        }
+    }
+    return copy;
+}
+
+struct Quad {
+    Camera3D::Point2D corners[4];
+    float uv[4][2];   // В текселях уровня
+};
+
+// Прямоугольник на весь экран с наклоном по глубине; repeat — сколько раз текстура укладывается по стороне,
+// rotated — текстура повёрнута на 90°, и строка экрана идёт вдоль столбца текстуры
+static Quad makeQuad(const TextureLevel& level, float repeat, bool rotated) {
+    Quad quad;
+    quad.corners[0] = { 0.0f, 0.0f, 1.0f / 2.0f };
+    quad.corners[1] = { (float)WIDTH, 0.0f, 1.0f / 2.0f };
+    quad.corners[2] = { (float)WIDTH, (float)HEIGHT, 1.0f / 1.5f };
+    quad.corners[3] = { 0.0f, (float)HEIGHT, 1.0f / 1.5f };
+    static const float unit[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+    for (int i = 0; i < 4; ++i) {
+        float u = unit[i][0], v = unit[i][1];
+        if (rotated) std::swap(u, v);
+        quad.uv[i][0] = u * repeat * level.width;
+        quad.uv[i][1] = v * repeat * level.height;
+    }
+    return quad;
+}
+
+// Лучшее время из REPEATS прогонов draw(), мс
+template <typename Draw>
+static double measure(SDL_Surface* surface, Draw draw) {
+    double best = 1e30;
+    for (int i = 0; i < REPEATS; ++i) {
+        SDL_FillRect(surface, nullptr, 0);
+        uint64_t start = JobSystem::nowNs();
+        for (int layer = 0; layer < LAYERS; ++layer) draw();
+        best = std::min(best, (JobSystem::nowNs() - start) / 1e6);
+    }
+    return best;
+}
+
+template <TextureFilter Filter>
+static double drawTextured(Camera3D& camera, SDL_Surface* surface, Zbuffer& zbuffer, const TextureLevel& level, const Quad& quad) {
+    TextureShader<Filter, false> shader = { &level };
+    return measure(surface, [&] {
+        camera.shadeTriangle<2>(surface, quad.corners[0], quad.corners[1], quad.corners[2], quad.uv[0], quad.uv[1], quad.uv[2],
+                                shader, zbuffer, nullptr, FillRaster());
+        camera.shadeTriangle<2>(surface, quad.corners[0], quad.corners[2], quad.corners[3], quad.uv[0], quad.uv[2], quad.uv[3],
+                                shader, zbuffer, nullptr, FillRaster());
+    });
+}
+
+static void report(const char* name, const char* filter, const char* layout, const char* level, double ms, double flatMs) {
+    double megapixels = (double)WIDTH * HEIGHT * LAYERS / 1e6;
+    printf("%-12s %-9s %-7s %-6s %10.2f %10.0f %9.2fx\n", name, filter, layout, level, ms, megapixels / (ms / 1e3), ms / flatMs);
+}
+
+int main() {
+    SDL_Surface* surface = SDL_CreateRGBSurface(0, WIDTH, HEIGHT, 32, 0, 0, 0, 0);
+    Zbuffer zbuffer(WIDTH, HEIGHT);
+    Camera3D camera(WIDTH, HEIGHT);
+
+    // Шум, а не клетки: соседние тексели различаются, и выборку нельзя угадать по цвету
+    const int SIZE = 2048;
+    std::vector<uint32_t> pixels((size_t)SIZE * SIZE);
+    srand(1);
+    for (uint32_t& pixel : pixels) pixel = ((uint32_t)rand() << 8 ^ (uint32_t)rand()) & 0xFFFFFF;
+    Texture texture(SIZE, SIZE, pixels.data());
+
+    const TextureLevel& full = texture.getLevel(0);
+    TextureLevel fullRows = rowMajorCopy(full);
+    const TextureLevel& small = texture.getLevel(3);   // 256×256: растягивается на экран
+    TextureLevel smallRows = rowMajorCopy(small);
+
+    Camera3D::Point2D a = { 0.0f, 0.0f, 0.5f }, b = { (float)WIDTH, 0.0f, 0.5f };
+    Camera3D::Point2D c = { (float)WIDTH, (float)HEIGHT, 1.0f / 1.5f }, d = { 0.0f, (float)HEIGHT, 1.0f / 1.5f };
+    double flat = measure(surface, [&] {
+        camera.fillTriangle(surface, a, b, c, 0x808080, zbuffer, nullptr, FillRaster());
+        camera.fillTriangle(surface, a, c, d, 0x808080, zbuffer, nullptr, FillRaster());
+    });
+
+    printf("%-12s %-9s %-7s %-6s %10s %10s %10s\n", "case", "filter", "layout", "level", "ms", "Mpix/s", "vs flat");
+    report("flat", "-", "-", "-", flat, flat);
+
+    // Увеличение: 256×256 на весь экран, соседние пиксели берут один тексель
+    for (int rotated = 0; rotated < 2; ++rotated) {
+        const char* name = rotated ? "magnify 90" : "magnify";
+        Quad quad = makeQuad(small, 1.0f, rotated != 0);
+        report(name, "nearest", "morton", "3", drawTextured<TEXTURE_NEAREST>(camera, surface, zbuffer, small, quad), flat);
+        report(name, "nearest", "rows", "3", drawTextured<TEXTURE_NEAREST>(camera, surface, zbuffer, smallRows, quad), flat);
+        report(name, "bilinear", "morton", "3", drawTextured<TEXTURE_BILINEAR>(camera, surface, zbuffer, small, quad), flat);
+        report(name, "bilinear", "rows", "3", drawTextured<TEXTURE_BILINEAR>(camera, surface, zbuffer, smallRows, quad), flat);
+    }
+
+    // Уменьшение: 2048×2048, уложенная дважды, — около четырёх текселей на пиксель по каждой оси.
+    // Без mip-цепочки выборки разбросаны по 16 МБ; уровень по площади даёт около текселя на пиксель.
+    size_t selected = texture.selectLevel(4.0f, (float)WIDTH * HEIGHT);
+    char selectedName[8];
+    snprintf(selectedName, sizeof(selectedName), "%zu", selected);
+    const TextureLevel& mip = texture.getLevel(selected);
+    for (int rotated = 0; rotated < 2; ++rotated) {
+        const char* name = rotated ? "minify 90" : "minify";
+        Quad quadFull = makeQuad(full, 2.0f, rotated != 0);
+        Quad quadMip = makeQuad(mip, 2.0f, rotated != 0);
+        report(name, "nearest", "morton", "0", drawTextured<TEXTURE_NEAREST>(camera, surface, zbuffer, full, quadFull), flat);
+        report(name, "nearest", "rows", "0", drawTextured<TEXTURE_NEAREST>(camera, surface, zbuffer, fullRows, quadFull), flat);
+        report(name, "nearest", "morton", selectedName, drawTextured<TEXTURE_NEAREST>(camera, surface, zbuffer, mip, quadMip), flat);
+        report(name, "bilinear", "morton", "0", drawTextured<TEXTURE_BILINEAR>(camera, surface, zbuffer, full, quadFull), flat);
+        report(name, "bilinear", "morton", selectedName, drawTextured<TEXTURE_BILINEAR>(camera, surface, zbuffer, mip, quadMip), flat);
+    }
+
+    SDL_FreeSurface(surface);
+    return 0;
+}
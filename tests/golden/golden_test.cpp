@@ -0,0 +1,334 @@
+// Проверка изображений: набор сцен и положений камеры рисуется без окна и сравнивается с эталонами
+// в images/ с допуском по каналу и по доле несовпавших пикселей.
+//
+// Каждая сцена рисуется в нескольких конфигурациях. Опорная — один поток, собственный буфер кадра
+// и подсчёт работы растеризатора, который всегда идёт скалярным путём; она сравнивается с эталоном.
+// Остальные — SIMD-заполнение, рабочие потоки, прямая отрисовка в цель, перепаковка каналов при
+// копировании и дорисовка только изменившихся областей кадр за кадром — сравниваются с опорной.
+// При расхождении в out/ пишутся полученное изображение и карта разницы: несовпавшие пиксели
+// красные, отличающиеся в пределах допуска — жёлтые, поверх затемнённого эталона.
+//
+// Эталоны создаются скалярными ядрами: make update (ENGINE_SIMD=scalar golden_test --update).
+// Если ENGINE_SIMD просит ядра, которых нет у процессора, проверка не запускается и завершается
+// с кодом SKIPPED (движок подменил бы их лучшими доступными); неизвестное имя — ошибка.
+//
+//   golden_test [--update] [--filter подстрока] [--tolerance N] [--max-bad доля] [--images DIR] [--out DIR]
+#include "Scene3D.hpp"
+#include "Model3D.hpp"
+#include "Texture.hpp"
+#include "ImageFile.hpp"
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const int WIDTH = 256;
+static const int HEIGHT = 160;
+
+// Код завершения, когда запрошенные ядра не поддерживаются процессором
+static const int SKIPPED = 77;
+
+// Изображение RGB по 8 бит на канал, строки подряд
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+static Image imageFromSurface(SDL_Surface* surface) {
+    Image image;
+    image.width = surface->w;
+    image.height = surface->h;
+    image.rgb.resize((size_t)surface->w * surface->h * 3);
+    uint8_t* out = image.rgb.data();
+    for (int y = 0; y < surface->h; ++y) {
+        const uint32_t* row = (const uint32_t*)((const uint8_t*)surface->pixels + (size_t)y * surface->pitch);
+        for (int x = 0; x < surface->w; ++x, out += 3) {
+            SDL_GetRGB(row[x], surface->format, &out[0], &out[1], &out[2]);
+        }
+    }
+    return image;
+}
+
+static bool loadPpm(const std::string& path, Image& image) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    int maxValue = 0;
+    bool ok = fscanf(file, "P6 %d %d %d", &image.width, &image.height, &maxValue) == 3 && maxValue == 255
+           && image.width > 0 && image.height > 0 && fgetc(file) != EOF;
+    if (ok) {
+        image.rgb.resize((size_t)image.width * image.height * 3);
+        ok = fread(image.rgb.data(), 1, image.rgb.size(), file) == image.rgb.size();
+    }
+    fclose(file);
+    return ok;
+}
+
+static bool savePpm(const std::string& path, const Image& image) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fprintf(file, "P6\n%d %d\n255\n", image.width, image.height) > 0
+           && fwrite(image.rgb.data(), 1, image.rgb.size(), file) == image.rgb.size();
+    return fclose(file) == 0 && ok;
+}
+
+// Итог сравнения: пиксели с разницей больше допуска хотя бы в одном канале и наибольшая разница
+struct Comparison {
+    size_t badPixels = 0;
+    size_t changedPixels = 0;
+    int maxDelta = 0;
+    Image diff;
+};
+
+static Comparison compareImages(const Image& expected, const Image& actual, int tolerance) {
+    Comparison result;
+    result.diff.width = expected.width;
+    result.diff.height = expected.height;
+    result.diff.rgb.resize(expected.rgb.size());
+    for (size_t i = 0; i < expected.rgb.size(); i += 3) {
+        int delta = 0;
+        for (int channel = 0; channel < 3; ++channel) {
+            delta = std::max(delta, std::abs((int)expected.rgb[i + channel] - (int)actual.rgb[i + channel]));
+        }
+        result.maxDelta = std::max(result.maxDelta, delta);
+        uint8_t* out = &result.diff.rgb[i];
+        if (delta > tolerance) {
+            result.badPixels++;
+            out[0] = 0xFF, out[1] = 0x00, out[2] = 0x00;
+        } else if (delta > 0) {
+            result.changedPixels++;
+            out[0] = 0xFF, out[1] = 0xFF, out[2] = 0x00;
+        } else {
+            uint8_t gray = (uint8_t)((expected.rgb[i] + expected.rgb[i + 1] + expected.rgb[i + 2]) / 9);
+            out[0] = out[1] = out[2] = gray;
+        }
+    }
+    return result;
+}
+
+// Сцена набора: build заполняет сцену и возвращает модель, которую двигает pose;
+// pose(scene, model, step) — изменение перед кадром step (1..steps): модели или камеры
+struct GoldenCase {
+    const char* name;
+    std::function<std::shared_ptr<Model3D>(Scene3D&)> build;
+    std::function<void(Scene3D&, Model3D&, int)> pose;
+    int steps;
+};
+
+// Как рисуется сцена
+struct RenderConfig {
+    const char* name;
+    unsigned workers;
+    bool direct;          // Прямая отрисовка в цель подходящего формата
+    bool rasterStats;     // Подсчёт работы растеризатора: скалярный путь
+    bool swappedChannels; // Цель с другим порядком каналов: кадр перепаковывается при копировании
+    bool incremental;     // Кадр после каждого шага: дорисовка изменившихся областей и статический слой
+};
+
+static const RenderConfig REFERENCE = { "reference", 0, false, true, false, false };
+
+static const RenderConfig FAST_CONFIGS[] = {
+    { "simd", 0, true, false, false, false },
+    { "threaded", 3, true, false, false, false },
+    { "buffered", 3, false, false, false, false },
+    { "repacked", 3, false, false, true, false },
+    { "incremental", 3, true, false, false, true },
+    { "incremental_buffered", 0, false, false, false, true },
+};
+
+static void rotateAroundCenter(Model3D& model, float y, float x) {
+    Position3D center = model.getPosition();
+    model.translate(-center.getX(), -center.getY(), -center.getZ());
+    model.rotateY(y);
+    model.rotateX(x);
+    model.translate(center.getX(), center.getY(), center.getZ());
+}
+
+// Куб с текстурой и треугольник под двумя источниками света, как в интерактивной сцене
+static std::shared_ptr<Model3D> buildCubeScene(Scene3D& scene, ShadingMode shading, TextureFilter filter,
+                                               DepthEncoding depth) {
+    auto cube = Model3D::createCube(0.8f);
+    auto triangle = Model3D::createTriangle(0.5f);
+    triangle->translate(1.0f, 0.0f, 0.0f);
+    cube->setTexture(Texture::checkerboard(64, 8, 0xE0E0E0, 0x3060C0));
+    scene.addModel(cube);
+    scene.addModel(triangle);
+    scene.getLighting().addLight(Light::directional(Position3D(-0.3f, -1.0f, -0.6f), { 0.8f, 0.8f, 0.75f }));
+    scene.getLighting().addLight(Light::point(Position3D(2.0f, 1.5f, 2.0f), { 0.9f, 0.6f, 0.3f }, 0.1f));
+    scene.setShadingMode(shading);
+    scene.setTextureFilter(filter);
+    scene.setDepthEncoding(depth);
+    return cube;
+}
+
+static std::vector<GoldenCase> goldenCases() {
+    return {
+        { "cube_gouraud",
+          [](Scene3D& scene) { return buildCubeScene(scene, SHADING_GOURAUD, TEXTURE_NEAREST, DEPTH_REVERSE_Z); },
+          [](Scene3D&, Model3D& cube, int) { rotateAroundCenter(cube, 0.3f, 0.2f); }, 4 },
+        { "cube_flat_bilinear_camera",
+          [](Scene3D& scene) { return buildCubeScene(scene, SHADING_FLAT, TEXTURE_BILINEAR, DEPTH_REVERSE_Z); },
+          [](Scene3D& scene, Model3D&, int step) {
+              scene.getCamera().rotate(0.04f, 0.03f);
+              if (step % 2 == 0) scene.getCamera().move(0.3f, 0.1f, 0.0f);
+          }, 4 },
+        { "cube_view_w_depth",
+          [](Scene3D& scene) { return buildCubeScene(scene, SHADING_GOURAUD, TEXTURE_BILINEAR, DEPTH_VIEW_W); },
+          [](Scene3D&, Model3D& cube, int) { cube.translate(0.15f, 0.05f, -0.2f); }, 3 },
+        { "near_plane_rejection",
+          [](Scene3D& scene) { return buildCubeScene(scene, SHADING_NONE, TEXTURE_NEAREST, DEPTH_REVERSE_Z); },
+          [](Scene3D& scene, Model3D&, int) { scene.getCamera().move(1.05f, 0.0f, 0.0f); }, 4 },
+        { "spheres_unlit",
+          [](Scene3D& scene) {
+              std::shared_ptr<Model3D> first;
+              for (int i = 0; i < 6; ++i) {
+                  auto sphere = Model3D::createSphere(0.45f, 12, 24);
+                  sphere->setFillColor(0x204080 + 0x201008 * i);
+                  sphere->translate((i % 3) * 1.1f - 1.1f, (i / 3) * 1.1f - 0.55f, -(float)(i % 2));
+                  scene.addModel(sphere);
+                  if (!first) first = sphere;
+              }
+              scene.setShadingMode(SHADING_NONE);
+              return first;
+          },
+          [](Scene3D&, Model3D& sphere, int) { sphere.translate(0.25f, 0.1f, 0.3f); }, 4 },
+        { "spheres_overdraw",
+          [](Scene3D& scene) {
+              std::shared_ptr<Model3D> last;
+              for (int i = 0; i < 5; ++i) {
+                  auto cube = Model3D::createCube(0.9f);
+                  cube->translate(i * 0.3f - 0.6f, i * 0.15f - 0.3f, -i * 0.4f);
+                  scene.addModel(cube);
+                  last = cube;
+              }
+              auto sphere = Model3D::createSphere(0.6f, 16, 32);
+              scene.addModel(sphere);
+              scene.setRenderMode(RENDER_OVERDRAW);
+              return last;
+          },
+          [](Scene3D&, Model3D& cube, int) { rotateAroundCenter(cube, 0.25f, 0.15f); }, 3 },
+    };
+}
+
+// Последний кадр сцены в конфигурации config
+static Image renderCase(const GoldenCase& test, const RenderConfig& config) {
+    Scene3D scene(WIDTH, HEIGHT);
+    scene.setWorkerCount(config.workers);
+    scene.setDirectRendering(config.direct);
+    scene.setRasterStatsEnabled(config.rasterStats);
+    std::shared_ptr<Model3D> moving = test.build(scene);
+    // Движущаяся модель рисуется поверх статического слоя, как выбранная в окне
+    moving->setDynamic(true);
+
+    SDL_Surface* target = config.swappedChannels
+        ? SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ABGR8888)
+        : SDL_CreateRGBSurface(0, WIDTH, HEIGHT, 32, 0, 0, 0, 0);
+    if (config.incremental) scene.render(target);
+    for (int step = 1; step <= test.steps; ++step) {
+        test.pose(scene, *moving, step);
+        if (config.incremental) scene.render(target);
+    }
+    if (!config.incremental) scene.render(target);
+    Image image = imageFromSurface(target);
+    SDL_FreeSurface(target);
+    return image;
+}
+
+struct Options {
+    bool update = false;
+    const char* filter = nullptr;
+    int tolerance = 2;        // Допустимая разница канала
+    double maxBad = 0.0005;   // Допустимая доля пикселей с разницей больше tolerance
+    std::string images = "images";
+    std::string out = "out";
+};
+
+// Сравнение с ожидаемым; при провале — запись полученного изображения и карты разницы
+static bool check(const Options& options, const std::string& label, const Image& expected, const Image& actual) {
+    if (expected.width != actual.width || expected.height != actual.height) {
+        fprintf(stderr, "FAIL %-44s size %dx%d, expected %dx%d\n", label.c_str(), actual.width, actual.height,
+                expected.width, expected.height);
+        return false;
+    }
+    Comparison comparison = compareImages(expected, actual, options.tolerance);
+    size_t allowed = (size_t)(options.maxBad * expected.width * expected.height);
+    bool passed = comparison.badPixels <= allowed;
+    fprintf(stderr, "%s %-44s %6zu bad, %6zu within tolerance, max delta %3d\n", passed ? "ok  " : "FAIL",
+            label.c_str(), comparison.badPixels, comparison.changedPixels, comparison.maxDelta);
+    if (!passed) {
+        std::string base = options.out + "/" + label;
+        if (!savePpm(base + "_actual.ppm", actual) || !savePpm(base + "_diff.ppm", comparison.diff)) {
+            fprintf(stderr, "     cannot write %s_*.ppm (does %s exist?)\n", base.c_str(), options.out.c_str());
+        }
+    }
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--update") == 0) options.update = true;
+        else if (i + 1 >= argc) break;
+        else if (strcmp(argv[i], "--filter") == 0) options.filter = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0) options.tolerance = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--max-bad") == 0) options.maxBad = std::max(0.0, atof(argv[++i]));
+        else if (strcmp(argv[i], "--images") == 0) options.images = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0) options.out = argv[++i];
+    }
+
+    if (const char* forced = SDL_getenv("ENGINE_SIMD")) {
+        SimdLevel requested;
+        if (!parseSimdLevel(forced, requested)) {
+            fprintf(stderr, "ENGINE_SIMD=%s: unknown kernel set\n", forced);
+            return 1;
+        }
+        if (requested > detectSimdLevel()) {
+            fprintf(stderr, "ENGINE_SIMD=%s: not supported by this CPU, %s kernels not run\n", forced,
+                    simdKernelsFor(requested).name);
+            return SKIPPED;
+        }
+    }
+
+    fprintf(stderr, "golden images, %s kernels, tolerance %d, max bad %.4f%%\n", simdKernels().name,
+            options.tolerance, options.maxBad * 100.0);
+    int failures = 0;
+    int checked = 0;
+    for (const GoldenCase& test : goldenCases()) {
+        if (options.filter && !strstr(test.name, options.filter)) continue;
+        std::string goldenPath = options.images + "/" + test.name + ".ppm";
+        Image reference = renderCase(test, REFERENCE);
+
+        if (options.update) {
+            if (!savePpm(goldenPath, reference)) {
+                fprintf(stderr, "cannot write %s\n", goldenPath.c_str());
+                return 1;
+            }
+            fprintf(stderr, "wrote %s\n", goldenPath.c_str());
+            continue;
+        }
+
+        Image golden;
+        if (!loadPpm(goldenPath, golden)) {
+            fprintf(stderr, "FAIL %-44s missing golden %s (make update)\n", test.name, goldenPath.c_str());
+            failures++;
+            continue;
+        }
+        checked++;
+        failures += !check(options, std::string(test.name) + "_reference", golden, reference);
+        for (const RenderConfig& config : FAST_CONFIGS) {
+            checked++;
+            failures += !check(options, std::string(test.name) + "_" + config.name, reference, renderCase(test, config));
+        }
+    }
+
+    if (!options.update) {
+        fprintf(stderr, "%d of %d comparisons failed\n", failures, checked);
+    }
+    return failures ? 1 : 0;
+}